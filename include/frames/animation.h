@@ -0,0 +1,201 @@
+/*  Copyright 2014 Mandible Games
+    
+    This file is part of Frames.
+    
+    Please see the COPYING file for detailed licensing information.
+    
+    Frames is dual-licensed software. It is available under both a
+    commercial license, and also under the terms of the GNU General
+    Public License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    Frames is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Frames.  If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef FRAMES_ANIMATION
+#define FRAMES_ANIMATION
+
+#include <map>
+#include <vector>
+
+#include "frames/color.h"
+#include "frames/const.h"
+#include "frames/noncopyable.h"
+
+namespace Frames {
+  class Environment;
+  class Frame;
+  class Layout;
+  class Sprite;
+  class Text;
+
+  /// Easing curves for Animator.
+  /** Every curve maps 0 to 0 and 1 to 1. */
+  enum Easing {
+    EASING_LINEAR,  ///< Constant speed.
+    EASING_IN_QUAD,  ///< Starts slow, quadratic.
+    EASING_OUT_QUAD,  ///< Ends slow, quadratic.
+    EASING_IN_CUBIC,  ///< Starts slow, cubic.
+    EASING_OUT_CUBIC,  ///< Ends slow, cubic.
+    EASING_IN_OUT,  ///< Starts and ends slow (smoothstep).
+    EASING_COUNT,
+  };
+
+  /// Animates frame properties over time.
+  /** Each Environment owns one Animator, available through Environment::AnimatorGet(). Every active track is evaluated in a single pass at the start of Environment::Prepare(), and all of the resulting layout changes are applied inside one layout batch, so a large number of simultaneous tweens costs little more than writing their values.
+
+  Tracks belong to timelines. Timeline 0 always exists; others can be created to pause, stop, or change the speed of a group of tracks at once.
+
+  A track that targets a frame is stopped automatically when that frame is destroyed. When two tracks target the same property, whichever was created later wins. */
+  class Animator : detail::Noncopyable {
+  public:
+    /// Identifies a track. Zero is never a valid track.
+    typedef unsigned int Track;
+    /// Identifies a timeline. Zero is the default timeline.
+    typedef unsigned int Timeline;
+
+    /// Describes the property a track writes to.
+    class Target {
+    public:
+      /// The offset of the pin at "point" on "axis". The pin must exist.
+      static Target PinOffset(Frame *frame, Axis axis, float point);
+      /// The explicit width.
+      static Target Width(Frame *frame);
+      /// The explicit height.
+      static Target Height(Frame *frame);
+      /// The background color.
+      static Target Background(Frame *frame);
+      /// The sprite tint.
+      static Target Tint(Sprite *sprite);
+      /// The sprite rotation.
+      static Target Rotation(Sprite *sprite);
+      /// The text color.
+      static Target TextColor(Text *text);
+
+    private:
+      friend class Animator;
+
+      enum Property { PROPERTY_PIN_OFFSET, PROPERTY_WIDTH, PROPERTY_HEIGHT, PROPERTY_BACKGROUND, PROPERTY_TINT, PROPERTY_ROTATION, PROPERTY_TEXT_COLOR };
+
+      Target(Frame *frame, Property property) : frame(frame), property(property), axis(X), point(0) { }
+
+      Frame *frame;
+      Property property;
+      Axis axis;
+      float point;
+    };
+
+    /// A value at a point in time, for Keyframes().
+    struct Keyframe {
+      /// Constructs a keyframe for a single-valued property.
+      Keyframe(double time, float value, Easing easing = EASING_LINEAR) : time(time), value(value, 0, 0, 0), easing(easing) { }
+      /// Constructs a keyframe for a color property.
+      Keyframe(double time, const Color &value, Easing easing = EASING_LINEAR) : time(time), value(value), easing(easing) { }
+
+      /// Seconds since the start of the track.
+      double time;
+      /// Value at that time. Single-valued properties use the red channel.
+      Color value;
+      /// Curve used to reach this keyframe from the previous one.
+      Easing easing;
+    };
+
+    /// Animates a single-valued property from its current value to "to".
+    Track Tween(const Target &target, float to, double duration, Easing easing = EASING_LINEAR, double delay = 0, Timeline timeline = 0);
+    /// Animates a color property from its current value to "to".
+    Track Tween(const Target &target, const Color &to, double duration, Easing easing = EASING_LINEAR, double delay = 0, Timeline timeline = 0);
+    /// Animates a property through a sequence of keyframes.
+    /** Keyframes must be sorted by time. The value holds at the first keyframe until its time is reached. If "loop" is set, the track restarts from the first keyframe after the last one, forever. */
+    Track Keyframes(const Target &target, const std::vector<Keyframe> &keyframes, bool loop = false, Timeline timeline = 0);
+
+    /// Stops a track, leaving its property wherever it is.
+    /** Stopping a track that has already finished does nothing. */
+    void Stop(Track track);
+    /// Returns whether a track is still running.
+    bool ActiveGet(Track track) const { return m_trackSlot.count(track) != 0; }
+    /// Returns the number of running tracks.
+    int ActiveCountGet() const { return (int)m_tracks.size(); }
+
+    /// Creates a new timeline.
+    Timeline TimelineCreate();
+    /// Stops every track on a timeline and destroys it. Timeline 0 can't be destroyed, but this will stop its tracks.
+    void TimelineDestroy(Timeline timeline);
+    /// Sets how fast a timeline runs relative to real time. Zero pauses it.
+    void TimelineSpeedSet(Timeline timeline, double speed);
+    /// Gets how fast a timeline runs relative to real time.
+    double TimelineSpeedGet(Timeline timeline) const;
+
+    /// Advances all timelines by the given number of seconds, scaled by each timeline's speed, and applies the results.
+    /** Environment::Prepare() calls this with the time elapsed since the previous Prepare() unless AutoAdvanceSet(false) has been called. */
+    void Advance(double seconds);
+    /// Sets whether Environment::Prepare() advances animations automatically.
+    void AutoAdvanceSet(bool automatic) { m_autoAdvance = automatic; }
+    /// Gets whether Environment::Prepare() advances animations automatically.
+    bool AutoAdvanceGet() const { return m_autoAdvance; }
+
+  private:
+    friend class Environment;
+
+    Animator(Environment *env);
+    ~Animator();
+
+    // Called by Environment
+    void PrepareBegin();
+    void LayoutDestroyed(const Layout *layout);
+
+    Track TrackCreate(const Target &target, const std::vector<Keyframe> &keyframes, bool loop, Timeline timeline);
+    void TrackRemove(int slot);
+    bool SegmentRemaining(int slot) const;  // whether there's anything after the current segment
+    void SegmentNext(int slot);
+    void Evaluate();
+    void Apply(int slot);
+
+    Color ValueGet(const Target &target) const;
+
+    Environment *m_env;
+
+    // Hot data, one entry per running track, structure-of-arrays so it can be evaluated four tracks at a time
+    // Each track interpolates from "from" towards "from + delta" with progress ((time - start) * rate) eased by the cubic ((a * t + b) * t + c) * t
+    std::vector<float> m_progress;  // elapsed fraction of the current segment, filled in just before evaluation
+    std::vector<float> m_easeA;
+    std::vector<float> m_easeB;
+    std::vector<float> m_easeC;
+    std::vector<float> m_from[4];
+    std::vector<float> m_delta[4];
+    std::vector<float> m_value[4];  // output
+
+    struct TimelineInfo {
+      double time;
+      double speed;
+    };
+    std::map<Timeline, TimelineInfo> m_timelines;
+    Timeline m_timelineNext;
+
+    // Cold data, parallel to the above
+    struct TrackInfo {
+      Track id;
+      Target target;
+      Timeline timeline;
+      const TimelineInfo *clock;  // map nodes don't move, and a timeline can't be destroyed while it has tracks
+      double start;  // in timeline time, of the current segment
+      double rate;  // 1 / duration of the current segment
+      std::vector<Keyframe> keyframes;
+      int next;  // index of the keyframe the current segment ends at
+      bool loop;
+    };
+    std::vector<TrackInfo> m_tracks;
+    std::map<Track, int> m_trackSlot;
+    std::multimap<const Layout *, Track> m_trackTargets;
+    Track m_trackNext;
+
+    bool m_autoAdvance;
+    double m_clockLast;  // negative until the first automatic advance
+  };
+}
+
+#endif
@@ -0,0 +1,66 @@
+/*  Copyright 2014 Mandible Games
+    
+    This file is part of Frames.
+    
+    Please see the COPYING file for detailed licensing information.
+    
+    Frames is dual-licensed software. It is available under both a
+    commercial license, and also under the terms of the GNU General
+    Public License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    Frames is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Frames.  If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef FRAMES_BINARY
+#define FRAMES_BINARY
+
+#include "frames/ptr.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace Frames {
+  class Frame;
+  class Layout;
+  class Stream;
+  typedef Ptr<Stream> StreamPtr;
+
+  /// Compact binary descriptions of frame hierarchies.
+  /** Save() serializes a frame and all of its descendants: frame types, names, layers, flags, render transforms, sizes, pins, background colors, and the properties of Sprite, Text, Mask and Container frames. Load() rebuilds the hierarchy under a new parent in a single pass, inside one layout batch, with every table sized up front.
+
+  Pins between frames in the saved hierarchy are stored by index. Pins to the saved frame's own parent are stored as pins to "the parent", and are attached to whatever parent the hierarchy is loaded under. Pins to any other frame can't be represented; Save() reports them as errors and leaves them out.
+
+  Handlers, and frame types other than those listed above, can't be represented either. Unknown frame types are saved as their nearest supported base type, with an error.
+
+  All values are little-endian. The format is versioned, and Load() rejects versions it doesn't know. */
+  namespace Binary {
+    /// The format version written by Save().
+    const unsigned int VERSION = 1;
+
+    /// Determines whether a block of memory starts with a binary frame description.
+    bool Is(const unsigned char *data, std::size_t bytes);
+
+    /// Builds the hierarchy described by a block of memory under a parent.
+    /** Returns the topmost frame created, or null on failure. Data is validated as it's read; if it turns out to be malformed, an error is logged and anything created so far is destroyed. The data is not referenced after this returns. */
+    Frame *Load(Layout *parent, const unsigned char *data, std::size_t bytes);
+    /// Builds the hierarchy described by a stream under a parent.
+    /** Reads the entire stream into memory first. See Load(Layout *, const unsigned char *, std::size_t) for details. */
+    Frame *Load(Layout *parent, const StreamPtr &stream);
+    /// Builds the hierarchy described by a file under a parent.
+    /** The file is mapped into memory rather than read, so large files cost little more than the time it takes to touch their pages. See Load(Layout *, const unsigned char *, std::size_t) for details. */
+    Frame *LoadFile(Layout *parent, const std::string &filename);
+
+    /// Serializes a frame and all its descendants.
+    /** The result is appended to output. Returns false, with an error logged, if anything couldn't be represented; output is still a valid description of everything that could be. */
+    bool Save(const Frame *frame, std::vector<unsigned char> *output);
+  }
+}
+
+#endif
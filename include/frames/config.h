@@ -25,4 +25,7 @@
 // Config flags and settings
 #define FRAMES_BOOST_ENABLED
 
+// Sends layout, event handler, and child list allocations straight to the system heap rather than the environment's slabs; useful with memory debugging tools
+//#define FRAMES_SLAB_HEAP_DISABLED
+
 #endif
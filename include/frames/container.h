@@ -0,0 +1,139 @@
+/*  Copyright 2014 Mandible Games
+    
+    This file is part of Frames.
+    
+    Please see the COPYING file for detailed licensing information.
+    
+    Frames is dual-licensed software. It is available under both a
+    commercial license, and also under the terms of the GNU General
+    Public License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    Frames is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Frames.  If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef FRAMES_CONTAINER
+#define FRAMES_CONTAINER
+
+#include "frames/frame.h"
+
+#include <map>
+#include <vector>
+
+namespace Frames {
+  /// Arranges a list of item frames in a stack, grid, or flow.
+  /** Items are positioned by pinning each one directly to the container, so no item depends on any other. A change to one item only forces the rest to re-resolve when it changes the container's own size, as it can when the container grows to fit its items.
+  Positions are computed in a single pass over the items, deferred until layout is next needed, so any number of changes in a row cost one pass. When an item changes size, only the items that could have moved as a result are revisited.
+
+  Items are placed in the order they were added, regardless of layer. Items must be children of the container; ItemAdd() reparents them if necessary. Items keep their own sizes; the container pins their top-left corners, so items should have no other pins while they are in a container.
+  
+  If the container's size isn't otherwise constrained, it grows to fit its items. A flow container needs a width to wrap against, so give it one. */
+  class Container : public Frame {
+    FRAMES_DECLARE_RTTI();
+    friend class Environment;
+
+  public:
+    /// How items are arranged.
+    enum Arrangement {
+      STACK_VERTICAL, ///< Top to bottom, aligned to the left edge.
+      STACK_HORIZONTAL, ///< Left to right, aligned to the top edge.
+      GRID, ///< Uniform cells, GridColumnsGet() per row, each as large as the largest item.
+      FLOW, ///< Left to right, wrapping onto a new line whenever the next item would cross the right edge.
+      ARRANGEMENT_COUNT,
+    };
+
+    /// Creates a new Container.
+    static Container *Create(Layout *parent, const std::string &name);
+
+    /// Sets the arrangement.
+    void ArrangementSet(Arrangement arrangement);
+    /// Gets the arrangement.
+    Arrangement ArrangementGet() const { return m_arrangement; }
+
+    /// Sets the space between adjacent items, in pixels.
+    void SpacingSet(float spacing);
+    /// Gets the space between adjacent items.
+    float SpacingGet() const { return m_spacing; }
+
+    /// Sets the space between the container's edges and its items, in pixels.
+    void PaddingSet(float padding);
+    /// Gets the space between the container's edges and its items.
+    float PaddingGet() const { return m_padding; }
+
+    /// Sets the number of columns used by GRID.
+    void GridColumnsSet(int columns);
+    /// Gets the number of columns used by GRID.
+    int GridColumnsGet() const { return m_gridColumns; }
+
+    /// Appends an item.
+    void ItemAdd(Frame *item) { ItemInsert((int)m_items.size(), item); }
+    /// Inserts an item before the given index.
+    void ItemInsert(int index, Frame *item);
+    /// Removes an item.
+    /** The item remains a child of the container, but is no longer arranged and has its top-left pin cleared. Destroying an item removes it automatically. */
+    void ItemRemove(Frame *item);
+
+    /// Returns the number of items.
+    int ItemCountGet() const { return (int)m_items.size(); }
+    /// Returns the item at a given index.
+    Frame *ItemGet(int index) const;
+
+  protected:
+    /// Creates a new Container with the given parameters. "parent" must be non-null.
+    Container(Layout *parent, const std::string &name);
+    virtual ~Container() FRAMES_OVERRIDE;
+
+    /// Creates an empty Container. See Layout::CloneCreate for inheritance info.
+    virtual Frame *CloneCreate(Layout *parent) const FRAMES_OVERRIDE;
+    /// Copies the arrangement settings, and adds the clones of this container's items in the same order. See Layout::CloneCopy for inheritance info.
+    virtual void CloneCopy(Layout *clone, const CloneMap &clones) const FRAMES_OVERRIDE;
+
+    /// Repositions the items queued by the last change. See Layout::ArrangeDeferred for inheritance info.
+    virtual void ArrangeDeferred() FRAMES_OVERRIDE;
+
+  private:
+    struct Item {
+      Frame *frame;
+      EventToken sizeToken;
+      EventToken destroyToken;
+
+      // As of the last arrangement
+      float width;
+      float height;
+      float x;
+      float y;
+      int lineStart;  // index of the first item on this item's line, for FLOW
+    };
+
+    // Repositions every item from index onwards; earlier items are assumed to be where they were left
+    void Arrange(int index);
+    void ArrangeFrom(int index);  // queues Arrange(), merging with any request already queued
+    void IndexRebuild(int index);
+
+    void SizeChanged(Handle *handle);
+    void Destroyed(Handle *handle);
+    void ItemSizeChanged(Handle *handle);
+    void ItemDestroyed(Handle *handle);
+
+    Arrangement m_arrangement;
+    float m_spacing;
+    float m_padding;
+    int m_gridColumns;
+
+    std::vector<Item> m_items;
+    std::map<const Layout *, int> m_itemIndex;
+
+    float m_gridCellWidth;
+    float m_gridCellHeight;
+    float m_lastWidth;
+
+    int m_arrangeFrom;  // -1 if nothing is queued
+  };
+}
+
+#endif
@@ -638,6 +638,20 @@ public:
 	{ return m_pthis==0 && m_pFunction==0; }
 	inline bool empty() const		// Is it bound to anything?
 	{ return m_pthis==0 && m_pFunction==0; }
+	// Frames addition: the object a member function is bound to, or null for static functions.
+	// Only good for telling delegates apart by their owner; it's the adjusted "this" and can't be called through.
+#if !defined(FASTDELEGATE_USESTATICFUNCTIONHACK)
+	inline const void *GetBoundObject() const { return m_pStaticFunction ? 0 : m_pthis; }
+#else
+	inline const void *GetBoundObject() const { return m_pthis; }
+#endif
+	// Frames addition: the code address a member function pointer leads with, for printing in diagnostics.
+	// Member function pointers may be wider than a code pointer; virtual functions give an ABI-specific vtable slot, not an address.
+	inline const void *GetFunctionAddress() const {
+		const void *address = 0;
+		memcpy(&address, &m_pFunction, sizeof(address) < sizeof(m_pFunction) ? sizeof(address) : sizeof(m_pFunction));
+		return address;
+	}
 public:
 	DelegateMemento & operator = (const DelegateMemento &right)  {
 		SetMementoFrom(right); 
@@ -98,6 +98,9 @@ namespace Frames {
 
     static const float SizeDefault = 40.f;
 
+    static const int LayoutIterationLimit = 16; // resolve/notify passes per frame before we give up on Move/Size handlers settling down
+    static const int ResolveParallelMinimum = 256; // invalidated layouts below which handing work to other threads costs more than it saves
+
     struct FrameOrderSorter { bool operator()(const Frame *lhs, const Frame *rhs) const; };
     struct LayoutIdSorter { bool operator()(const Layout *lhs, const Layout *rhs) const; };
   };
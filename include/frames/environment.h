@@ -23,7 +23,10 @@
 #include "frames/configuration.h"
 #include "frames/detail.h"
 #include "frames/input.h"
+#include "frames/name_table.h"
 #include "frames/noncopyable.h"
+#include "frames/slab_heap.h"
+#include "frames/spatial_index.h"
 #include "frames/vector.h"
 
 #include <deque>
@@ -34,22 +37,28 @@
 #include <boost/bimap.hpp>
 
 namespace Frames {
+  class Animator;
   class Environment;
   typedef Ptr<Environment> EnvironmentPtr;
+  class EventProfiler;
   class Frame;
   class Layout;
+  class Snapshot;
   class VerbGeneric;
 
   namespace detail {
+    class BinaryWriter;
     class CharacterInfo;
     class FontInfo;
     class Renderer;
+    class SnapshotRecorder;
     class TextManager;
     class TextureBacking;
     typedef Ptr<TextureBacking> TextureBackingPtr;
     class TextureChunk;
     typedef Ptr<TextureChunk> TextureChunkPtr;
     class Renderer;
+    class WorkerPool;
   }
 
   /// Coordinator class for almost all Frames state. Every Frames-using program will contain at least one Environment.
@@ -57,7 +66,7 @@ namespace Frames {
   
   While Environment is not locked to any individual thread, it is fundamentally single-threaded.
   It is undefined behavior to call any Environment function, or any function on a Frame owned by an Environment, while any other such function is being run in another thread.
-  However, multiple Environments can be used in parallel without issue.
+  However, multiple Environments can be used in parallel without issue. The one exception within an Environment is drawing a Snapshot from SnapshotRecord(), which may happen in another thread while this one carries on.
   
   Except when specified otherwise, it is always valid to call an Environment or Frame function while handling an event dispatch in that same thread.
   
@@ -149,10 +158,52 @@ namespace Frames {
     Layout *FocusGet() const { return m_focus; }
 
     // ==== Rendering
+    /// Brings layout up to date and delivers pending layout events.
+    /** Animations (see AnimatorGet()) are advanced first. Pending layout changes are then resolved, then Layout::Event::Size and Layout::Event::Move are delivered, parents before children, at most once per layout per pass. If those handlers change layout again, further passes are run, up to a fixed limit; past that an error is logged and the remainder is deferred to the next Prepare.
+
+    Calling this separately from Render() lets a host run it for the next frame while the previous one is still being submitted, and time each phase on its own. Calling it is optional; Render() calls it itself if it hasn't been called since the last Render(). */
+    void Prepare();
+
     /// Renders a tree of Frames.
-    /** This can be used to render a subtree if the desired subroot is passed as a parameter, otherwise it will start from the root. */
+    /** This can be used to render a subtree if the desired subroot is passed as a parameter, otherwise it will start from the root.
+
+    Only geometry is emitted here; no events are delivered. If Prepare() hasn't been called since the last Render(), it is called first. Layout changes made between Prepare() and Render() are still drawn in their new positions, but their Move and Size events wait for the next Prepare().
+
+    Rendering from the root uses a flattened draw order that is only rebuilt when frames are created, destroyed, reparented, relayered, or shown and hidden, so an unchanged hierarchy costs a single linear pass. Other subroots are walked directly. */
     void Render(const Layout *root = 0);
 
+    /// Records a tree of Frames into a Snapshot, for drawing in another thread.
+    /** Works like Render(), including calling Prepare() first if needed, but records the geometry instead of drawing it. Pass the result to another thread and draw it there with Snapshot::Render() while this thread goes on changing frames.
+
+    Snapshots are double-buffered: each call records into the one that wasn't returned last time. The returned snapshot is left alone by the next call and overwritten by the one after that, so whatever is drawing it must have finished by then; synchronizing that is up to the caller. Textures are still created and uploaded in this thread, and Raw frames fire their Render events here during recording, so anything they draw directly isn't part of the snapshot. */
+    const Snapshot *SnapshotRecord(const Layout *root = 0);
+
+    // ==== Layout batching
+    /// Begins a batch of layout changes.
+    /** While a batch is open, layout changes skip the usual recursive invalidation of everything that depends on them. The changed axes are remembered instead, and the invalidation is done once, merged, when the outermost batch ends.
+    This makes bulk construction or bulk pin changes scale with the number of layouts touched rather than with changes multiplied by fan-out.
+
+    Batches nest; every call to LayoutBatchBegin() must be matched by a call to LayoutBatchEnd(). Querying geometry inside a batch is allowed and always returns correct results, but flushes the pending work early, so it should be avoided in hot loops.
+    
+    See Environment::LayoutBatch for an RAII wrapper. */
+    void LayoutBatchBegin();
+    /// Ends a batch of layout changes.
+    /** See LayoutBatchBegin() for details. */
+    void LayoutBatchEnd();
+
+    /// RAII layout batching of scope blocks.
+    /** Calls LayoutBatchBegin() on construction and LayoutBatchEnd() on destruction. */
+    class LayoutBatch : detail::Noncopyable {
+    public:
+      /// Begins a new layout batch.
+      LayoutBatch(Environment *env);
+      /// Ends the layout batch.
+      ~LayoutBatch();
+
+    private:
+      Environment *m_env;
+    };
+
     /// Informs the environment that the rendering environment has resized.
     /** This must be called whenever the render canvas resizes. It will resize Root immediately. */
     void ResizeRoot(int x, int y);
@@ -166,7 +217,11 @@ namespace Frames {
     const Layout *RootGet() const { return m_root; }
 
     /// Returns the layout underneath a given coordinate as if it were mouse input.
-    /** This can be used to find out what frame would be hit by a mouse event at a certain coordinate. */
+    /** This can be used to find out what frame would be hit by a mouse event at a certain coordinate.
+    
+    Uses a spatial index of input-accepting layouts rather than walking the hierarchy, so the cost depends on how many such layouts overlap the coordinate, not on the size of the scene. Pending layout changes are resolved first; this does not deliver Move or Size events, which still wait for Prepare().
+
+    Respects render transforms (see Layout::RenderTranslationSet). The index is looked up once more in the space of each transformed frame, so cost grows with the number of frames that currently have a transform. */
     Layout *ProbeAsMouse(float x, float y) const;
 
     /// Returns the environment's Configuration.
@@ -195,6 +250,55 @@ namespace Frames {
       void *m_handle;
     };
 
+    // ==== Profiling
+    /// Turns event handler profiling on or off.
+    /** See EventProfiler for what gets recorded. Turning profiling off discards everything gathered so far.
+    
+    When off, this costs a single pointer check per dispatch. When on, every handler call reads the clock twice and updates a few maps, so expect dispatch-heavy code to slow down somewhat. */
+    void EventProfilerSet(bool enabled);
+    /// Returns the active event profiler, or null if profiling is off.
+    EventProfiler *EventProfilerGet() { return m_eventProfiler; }
+
+    /// Returns the environment's animator, creating it if necessary.
+    Animator *AnimatorGet();
+
+    /// Sets whether layouts inside hidden subtrees are resolved lazily.
+    /** When on, a layout that is hidden, or has a hidden ancestor, is skipped by Prepare()'s resolve pass. It gets no Move or Size events, and doesn't update its hit-test bounds, until every frame above it is visible again; at that point it resolves once and fires at most one Move and one Size covering everything that happened in the meantime.
+
+    Geometry queries on skipped layouts are still accurate, since layout values are computed on demand regardless.
+
+    Off by default, because it changes when Move and Size fire for hidden frames. */
+    void ResolveHiddenLazySet(bool lazy);
+    /// Gets whether layouts inside hidden subtrees are resolved lazily.
+    bool ResolveHiddenLazyGet() const { return m_resolveHiddenLazy; }
+
+    /// Sets how many extra threads help resolve layout.
+    /** When many unrelated layouts are invalidated at once, as when resizing the root moves every top-level window, Prepare() splits them into groups that share no unresolved pins and computes each group's geometry on a pool of this many threads, plus the calling thread. Move and Size events are still delivered on the calling thread, in exactly the order they would be with no extra threads.
+
+    Groups whose layouts pin to each other in a loop are left to the calling thread, as are small batches, where handing work over costs more than it saves. No event handler ever runs on another thread.
+
+    Defaults to 0, which resolves everything on the calling thread. */
+    void ResolveThreadsSet(int threads);
+    /// Gets how many extra threads help resolve layout.
+    int ResolveThreadsGet() const;
+    /// Gets how many groups of layouts were handed to the resolve threads since the last Prepare() began.
+    /** Stays 0 when there are no extra threads, or when nothing invalidated was large or independent enough to be worth splitting up. */
+    int ResolveGroupsGet() const { return m_resolveGroups; }
+
+    // ==== Memory
+    /// Summary of the memory used by this environment's layouts, event handlers, and child lists.
+    /** These all come from per-environment slabs, so creating and destroying frames rarely touches the system allocator. Memory freed by destroying frames is kept for reuse until the environment itself is destroyed; see reserved versus live. */
+    struct AllocationStats {
+      unsigned int live;  ///< Blocks currently allocated.
+      std::size_t liveBytes;  ///< Bytes currently allocated.
+      std::size_t oversizeBytes;  ///< Bytes currently allocated that were too large for the slabs, and came from the system heap instead. Included in liveBytes.
+      std::size_t reservedBytes;  ///< Bytes held in slabs, allocated or not.
+      unsigned int slabs;  ///< Number of slabs held.
+      unsigned int allocations;  ///< Allocations made over the environment's lifetime.
+    };
+    /// Returns a summary of the memory used by this environment's layouts, event handlers, and child lists.
+    AllocationStats AllocationStatsGet() const;
+
   private:
     friend class Layout;
     friend class Frame;
@@ -207,6 +311,9 @@ namespace Frames {
     friend class detail::TextureBacking;
     friend class detail::TextureChunk;
 
+    // Settles deferred arrangement before saving
+    friend class detail::BinaryWriter;
+
     // REMOVE LATER - REFACTORING TEMPORARY
     friend class detail::Renderer;
 
@@ -225,6 +332,83 @@ namespace Frames {
     void MarkInvalidated(Layout *layout);
     void UnmarkInvalidated(Layout *layout); // This is currently very slow.
     std::deque<Layout *> m_invalidated;
+    void ResolvePending();
+
+    // Invalidated layouts skipped because they're hidden; see ResolveHiddenLazySet()
+    // Each is filed under the nearest hidden layout at or above it, so showing or moving a frame only rechecks what was parked beneath it
+    typedef std::map<Layout *, std::vector<Layout *> > ParkedMap;
+    static Layout *ResolveHiddenFind(Layout *layout);
+    void ResolveUnpark();
+    void ResolveUnparkShown(Layout *layout);
+    void ResolveUnparkMoving(Layout *layout);
+    void UnmarkParked(Layout *layout);
+    bool m_resolveHiddenLazy;
+    ParkedMap m_resolveParked;
+
+    // Fills geometry caches for independent groups of invalidated layouts on the worker pool, so the serial pass finds them done; see ResolveThreadsSet()
+    void ResolveParallel();
+    detail::WorkerPool *m_resolvePool;  // null when resolving on one thread
+    int m_resolveGroups;
+
+    // Set by Prepare() and cleared by Render(), which prepares on its own when the host hasn't
+    bool m_prepared;
+
+    // The drawing half of Render(), shared with SnapshotRecord()
+    void RenderProcess(const Layout *root, detail::Renderer *renderer);
+
+    // Move/Size notification, delivered after resolution
+    void LayoutNotifyQueue(Layout *layout) { m_layoutNotify.push_back(layout); }
+    void LayoutNotifyUnqueue(Layout *layout);
+    void LayoutNotifyFlush();
+    std::vector<Layout *> m_layoutNotify;
+
+    // Layout::ArrangeDeferred requests
+    void ArrangeFlush();
+    void ArrangeUnqueue(Layout *layout);
+    std::vector<Layout *> m_arrangeQueue;
+
+    // Layout batching
+    void LayoutBatchFlush();
+    void LayoutBatchUnqueue(Layout *layout);
+    int m_layoutBatchDepth;
+    std::vector<Layout *> m_layoutBatchPending;
+
+    // Bumped whenever any layout's hooked verbs or parent change, so cached ancestor summaries know to rebuild
+    unsigned int m_eventMaskGeneration;
+
+    // Null unless profiling is on
+    EventProfiler *m_eventProfiler;
+
+    // Null until someone asks for it
+    Animator *m_animator;
+
+    // Recorded into alternately by SnapshotRecord(); all null until it's first called
+    detail::SnapshotRecorder *m_snapshotRecorder;
+    Snapshot *m_snapshots[2];
+    int m_snapshotNext;
+
+    // Backs layouts, their event tables, and their child lists; outlives all of them, since the root is obliterated in our destructor body
+    detail::SlabHeap m_slabHeap;
+
+    // Layout names, shared between every layout with the same one
+    detail::NameTable m_names;
+
+    // The root's render order, flattened; rebuilt only when the hierarchy, layering, or visibility changes
+    struct DisplayEntry {
+      enum Type { ELEMENT, PRECHILD, POSTCHILD, TRANSFORM_PUSH, TRANSFORM_POP };
+
+      const Layout *layout;
+      Type type;
+    };
+    void DisplayListBuild();
+    void DisplayListAppend(const Layout *layout);
+    void DisplayListRender(detail::Renderer *renderer);
+    void DisplayListDirty() { m_displayListDirty = true; }
+    std::vector<DisplayEntry> m_displayList;
+    bool m_displayListDirty;
+
+    // Layouts with a render transform; the probe index only knows untransformed bounds, so probes look it up again in each of these spaces
+    std::set<const Layout *> m_renderTransformed;
 
     // Layout sanity
     void LayoutStack_Push(const Layout *layout, Axis axis, float pt);
@@ -237,6 +421,7 @@ namespace Frames {
       float point;
     };
     std::vector<LayoutStack_Entry> m_layoutStack;
+    bool m_layoutStackSuspended;  // set while workers resolve; they only get groups that can't loop, so there's nothing for the stack to report
     
     // Maintenance
     void DestroyingLayout(Layout *layout);
@@ -254,6 +439,13 @@ namespace Frames {
     // Root
     Layout *m_root;
     
+    // Mouse probing
+    static bool ProbeAccepts(const Layout *layout, float x, float y);
+    static bool ProbeDescend(const Layout *layout, Vector *point);  // maps a screen point into layout's own space, failing if it's hidden or masked on the way
+    static bool ProbeAbove(const Layout *lhs, const Layout *rhs);
+    detail::SpatialIndex m_probeIndex;  // every IM_ALL layout, with its bounds as of its last resolve
+    mutable std::vector<Layout *> m_probeCandidates;
+
     // Input states
     Layout *m_over;
     Layout *m_focus;
@@ -275,7 +467,9 @@ namespace Frames {
     bool ObliterateLocked() const;
 
     void ObliterateQueue(Layout *layout);
-    void ObliterateDequeue(Layout *layout);
+    void ObliterateFlush();  // obliterates everything queued, including anything queued while doing so
+    void ObliterateSweep(const std::vector<Layout *> &roots);  // tears down whole subtrees at once; Destroy must already have fired
+    static bool ObliterateDoomed(const Layout *layout);
 
     int m_obliterateLockCount;
     std::set<Layout *, detail::LayoutIdSorter> m_obliterateQueues;
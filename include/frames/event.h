@@ -23,6 +23,7 @@
 #include "frames/detail.h"
 #include "frames/noncopyable.h"
 #include "frames/delegate.h"
+#include "frames/functor.h"
 
 namespace Frames {
   class Layout;
@@ -45,14 +46,21 @@ namespace Frames {
     /** Returns null if this verb is a Dive or Bubble. */
     const VerbGeneric *BubbleGet() const { return m_bubble; }
 
+    /// Returns a small integer unique to this Verb.
+    /** Verbs are numbered densely in order of construction, Dive and Bubble variants included. This is used internally to index handler tables. */
+    unsigned int IndexGet() const { return m_index; }
+
   private:
     template <typename Parameters> friend class Verb;
-    VerbGeneric(const char *name) : m_name(name), m_dive(0), m_bubble(0) {};
-    VerbGeneric(const char *name, const VerbGeneric *dive, const VerbGeneric *bubble) : m_name(name), m_dive(dive), m_bubble(bubble) {};
+    VerbGeneric(const char *name) : m_name(name), m_dive(0), m_bubble(0), m_index(IndexAllocate()) {};
+    VerbGeneric(const char *name, const VerbGeneric *dive, const VerbGeneric *bubble) : m_name(name), m_dive(dive), m_bubble(bubble), m_index(IndexAllocate()) {};
+
+    static unsigned int IndexAllocate();
 
     const char *m_name;
     const VerbGeneric *m_dive;
     const VerbGeneric *m_bubble;
+    unsigned int m_index;
   };
 
   /// Passed along with every event call for storing event metainformation and providing callbacks.
@@ -109,6 +117,9 @@ namespace Frames {
     typedef typename detail::FunctionPrefix<Handle*, Parameters>::T TypeHandler;
     /// Convenience typedef for the delegate type which is needed to attach to this Verb.
     typedef Delegate<typename detail::FunctionPrefix<Handle*, Parameters>::T> TypeDelegate;
+    /// Convenience typedef for the functor type which is needed to attach to this Verb.
+    /** Implicitly constructible from TypeDelegate, a plain function pointer, or any small function object; see Functor. */
+    typedef Functor<typename detail::FunctionPrefix<Handle*, Parameters>::T> TypeFunctor;
   };
 
   /// Represents a type of event with specific parameter typing and Dive/Bubble behavior.
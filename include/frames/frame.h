@@ -150,6 +150,14 @@ namespace Frames {
     The effect may be deferred until the completion of all in-flight events. */
     inline void Obliterate() { return zinternalObliterate(); }
 
+    /// Creates a copy of this frame and all its children under a new parent.
+    /** Everything is duplicated in one pass, inside a single layout batch: frame types, names, layers, visibility, render transforms, input modes, sizes, pins, the properties of each frame type, and attached handlers. Pins between frames inside the subtree are remapped to point at the corresponding clones, and pins to this frame's parent are remapped to the new parent, while pins to any other frame outside it are kept as they are. This makes it cheap to build one prototype and stamp out many instances of it.
+
+    Handlers that are delegates bound to a frame inside the subtree, or to this frame's parent, are not copied, since they usually belong to that specific frame's internals; frame types re-create their own handlers on the clone. Frame types that don't overload CloneCreate() are cloned as the nearest type that does, with an error.
+
+    Returns the clone of this frame, or null if the clone couldn't be created. */
+    inline Frame *CloneSubtree(Layout *parent) const { return zinternalCloneSubtree(parent); }
+
     /// Sets the background color.
     /** The background color will be drawn as a solid rectangle of the desired color. This is intended for debugging, although it can also be used for basic UI layout and prototyping. */
     void BackgroundSet(const Color &color);
@@ -164,6 +172,11 @@ namespace Frames {
     /// Renders the Frame background. See Layout::RenderElement for inheritance info.
     virtual void RenderElement(detail::Renderer *renderer) const;
 
+    /// Creates an empty Frame. See Layout::CloneCreate for inheritance info.
+    virtual Frame *CloneCreate(Layout *parent) const;
+    /// Copies the background color. See Layout::CloneCopy for inheritance info.
+    virtual void CloneCopy(Layout *clone, const CloneMap &clones) const;
+
   private:
     Color m_bg;
   };
@@ -0,0 +1,262 @@
+/*  Copyright 2014 Mandible Games
+    
+    This file is part of Frames.
+    
+    Please see the COPYING file for detailed licensing information.
+    
+    Frames is dual-licensed software. It is available under both a
+    commercial license, and also under the terms of the GNU General
+    Public License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    Frames is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Frames.  If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef FRAMES_FUNCTOR
+#define FRAMES_FUNCTOR
+
+#include <new>
+
+#include <boost/static_assert.hpp>
+#include <boost/type_traits/alignment_of.hpp>
+
+#include "frames/delegate.h"
+
+namespace Frames {
+  namespace detail {
+    /// Signature-independent part of Functor.
+    /** Owns the inline storage and knows how to copy, destroy, and compare whatever is in it. */
+    class FunctorBase {
+    public:
+      /// Size, in bytes, of the largest callable that can be stored.
+      static const int STORAGE_SIZE = 32;
+
+      FunctorBase() : m_ops(0) { }
+      FunctorBase(const FunctorBase &rhs) : m_ops(rhs.m_ops) {
+        if (m_ops) {
+          m_ops->copy(m_storage.bytes, rhs.m_storage.bytes);
+        }
+      }
+      ~FunctorBase() { Reset(); }
+
+      FunctorBase &operator=(const FunctorBase &rhs) {
+        if (this != &rhs) {
+          Reset();
+          if (rhs.m_ops) {
+            rhs.m_ops->copy(m_storage.bytes, rhs.m_storage.bytes);
+            m_ops = rhs.m_ops;
+          }
+        }
+        return *this;
+      }
+
+      /// Returns true if both hold callables of the same type that compare equal.
+      bool operator==(const FunctorBase &rhs) const { return m_ops == rhs.m_ops && (!m_ops || m_ops->equal(m_storage.bytes, rhs.m_storage.bytes)); }
+      /// Returns false if both hold callables of the same type that compare equal.
+      bool operator!=(const FunctorBase &rhs) const { return !(*this == rhs); }
+
+      /// Returns true if nothing is stored.
+      bool Empty() const { return !m_ops; }
+
+      /// Retrieves the DelegateMemento of the stored callable, if it's a Delegate.
+      /** Returns false, and leaves memento untouched, for anything else. */
+      bool MementoGet(DelegateMemento *memento) const { return m_ops && m_ops->memento(m_storage.bytes, memento); }
+
+      /// Returns a value that is identical for any two functors holding the same type of callable, and different otherwise.
+      const void *TypeGet() const { return m_ops; }
+
+      /// Returns the raw storage, for use with a Functor's invoker.
+      const void *StorageGet() const { return m_storage.bytes; }
+
+    protected:
+      template<typename F> void Store(const F &callable) {
+        BOOST_STATIC_ASSERT(sizeof(F) <= STORAGE_SIZE);  // too big to store inline; capture less, or capture a pointer
+        BOOST_STATIC_ASSERT(boost::alignment_of<F>::value <= boost::alignment_of<Storage>::value);
+
+        new (m_storage.bytes) F(callable);
+        m_ops = &Ops<F>::table;
+      }
+
+    private:
+      void Reset() {
+        if (m_ops) {
+          m_ops->destroy(m_storage.bytes);
+          m_ops = 0;
+        }
+      }
+
+      struct OpsTable {
+        void (*copy)(void *destination, const void *source);
+        void (*destroy)(void *storage);
+        bool (*equal)(const void *lhs, const void *rhs);
+        bool (*memento)(const void *storage, DelegateMemento *memento);
+      };
+
+      template<typename F> struct Ops {
+        static void Copy(void *destination, const void *source) { new (destination) F(*reinterpret_cast<const F *>(source)); }
+        static void Destroy(void *storage) { reinterpret_cast<F *>(storage)->~F(); }
+        static bool Equal(const void *lhs, const void *rhs) { return *reinterpret_cast<const F *>(lhs) == *reinterpret_cast<const F *>(rhs); }
+        static bool Memento(const void *storage, DelegateMemento *memento) { return false; }
+
+        static const OpsTable table;
+      };
+
+      template<typename T> struct Ops<Delegate<T> > {
+        static void Copy(void *destination, const void *source) { new (destination) Delegate<T>(*reinterpret_cast<const Delegate<T> *>(source)); }
+        static void Destroy(void *storage) { }
+        static bool Equal(const void *lhs, const void *rhs) { return *reinterpret_cast<const Delegate<T> *>(lhs) == *reinterpret_cast<const Delegate<T> *>(rhs); }
+        static bool Memento(const void *storage, DelegateMemento *memento) { Delegate<T> copy = *reinterpret_cast<const Delegate<T> *>(storage); *memento = copy.GetMemento(); return true; }
+
+        static const OpsTable table;
+      };
+
+      union Storage {
+        unsigned char bytes[STORAGE_SIZE];
+        double alignDouble;
+        void *alignPointer;
+        void (*alignFunction)();
+      };
+      Storage m_storage;
+      const OpsTable *m_ops;
+    };
+
+    template<typename F> const FunctorBase::OpsTable FunctorBase::Ops<F>::table = { &Copy, &Destroy, &Equal, &Memento };
+    template<typename T> const FunctorBase::OpsTable FunctorBase::Ops<Delegate<T> >::table = { &Copy, &Destroy, &Equal, &Memento };
+  }
+
+  /// Callable wrapper that stores small callables inline, without allocating.
+  /** A Functor can hold a Delegate, a plain function pointer, or any copyable function object up to detail::FunctorBase::STORAGE_SIZE bytes, which is enough for a handful of captured pointers or values. Larger objects are rejected at compile time.
+
+  Functors compare equal if they hold the same type of callable and those callables compare equal, so stored function objects must provide operator==. This is what allows Layout::EventDetach to find a handler given an equivalent Functor.
+  Plain function pointers are stored as Delegates, so a handler attached with a function pointer can be detached with the equivalent Delegate and vice versa.
+
+  The stored callable is invoked through a const Functor but is itself called non-const, so function objects may keep mutable state. */
+  template<typename Signature> class Functor;
+
+  template<typename R> class Functor<R ()> : public detail::FunctorBase {
+  public:
+    /// Function pointer type that can invoke the stored callable given its storage.
+    typedef R (*Invoker)(const void *storage);
+
+    /// Constructs an empty Functor. Calling it is undefined behavior.
+    Functor() : m_invoke(0) { }
+    /// Constructs a Functor from a function pointer.
+    Functor(R (*function)()) : m_invoke(&Invoke<Delegate<R ()> >) { Store(Delegate<R ()>(function)); }
+    /// Constructs a Functor from any small callable.
+    template<typename F> Functor(const F &callable) : m_invoke(&Invoke<F>) { Store(callable); }
+
+    /// Calls the stored callable.
+    R operator()() const { return m_invoke(StorageGet()); }
+
+    /// Returns the function that invokes the stored callable.
+    Invoker InvokerGet() const { return m_invoke; }
+
+  private:
+    template<typename F> static R Invoke(const void *storage) { return (*const_cast<F *>(reinterpret_cast<const F *>(storage)))(); }
+
+    Invoker m_invoke;
+  };
+
+  template<typename R, typename P1> class Functor<R (P1)> : public detail::FunctorBase {
+  public:
+    /// Function pointer type that can invoke the stored callable given its storage.
+    typedef R (*Invoker)(const void *storage, P1 p1);
+
+    /// Constructs an empty Functor. Calling it is undefined behavior.
+    Functor() : m_invoke(0) { }
+    /// Constructs a Functor from a function pointer.
+    Functor(R (*function)(P1)) : m_invoke(&Invoke<Delegate<R (P1)> >) { Store(Delegate<R (P1)>(function)); }
+    /// Constructs a Functor from any small callable.
+    template<typename F> Functor(const F &callable) : m_invoke(&Invoke<F>) { Store(callable); }
+
+    /// Calls the stored callable.
+    R operator()(P1 p1) const { return m_invoke(StorageGet(), p1); }
+
+    /// Returns the function that invokes the stored callable.
+    Invoker InvokerGet() const { return m_invoke; }
+
+  private:
+    template<typename F> static R Invoke(const void *storage, P1 p1) { return (*const_cast<F *>(reinterpret_cast<const F *>(storage)))(p1); }
+
+    Invoker m_invoke;
+  };
+
+  template<typename R, typename P1, typename P2> class Functor<R (P1, P2)> : public detail::FunctorBase {
+  public:
+    /// Function pointer type that can invoke the stored callable given its storage.
+    typedef R (*Invoker)(const void *storage, P1 p1, P2 p2);
+
+    /// Constructs an empty Functor. Calling it is undefined behavior.
+    Functor() : m_invoke(0) { }
+    /// Constructs a Functor from a function pointer.
+    Functor(R (*function)(P1, P2)) : m_invoke(&Invoke<Delegate<R (P1, P2)> >) { Store(Delegate<R (P1, P2)>(function)); }
+    /// Constructs a Functor from any small callable.
+    template<typename F> Functor(const F &callable) : m_invoke(&Invoke<F>) { Store(callable); }
+
+    /// Calls the stored callable.
+    R operator()(P1 p1, P2 p2) const { return m_invoke(StorageGet(), p1, p2); }
+
+    /// Returns the function that invokes the stored callable.
+    Invoker InvokerGet() const { return m_invoke; }
+
+  private:
+    template<typename F> static R Invoke(const void *storage, P1 p1, P2 p2) { return (*const_cast<F *>(reinterpret_cast<const F *>(storage)))(p1, p2); }
+
+    Invoker m_invoke;
+  };
+
+  template<typename R, typename P1, typename P2, typename P3> class Functor<R (P1, P2, P3)> : public detail::FunctorBase {
+  public:
+    /// Function pointer type that can invoke the stored callable given its storage.
+    typedef R (*Invoker)(const void *storage, P1 p1, P2 p2, P3 p3);
+
+    /// Constructs an empty Functor. Calling it is undefined behavior.
+    Functor() : m_invoke(0) { }
+    /// Constructs a Functor from a function pointer.
+    Functor(R (*function)(P1, P2, P3)) : m_invoke(&Invoke<Delegate<R (P1, P2, P3)> >) { Store(Delegate<R (P1, P2, P3)>(function)); }
+    /// Constructs a Functor from any small callable.
+    template<typename F> Functor(const F &callable) : m_invoke(&Invoke<F>) { Store(callable); }
+
+    /// Calls the stored callable.
+    R operator()(P1 p1, P2 p2, P3 p3) const { return m_invoke(StorageGet(), p1, p2, p3); }
+
+    /// Returns the function that invokes the stored callable.
+    Invoker InvokerGet() const { return m_invoke; }
+
+  private:
+    template<typename F> static R Invoke(const void *storage, P1 p1, P2 p2, P3 p3) { return (*const_cast<F *>(reinterpret_cast<const F *>(storage)))(p1, p2, p3); }
+
+    Invoker m_invoke;
+  };
+
+  template<typename R, typename P1, typename P2, typename P3, typename P4> class Functor<R (P1, P2, P3, P4)> : public detail::FunctorBase {
+  public:
+    /// Function pointer type that can invoke the stored callable given its storage.
+    typedef R (*Invoker)(const void *storage, P1 p1, P2 p2, P3 p3, P4 p4);
+
+    /// Constructs an empty Functor. Calling it is undefined behavior.
+    Functor() : m_invoke(0) { }
+    /// Constructs a Functor from a function pointer.
+    Functor(R (*function)(P1, P2, P3, P4)) : m_invoke(&Invoke<Delegate<R (P1, P2, P3, P4)> >) { Store(Delegate<R (P1, P2, P3, P4)>(function)); }
+    /// Constructs a Functor from any small callable.
+    template<typename F> Functor(const F &callable) : m_invoke(&Invoke<F>) { Store(callable); }
+
+    /// Calls the stored callable.
+    R operator()(P1 p1, P2 p2, P3 p3, P4 p4) const { return m_invoke(StorageGet(), p1, p2, p3, p4); }
+
+    /// Returns the function that invokes the stored callable.
+    Invoker InvokerGet() const { return m_invoke; }
+
+  private:
+    template<typename F> static R Invoke(const void *storage, P1 p1, P2 p2, P3 p3, P4 p4) { return (*const_cast<F *>(reinterpret_cast<const F *>(storage)))(p1, p2, p3, p4); }
+
+    Invoker m_invoke;
+  };
+}
+
+#endif
@@ -267,6 +267,8 @@ namespace Frames {
       bool Process(const EnvironmentPtr &env) const;
         
     private:
+      friend class Sequence; // for Coalesce
+
       Type m_type;
 
       // Union everything that can be unioned
@@ -295,6 +297,13 @@ namespace Frames {
       /// Adds a Command to the end of this Sequence.
       void Queue(const Command &element);
 
+      /// Merges redundant runs of Commands in place.
+      /** Runs of adjacent MOUSEMOVE Commands collapse to the last one, runs of adjacent MOUSEWHEEL Commands collapse to one with the summed delta, and runs of adjacent KEYTEXT Commands collapse to one with the concatenated text.
+      Any other Command ends a run, so button and key boundaries, as well as meta changes, are seen by the Environment exactly as they were queued.
+
+      This is opt-in because it does change what handlers see; a MouseMove handler will not see intermediate positions, for example. Call it just before Process() when feeding high-frequency input devices. */
+      void Coalesce();
+
       /// Processes all Commands in order.
       /** There is no way to detect whether a specific Command was consumed by the Environment or not; if you need this functionality, you should Process the Commands on your own. */
       void Process(Environment *env) const;
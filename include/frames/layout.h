@@ -24,7 +24,9 @@
 #include "frames/detail.h"
 #include "frames/event.h"
 #include "frames/input.h"
+#include "frames/name_table.h"
 #include "frames/noncopyable.h"
+#include "frames/slab_heap.h"
 #include "frames/vector.h"
 
 #include "boost/static_assert.hpp"
@@ -43,6 +45,7 @@ namespace Frames {
   template <typename T> const T *Cast(const Layout *layout);
 
   namespace detail {
+    class BinaryWriter;
     class Renderer;
     class Rtti;
 
@@ -167,23 +170,24 @@ namespace Frames {
     // Sort classes that need internal access
     friend struct detail::FrameOrderSorter;
     friend struct detail::LayoutIdSorter;
+
+    // Serialization needs to see pins as they were set
+    friend class detail::BinaryWriter;
     
     // Event system
     
     // Must function properly when copied by value!
     struct Callback {
     public:
-      // NOTE: this works because delegate is POD
-      Callback() : m_priority(0), m_destroy(false), m_lock(0) { }
+      Callback() : m_invoke(0), m_priority(0), m_destroy(false), m_lock(0) { }
       ~Callback() { }
       
-      template<typename T> static Callback CreateNative(Delegate<T> din, float priority) {
-        BOOST_STATIC_ASSERT(sizeof(Delegate<T>) == sizeof(Delegate<void ()>));
-        
+      template<typename T> static Callback CreateNative(const Functor<T> &fin, float priority) {
         Callback rv;
         rv.m_priority = priority;
 
-        rv.DelegateGet<T>() = din;
+        rv.m_functor = fin;
+        rv.m_invoke = reinterpret_cast<void (*)()>(fin.InvokerGet());  // function pointers survive a round trip through any other function pointer type
         
         return rv;
       }
@@ -193,16 +197,18 @@ namespace Frames {
       };
       
       void Call(Handle *eh) const {
-        DelegateGet<void(Handle *)>()(eh);
+        reinterpret_cast<Functor<void (Handle *)>::Invoker>(m_invoke)(m_functor.StorageGet(), eh);
       }
       
       template <typename P1> void Call(Handle *eh, P1 p1) const {
-        DelegateGet<void(Handle *, P1)>()(eh, p1);
+        reinterpret_cast<typename Functor<void (Handle *, P1)>::Invoker>(m_invoke)(m_functor.StorageGet(), eh, p1);
       }
       
-      template<typename T> bool NativeCallbackEqual(Delegate<T> din) const {
-        return *reinterpret_cast<const Delegate<T> *>(&m_delegate) == din;
+      template<typename T> bool NativeCallbackEqual(const Functor<T> &fin) const {
+        return m_functor == fin;
       }
+
+      const detail::FunctorBase &FunctorGet() const { return m_functor; }
       
       float PriorityGet() const { return m_priority; }
       
@@ -213,17 +219,14 @@ namespace Frames {
       void LockFlagIncrement() const { ++m_lock; }  // must store result and pass it to LockFlagDecrement
       void LockFlagDecrement() const { --m_lock; }
       
+      Callback CloneGet() const;  // a fresh copy of the handler, without any of our dispatch state
+
       void Teardown(Environment *env) const;  // cleans up the underlying resources, if any. Not the same as a destructor! This isn't RAII for efficiency reasons. Environment provided for debug hooks.
       
     private:
-      // the delegate itself - this is not the right type, it is casted appropriately by DelegateGet
-      Delegate<void()> m_delegate;
-      template<typename T> Delegate<T> &DelegateGet() {
-        return reinterpret_cast<Delegate<T> &>(m_delegate);
-      }
-      template<typename T> const Delegate<T> &DelegateGet() const {
-        return reinterpret_cast<const Delegate<T> &>(m_delegate);
-      }
+      // the handler itself, with its signature erased; m_invoke is the matching Functor's Invoker, casted back appropriately by Call
+      detail::FunctorBase m_functor;
+      void (*m_invoke)();
 
       float m_priority;
       
@@ -232,8 +235,49 @@ namespace Frames {
       mutable int m_lock;
     };
     
-    typedef std::multiset<Callback, Callback::Sorter> EventMultiset;
-    typedef std::map<const VerbGeneric *, std::multiset<Callback, Callback::Sorter> > EventLookup;
+    typedef std::multiset<Callback, Callback::Sorter, detail::SlabAllocator<Callback> > EventMultiset;
+
+    // Flat table of handler sets, sorted by verb index. The sets themselves live on the heap so that iterators held during dispatch survive the table growing.
+    class EventLookup : detail::Noncopyable {
+    public:
+      struct Entry {
+        const VerbGeneric *verb;
+        EventMultiset *callbacks;
+      };
+      typedef std::vector<Entry>::const_iterator const_iterator;
+
+      explicit EventLookup(detail::SlabHeap *heap) : m_heap(heap) { }
+      ~EventLookup() { Clear(); }
+
+      EventMultiset *Find(const VerbGeneric *verb) const;
+      EventMultiset &Get(const VerbGeneric *verb);  // creates the set if it doesn't exist
+      void Erase(const VerbGeneric *verb);
+      void Clear();
+
+      bool Empty() const { return m_entries.empty(); }
+      const_iterator begin() const { return m_entries.begin(); }
+      const_iterator end() const { return m_entries.end(); }
+
+    private:
+      std::vector<Entry>::iterator LowerBound(const VerbGeneric *verb);
+      void SetDestroy(EventMultiset *callbacks);
+      std::vector<Entry> m_entries;
+      detail::SlabHeap *m_heap;  // where the sets and their nodes live
+    };
+
+    // Which verbs have handlers, as a bitmask over verb indices. Indices wrap around, so a set bit only means "maybe", but a clear bit is a guaranteed "no" without touching the table.
+    struct EventMask {
+      enum { WORDS = 4, BITS = WORDS * 32 };
+
+      EventMask() { Clear(); }
+
+      void Clear() { for (int i = 0; i < WORDS; ++i) bits[i] = 0; }
+      void Merge(const EventMask &rhs) { for (int i = 0; i < WORDS; ++i) bits[i] |= rhs.bits[i]; }
+      void Set(unsigned int index) { bits[(index % BITS) / 32] |= 1u << (index % 32); }
+      bool Test(unsigned int index) const { return (bits[(index % BITS) / 32] & (1u << (index % 32))) != 0; }
+
+      unsigned int bits[WORDS];
+    };
     
     class CallbackIterator : detail::Noncopyable {
     public:
@@ -257,8 +301,16 @@ namespace Frames {
       enum State { STATE_DIVE, STATE_MAIN, STATE_BUBBLE, STATE_COMPLETE };
       State m_state;
       
-      std::vector<Layout *> m_dives;
+      // The target's ancestry, target first, or nothing if no layout in it hooks the Dive or Bubble verb. Lives in m_divesInline unless the hierarchy is unusually deep.
+      void DiveGather();
+      void DivePush(Layout *layout);
+      enum { DIVES_INLINE = 16 };
+      Layout *m_divesInline[DIVES_INLINE];
+      std::vector<Layout *> m_divesOverflow;
+      Layout **m_dives;
+      int m_diveCount;
       int m_diveIndex;
+      unsigned int m_diveGeneration;  // Environment::m_eventMaskGeneration as of the last DiveGather()
       
       Layout *m_target;
       const VerbGeneric *m_event;
@@ -271,7 +323,7 @@ namespace Frames {
     // --------- Identification
 
     /// Returns the name of this layout.
-    const std::string &NameGet() const { return m_name; }
+    const std::string &NameGet() const { return m_name->text; }
 
     // --------- Layout accessors
 
@@ -348,13 +400,13 @@ namespace Frames {
     Layout *ParentGet() const { return m_parent; }
 
     /// Returns the layout underneath a given coordinate as if it were mouse input.
-    /** This can be used to find out what frame would be hit by a mouse event at a certain coordinate. */
+    /** This can be used to find out what frame would be hit by a mouse event at a certain coordinate. The coordinate is taken to be after our ancestors' render transforms have been undone, which for the root is simply screen space. */
     Layout *ProbeAsMouse(float x, float y) const;
 
     // RetrieveHeight/RetrieveWidth/RetrievePoint/etc?
 
     /// Type used to store a list of children, sorted from bottom to top. Conforms to std::set's interface; may not be a std::set.
-    typedef std::set<Frame *, detail::FrameOrderSorter> ChildrenList;
+    typedef std::set<Frame *, detail::FrameOrderSorter, detail::SlabAllocator<Frame *> > ChildrenList;
 
     /// Returns the children of this frame.
     /** Does not include implementation-flagged children. */
@@ -376,6 +428,12 @@ namespace Frames {
     Includes only implementation-flagged children. */
     Frame *ChildImplementationGetByName(const std::string &name) const;
 
+    /// Returns a descendant of this frame given a path of names separated by periods, as in "Panel.List.Row".
+    /** Returns null if any step of the path fails to match. Each step follows the same rules as ChildGetByName(), so implementation-flagged children are not included.
+
+    Names are interned and parents with many children keep an index of them, so this takes time proportional to the length of the path, not the number of children along the way. */
+    Frame *FindByPath(const std::string &path) const;
+
     // --------- State
 
     /// Sets the visibility flag.
@@ -384,13 +442,60 @@ namespace Frames {
     /// Gets the visibility flag.
     bool VisibleGet() const { return m_visible; }
 
+    /// Sets a translation applied when rendering, in pixels.
+    /** Render transforms change only how this frame and its descendants are drawn and hit-tested. Layout is untouched: LeftGet() and friends still return untransformed values, nothing is invalidated, and no Move or Size events fire. That makes them cheap enough to animate every frame.
+    
+    Transforms nest; a child's transform applies on top of its parent's. */
+    void RenderTranslationSet(const Vector &translation);
+    /// Gets the render translation.
+    const Vector &RenderTranslationGet() const { return m_renderTranslation; }
+    /// Sets a uniform scale applied when rendering, about this frame's center.
+    /** Must be greater than zero. See RenderTranslationSet for details. */
+    void RenderScaleSet(float scale);
+    /// Gets the render scale.
+    float RenderScaleGet() const { return m_renderScale; }
+    /// Sets an opacity multiplier applied when rendering this frame and its descendants.
+    /** See RenderTranslationSet for details. */
+    void RenderOpacitySet(float opacity);
+    /// Gets the render opacity multiplier.
+    float RenderOpacityGet() const { return m_renderOpacity; }
+
     // --------- Events
 
+    /// Identifies one specific attached handler.
+    /** Returned by EventAttach. Passing it to EventDetach removes exactly that handler without searching for it.
+
+    A token is only meaningful until its handler is detached, by any means, or its layout is destroyed; using it after that point is undefined behavior. A default-constructed token refers to nothing and is ignored by EventDetach. */
+    class EventToken {
+    public:
+      /// Constructs a token that refers to nothing.
+      EventToken() : m_layout(0), m_verb(0) { }
+
+      /// Returns true if this token refers to a handler.
+      bool ValidGet() const { return m_layout != 0; }
+
+    private:
+      friend class Layout;
+      EventToken(Layout *layout, const VerbGeneric *verb, EventMultiset::iterator callback) : m_layout(layout), m_verb(verb), m_callback(callback) { }
+
+      Layout *m_layout;
+      const VerbGeneric *m_verb;
+      EventMultiset::iterator m_callback;
+    };
+
     /// Attaches a handler to a verb on this layout.
-    template <typename Parameters> void EventAttach(const Verb<Parameters> &event, typename Verb<Parameters>::TypeDelegate handler, float priority = 0.0);
+    /** Returns a token that can later be passed to EventDetach. Keeping it is optional; handlers can also be detached by value.
+    
+    The handler can be a Delegate, a plain function pointer, or a small function object; see Functor for the details. None of these allocate memory beyond the handler's slot in the event table. */
+    template <typename Parameters> EventToken EventAttach(const Verb<Parameters> &event, const typename Verb<Parameters>::TypeFunctor &handler, float priority = 0.0);
     /// Detaches a handler from a verb on this layout.
-    /** If priority is detail::Undefined, picks a matching handler of any priority. Otherwise, picks a matching handler with that exact priority. */
-    template <typename Parameters> void EventDetach(const Verb<Parameters> &event, typename Verb<Parameters>::TypeDelegate handler, float priority = detail::Undefined);
+    /** If priority is detail::Undefined, picks a matching handler of any priority. Otherwise, picks a matching handler with that exact priority.
+
+    This searches every handler attached to the verb; if you're attaching and detaching many handlers on a single verb, keep the EventToken and use that instead. */
+    template <typename Parameters> void EventDetach(const Verb<Parameters> &event, const typename Verb<Parameters>::TypeFunctor &handler, float priority = detail::Undefined);
+    /// Detaches the handler identified by an EventToken.
+    /** Constant-time. Obeys the same rules as any other detach; if the handler is in the middle of being called, it is removed once the call is done. The token must have come from this layout. */
+    void EventDetach(const EventToken &token);
     
     /// Triggers all attached handlers for a given verb.
     inline void EventTrigger(const Verb<void ()> &event);
@@ -416,6 +521,17 @@ namespace Frames {
     /// Returns this layout's environment.
     Environment *EnvironmentGet() const { return m_env; }
 
+    // --------- Allocation
+
+    /// Allocates a layout out of an environment's slabs.
+    /** Create() functions should use this, as "new (parent->EnvironmentGet()) MyFrame(parent, name)", so that building and destroying large hierarchies doesn't spend its time in the system allocator. */
+    static void *operator new(std::size_t bytes, Environment *env);
+    /// Allocates a layout from the system heap.
+    /** Plain "new" still works for frame types that don't pass an environment along; they just miss out on the slabs. */
+    static void *operator new(std::size_t bytes);
+    static void operator delete(void *block);
+    static void operator delete(void *block, Environment *env);  // only called if a constructor throws
+
     // --------- Debug
 
     /// Dumps comprehensive layout information to the debug log.
@@ -435,6 +551,25 @@ namespace Frames {
     /// Set default height. See SizeDefaultSet for details.
     void HeightDefaultSet(float size) { return SizeDefaultSet(Y, size); }
 
+    /// Requests a call to ArrangeDeferred() before any layout is next resolved or queried.
+    /** Intended for frame types that position other frames themselves. Requests are merged until the call happens, so it's fine to request on every change and do the work once. */
+    void ArrangeQueue();
+    /// Called some time after ArrangeQueue(), before any layout is resolved or queried.
+    /** Overload this to position frames in bulk. Layout may be freely read and changed from inside this call. */
+    virtual void ArrangeDeferred() { }
+
+    /// Maps each layout in a prototype subtree to its clone. See Frame::CloneSubtree.
+    typedef std::map<const Layout *, Layout *> CloneMap;
+    /// Creates an empty frame of the same type as this one, for Frame::CloneSubtree.
+    /** Overload this in every frame type that should be clonable. It should construct a new instance under the given parent with the same name, and nothing more; everything else is copied afterwards. The base version logs an error and returns null. */
+    virtual Frame *CloneCreate(Layout *parent) const;
+    /// Copies this frame's own state onto a clone created by CloneCreate().
+    /** Called once every layout in the subtree has been created and given its pins, sizes and handlers, so "clones" can be used to find the clone of any other layout in the prototype. Overload this to copy state that belongs to your frame type. Must call (super)::CloneCopy before it does its own work. */
+    virtual void CloneCopy(Layout *clone, const CloneMap &clones) const { }
+    /// Determines whether a child is cloned along with this frame.
+    /** Overload this to leave out children that the frame creates and manages on its own. */
+    virtual bool CloneChildTest(const Layout *child) const { return true; }
+
     /// Called when this frame is rendered.
     /** Overload this to create your own frame types. Must call (super)::RenderElement before it does its own work.
     
@@ -502,7 +637,7 @@ namespace Frames {
 
     void zinternalParentSet(Layout *layout);
 
-    void zinternalNameSet(const std::string &name) { m_name = name; }
+    void zinternalNameSet(const std::string &name);
 
     void zinternalLayerSet(float layer);
     float zinternalLayerGet() const { return m_layer; }
@@ -510,14 +645,26 @@ namespace Frames {
     void zinternalImplementationSet(bool implementation);
     bool zinternalImplementationGet() const { return m_implementation; }
 
+    bool zinternalVisibleChainGet() const;  // true if we and all our ancestors are visible
+
     void zinternalObliterate();
 
+    Frame *zinternalCloneSubtree(Layout *parent) const;
+
     // Layout utility
     void ChildAdd(Frame *child);
     void ChildRemove(Frame *child);
+    Frame *ChildGetByNameInterned(const detail::Name *name, bool implementation) const;
+    void CloneGather(std::vector<const Layout *> *prototypes) const;  // appends us and every clonable descendant, parents before children
+    void CloneCopyLayout(Layout *clone, const CloneMap &clones) const;  // copies pins, sizes, flags and handlers, remapping anything inside the prototype
 
     // Rendering
     void Render(detail::Renderer *renderer) const;
+    bool RenderTransformGet() const { return m_renderTranslation.x != 0 || m_renderTranslation.y != 0 || m_renderScale != 1 || m_renderOpacity != 1; }
+    void RenderTransformChanged(bool previous);
+    void RenderTransformPush(detail::Renderer *renderer) const;
+    void RenderTransformPop(detail::Renderer *renderer) const;
+    Vector RenderTransformInverse(const Vector &point) const;  // maps a point in our parent's render space to our own layout space
 
     // Mask-related
     void MouseMaskingFullSet(bool mask) { m_fullMouseMasking = mask; }
@@ -526,11 +673,18 @@ namespace Frames {
 
     // Layout engine - note that this is used heavily by Frame!
     void Invalidate(Axis axis);
-    void ObliterateDetach(); // Detach this layout from all layouts
-    void ObliterateExtract();  // Detach everything that refers to this layout
-    void ObliterateExtractAxis(Axis axis);  // Detach everything that refers to this axis
+    void InvalidateShift(Axis axis); // Like Invalidate, but for when every point on the axis has moved by the same amount; recomputes caches in place where it can
+    bool InvalidateShiftPure(Axis axis, const Layout *target) const; // Whether every point we have on this axis is pinned to target
+    void ObliterateDetach(); // Fires Destroy and clears events, for us and all our children
+    void ObliterateMark(std::vector<Layout *> *doomed);  // Flags us and all our children as going, appending each to doomed
+    void ObliterateUnlinkTargets();  // Drops our pins, touching only targets that aren't going themselves
+    void ObliterateUnlinkDependents();  // Clears pins to us from layouts that aren't going
     void ObliterateExtractFrom(Axis axis, const Layout *layout);
     void Resolve();
+    void ResolveNotify(); // Fires Size/Move if we've changed since the last notification
+    bool ResolveEagerGet() const; // Whether Resolve() needs our geometry now, rather than leaving it for whoever asks first
+    bool ResolveCachedGet() const; // Whether every cache our getters would fill is already filled, so querying us only reads
+    void ResolveEagerPrepare(const VerbGeneric *event); // Called before a handler is attached, in case it makes us eager
     struct AxisData {
       AxisData() : size_cached(detail::Undefined), size_set(detail::Undefined), size_default(detail::SizeDefault) {};
 
@@ -556,10 +710,16 @@ namespace Frames {
     };
     AxisData m_axes[2];
     mutable bool m_resolved;  // whether *this* frame has its layout completely determined
+    Layout *m_resolveParked;  // while unresolved and hidden, the hidden layout we're parked under in the environment instead of sitting in its invalidated list
+    mutable int m_resolveComponent;  // scratch for the environment's parallel resolve; -1 outside it
+    unsigned char m_batchPending; // bitmask of axes whose invalidation is deferred by Environment::LayoutBatchBegin()
 
     // Layout events
-    mutable float m_last_width, m_last_height;
+    mutable float m_last_width, m_last_height;  // as of the last Size/Move notification
     mutable float m_last_x, m_last_y;
+    bool m_notifyQueued;  // whether we're waiting in the environment's Size/Move queue
+    bool m_arrangeQueued;  // whether we're waiting in the environment's ArrangeDeferred queue
+    bool m_obliterating;  // part of a subtree in the middle of being obliterated
 
     // Layer/parenting engine
     float m_layer;
@@ -567,6 +727,9 @@ namespace Frames {
     unsigned int m_constructionOrder; // This is used to create consistent results when frames are Z-conflicting
     Layout *m_parent;
     bool m_visible;
+    Vector m_renderTranslation;
+    float m_renderScale;
+    float m_renderOpacity;
     ChildrenList m_children;  // Authoritative
     ChildrenList m_children_implementation; // Provided only for ChildrenGet
     ChildrenList m_children_nonimplementation; // Provided only for ChildrenGet
@@ -576,11 +739,29 @@ namespace Frames {
     InputMode m_inputMode;
 
     // Naming system
-    std::string m_name;
+    const detail::Name *m_name;  // interned in the environment's name table
+    enum { CHILD_INDEX_MINIMUM = 16 };  // below this many children, a linear scan of interned names is just as quick
+    // Sorted by name, then in the same order as m_children, so the first child with a given name is a single lower_bound away
+    struct ChildIndexKey {
+      const detail::Name *name;
+      bool implementation;
+      float layer;
+      unsigned int order;
+      bool operator<(const ChildIndexKey &rhs) const;
+    };
+    static ChildIndexKey ChildIndexKeyGet(const Frame *child);
+    typedef std::map<ChildIndexKey, Frame *, std::less<ChildIndexKey>, detail::SlabAllocator<std::pair<const ChildIndexKey, Frame *> > > ChildIndex;
+    mutable ChildIndex *m_childIndex;  // built on the first name lookup once we have enough children, then kept up to date
     
     // Event system
     EventLookup m_events;
-    void EventDestroy(EventLookup::iterator eventTable, EventMultiset::iterator toBeRemoved);
+    EventMask m_eventMask;
+    const EventMask &EventMaskChainGet() const; // our mask merged with all our ancestors'
+    mutable EventMask m_eventMaskChain;
+    mutable unsigned int m_eventMaskChainGeneration;  // compared against Environment::m_eventMaskGeneration
+    void EventDestroy(const VerbGeneric *event, EventMultiset::iterator toBeRemoved);
+    void EventMaskRebuild();
+    void EventProfileRecord(const Handle *handle, const Callback &callback, double start);
 
     // Global environment
     Environment *m_env;
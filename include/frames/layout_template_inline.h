@@ -21,34 +21,41 @@
 #define FRAMES_LAYOUT_TEMPLATE_INLINE
 
 #include "frames/environment.h"
+#include "frames/profiler.h"
 
 #ifndef FRAMES_LAYOUT
 #error Do not include layout_template_inline.h independently!
 #endif
 
 namespace Frames {
-  template <typename Parameters> void Layout::EventAttach(const Verb<Parameters> &event, typename Verb<Parameters>::TypeDelegate handler, float priority /*= 0.0*/) {
-    m_events[&event].insert(Callback::CreateNative(handler, priority));
+  template <typename Parameters> Layout::EventToken Layout::EventAttach(const Verb<Parameters> &event, const typename Verb<Parameters>::TypeFunctor &handler, float priority /*= 0.0*/) {
+    ResolveEagerPrepare(&event);
+    EventMultiset::iterator callback = m_events.Get(&event).insert(Callback::CreateNative(handler, priority));
+    if (!m_eventMask.Test(event.IndexGet())) {
+      // Only a new bit changes anyone's ancestor summary
+      m_eventMask.Set(event.IndexGet());
+      ++m_env->m_eventMaskGeneration;
+    }
+    return EventToken(this, &event, callback);
   }
     
-  template <typename Parameters> void Layout::EventDetach(const Verb<Parameters> &event, typename Verb<Parameters>::TypeDelegate handler, float priority /*= detail::Undefined*/) {
-    if (!m_events.count(&event)) {
+  template <typename Parameters> void Layout::EventDetach(const Verb<Parameters> &event, const typename Verb<Parameters>::TypeFunctor &handler, float priority /*= detail::Undefined*/) {
+    EventMultiset *eventSet = m_events.Find(&event);
+    if (!eventSet) {
       return;
     }
     
-    std::multiset<Callback, Callback::Sorter> &eventSet = m_events.find(&event)->second;
-    
     // TODO: Make this faster if it ever becomes a bottleneck!
-    for (std::multiset<Callback, Callback::Sorter>::iterator itr = eventSet.begin(); itr != eventSet.end(); ++itr) {
+    for (EventMultiset::iterator itr = eventSet->begin(); itr != eventSet->end(); ++itr) {
       if (!itr->DestroyFlagGet() && itr->NativeCallbackEqual(handler) && (detail::IsUndefined(priority) || itr->PriorityGet() == priority)) {
-        EventDestroy(m_events.find(&event), itr);
+        EventDestroy(&event, itr);
         return;
       }
     }
   }
     
   inline void Layout::EventTrigger(const Verb<void ()> &event) { // static is just so I can keep it in this file
-    if (!m_events.count(&event)) {
+    if (!m_eventMask.Test(event.IndexGet()) || !m_events.Find(&event)) {
       return;
     }
 
@@ -56,16 +63,26 @@ namespace Frames {
     
     Handle eh(this, &event);
     
-    for (CallbackIterator itr(this, &event); !itr.Complete(); itr.Next()) {
-      itr.Setup(&eh);
-      itr.Get().Call(&eh);
+    if (!m_env->m_eventProfiler) {
+      for (CallbackIterator itr(this, &event); !itr.Complete(); itr.Next()) {
+        itr.Setup(&eh);
+        itr.Get().Call(&eh);
+      }
+    } else {
+      Environment::Performance perf(m_env, event.NameGet(), Color(0.8f, 0.7f, 0.2f));
+      for (CallbackIterator itr(this, &event); !itr.Complete(); itr.Next()) {
+        itr.Setup(&eh);
+        double start = detail::Clock();
+        itr.Get().Call(&eh);
+        EventProfileRecord(&eh, itr.Get(), start);
+      }
     }
 
     m_env->ObliterateUnlock();
   }
   
   template <typename P1> void Layout::EventTrigger(const Verb<void (P1)> &event, typename detail::MakeConstRef<P1>::T p1) {
-    if (!m_events.count(&event)) {
+    if (!m_eventMask.Test(event.IndexGet()) || !m_events.Find(&event)) {
       return;
     }
     
@@ -73,9 +90,19 @@ namespace Frames {
 
     Handle eh(this, &event);
         
-    for (CallbackIterator itr(this, &event); !itr.Complete(); itr.Next()) {
-      itr.Setup(&eh);
-      itr.Get().Call<P1>(&eh, p1);
+    if (!m_env->m_eventProfiler) {
+      for (CallbackIterator itr(this, &event); !itr.Complete(); itr.Next()) {
+        itr.Setup(&eh);
+        itr.Get().Call<P1>(&eh, p1);
+      }
+    } else {
+      Environment::Performance perf(m_env, event.NameGet(), Color(0.8f, 0.7f, 0.2f));
+      for (CallbackIterator itr(this, &event); !itr.Complete(); itr.Next()) {
+        itr.Setup(&eh);
+        double start = detail::Clock();
+        itr.Get().Call<P1>(&eh, p1);
+        EventProfileRecord(&eh, itr.Get(), start);
+      }
     }
 
     m_env->ObliterateUnlock();
@@ -47,6 +47,8 @@ namespace Frames {
   private:
     virtual bool MouseMaskingTest(float x, float y) const FRAMES_OVERRIDE;
 
+    virtual Frame *CloneCreate(Layout *parent) const FRAMES_OVERRIDE;
+
     virtual void RenderElementPreChild(detail::Renderer *renderer) const FRAMES_OVERRIDE;
     virtual void RenderElementPostChild(detail::Renderer *renderer) const FRAMES_OVERRIDE;
   };
@@ -0,0 +1,62 @@
+/*  Copyright 2014 Mandible Games
+    
+    This file is part of Frames.
+    
+    Please see the COPYING file for detailed licensing information.
+    
+    Frames is dual-licensed software. It is available under both a
+    commercial license, and also under the terms of the GNU General
+    Public License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    Frames is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Frames.  If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef FRAMES_NAME_TABLE
+#define FRAMES_NAME_TABLE
+
+#include <string>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
+
+#include "frames/noncopyable.h"
+
+namespace Frames {
+  namespace detail {
+    /// A name interned in a NameTable.
+    /** Equal names from the same table are always the same object, so they can be compared by address. */
+    struct Name {
+      std::string text;
+      mutable unsigned int references;
+    };
+
+    /// Hashed, reference-counted table of layout names.
+    /** Names repeat a lot ("Row", "Icon", "Label"), so each distinct name is stored once and shared between every layout that uses it. A name is removed once the last layout using it is renamed or destroyed. */
+    class NameTable : Noncopyable {
+    public:
+      NameTable() { }
+      ~NameTable() { }
+
+      /// Returns the shared copy of a name, adding a reference to it.
+      const Name *Intern(const std::string &text);
+      /// Drops a reference added by Intern().
+      void Release(const Name *name);
+
+      /// Returns the shared copy of a name without adding a reference, or null if nothing uses that name.
+      const Name *Find(const std::string &text) const;
+
+    private:
+      typedef boost::multi_index_container<Name, boost::multi_index::indexed_by<boost::multi_index::hashed_unique<boost::multi_index::member<Name, std::string, &Name::text> > > > Table;
+      Table m_names;
+    };
+  }
+}
+
+#endif
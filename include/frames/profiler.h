@@ -0,0 +1,152 @@
+/*  Copyright 2014 Mandible Games
+    
+    This file is part of Frames.
+    
+    Please see the COPYING file for detailed licensing information.
+    
+    Frames is dual-licensed software. It is available under both a
+    commercial license, and also under the terms of the GNU General
+    Public License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    Frames is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Frames.  If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef FRAMES_PROFILER
+#define FRAMES_PROFILER
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "frames/config_cc.h"
+#include "frames/configuration.h"
+#include "frames/delegate.h"
+#include "frames/functor.h"
+#include "frames/noncopyable.h"
+
+namespace Frames {
+  class VerbGeneric;
+
+  namespace Configuration {
+    /// Performance module that records every block for export as a Chrome trace.
+    /** The result of ChromeTraceGet() can be loaded directly into chrome://tracing or any compatible viewer.
+    Names are stored by pointer, not copied, so they must outlive the recording. Everything Frames itself passes in is a string literal or a Verb name, both of which qualify.
+    
+    Recording grows without bound until Clear() is called. */
+    class PerformanceTrace : public Performance {
+    public:
+      PerformanceTrace() { }
+      virtual ~PerformanceTrace() { }
+
+      virtual void *Push(const char *name, Color color) FRAMES_OVERRIDE;
+      virtual void Pop(void *handle) FRAMES_OVERRIDE;
+
+      /// Returns everything recorded so far in Chrome's trace event JSON format.
+      /** Blocks that have been pushed but not yet popped are omitted. */
+      std::string ChromeTraceGet() const;
+
+      /// Discards everything recorded so far.
+      /** Must not be called while any block is open. */
+      void Clear() { m_blocks.clear(); }
+
+    private:
+      struct Block {
+        const char *name;
+        double start;
+        double end;
+      };
+      std::vector<Block> m_blocks;
+    };
+    /// Refcounted PerformanceTrace typedef.
+    typedef Ptr<PerformanceTrace> PerformanceTracePtr;
+  }
+
+  /// Collects timing statistics for event handlers.
+  /** Created through Environment::EventProfilerSet. Every handler call is counted and timed, then filed under the verb it was called for, the type of the layout it was attached to, and the handler itself.
+  Dive and Bubble calls are filed under the Dive or Bubble verb, not the main verb.
+
+  While a profiler is active, each event dispatch is also reported as a block to the Environment's Configuration::Performance module, named after the verb, so dispatches show up alongside the rest of the frame in tools like Configuration::PerformanceTrace. */
+  class EventProfiler : detail::Noncopyable {
+  public:
+    /// Number of buckets in each histogram.
+    /** Bucket 0 counts calls that took less than one microsecond. Each bucket after that covers twice the range of the one before, so bucket N counts calls taking [2^(N-1), 2^N) microseconds; the last bucket also counts anything slower. */
+    static const int HISTOGRAM_BUCKETS = 24;
+
+    /// Category that statistics are grouped by.
+    enum Category {
+      CATEGORY_VERB, ///< Group by the verb that was called.
+      CATEGORY_TYPE, ///< Group by the type name of the layout the handler was attached to.
+      CATEGORY_HANDLER, ///< Group by the handler.
+      CATEGORY_COUNT,
+    };
+
+    /// Statistics for a single verb, layout type, or handler.
+    struct Entry {
+      Entry() : verb(0), type(0), count(0), total(0), max(0) { for (int i = 0; i < HISTOGRAM_BUCKETS; ++i) histogram[i] = 0; }
+
+      /// Verb this entry describes. Only valid for CATEGORY_VERB.
+      const VerbGeneric *verb;
+      /// Layout type this entry describes, as returned by Layout::TypeGet(). Only valid for CATEGORY_TYPE.
+      const char *type;
+      /// Handler this entry describes. Only valid for CATEGORY_HANDLER; compare it against Delegate::GetMemento() to identify a handler.
+      /** Handlers that aren't Delegates have no memento; they're left empty here, and grouped by the type of function object instead. */
+      DelegateMemento handler;
+
+      /// Number of handler calls.
+      int count;
+      /// Total time spent in handler calls, in seconds.
+      double total;
+      /// Slowest single handler call, in seconds.
+      double max;
+      /// Call durations; see HISTOGRAM_BUCKETS.
+      int histogram[HISTOGRAM_BUCKETS];
+    };
+
+    /// Retrieves the most expensive entries in a category.
+    /** Entries are sorted by total time, most expensive first. At most count entries are returned; pass -1 for all of them. */
+    void TopGet(Category category, int count, std::vector<Entry> *results) const;
+
+    /// Returns a human-readable summary of the most expensive entries in every category.
+    /** Delegate handlers are labeled "object::function", with the bound object and the function's address; match those up against a symbol map or debugger. Other function objects are grouped by type, with no further label. */
+    std::string ReportGet(int count) const;
+
+    /// Discards all statistics gathered so far.
+    void Reset();
+
+  private:
+    friend class Environment;
+    friend class Layout;
+
+    EventProfiler() { }
+    ~EventProfiler() { }
+
+    void Record(const VerbGeneric *verb, const char *type, const detail::FunctorBase &handler, double seconds);
+    static void RecordEntry(Entry *entry, double seconds);
+
+    // Functor type, then memento; the memento only distinguishes anything for Delegates
+    typedef std::pair<const void *, DelegateMemento> HandlerKey;
+    struct HandlerKeySorter {
+      bool operator()(const HandlerKey &lhs, const HandlerKey &rhs) const {
+        if (lhs.first != rhs.first) return lhs.first < rhs.first;
+        return lhs.second.IsLess(rhs.second);
+      }
+    };
+
+    std::map<const VerbGeneric *, Entry> m_verbs;
+    std::map<const char *, Entry> m_types;
+    std::map<HandlerKey, Entry, HandlerKeySorter> m_handlers;
+  };
+
+  namespace detail {
+    /// Returns a monotonic timestamp in seconds, with an arbitrary epoch.
+    double Clock();
+  }
+}
+
+#endif
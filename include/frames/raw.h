@@ -50,6 +50,9 @@ namespace Frames {
 
     /// Renders the Raw and fires the appropriate event.
     virtual void RenderElement(detail::Renderer *renderer) const FRAMES_OVERRIDE;
+
+    /// Creates an empty Raw. See Layout::CloneCreate for inheritance info.
+    virtual Frame *CloneCreate(Layout *parent) const FRAMES_OVERRIDE;
   };
 }
 
@@ -32,6 +32,7 @@
 namespace Frames {
   class Environment;
   struct Rect;
+  class Snapshot;
   class Texture;
   typedef Ptr<Texture> TexturePtr;
 
@@ -93,8 +94,8 @@ namespace Frames {
       virtual void Begin(int width, int height);
       virtual void End();
 
-      virtual Vertex *Request(int quads) = 0;
-      virtual void Return(int quads = -1) = 0;  // also renders, count lets you optionally specify the number of quads
+      Vertex *Request(int quads);
+      void Return(int quads = -1);  // also renders, count lets you optionally specify the number of quads
 
       virtual TextureBackingPtr TextureCreate(int width, int height, Texture::Format mode) = 0;
       virtual TextureBackingPtr TextureCreate(const Texture::ContextualPtr &contextual);  // default implementation errors and returns 0
@@ -106,6 +107,11 @@ namespace Frames {
       void AlphaPush(float alpha);
       float AlphaGet() const;
       void AlphaPop();
+
+      // Maps every vertex position p to (p * scale + offset), composed with whatever transform is already active; applied as vertices are returned
+      void TransformPush(float scale, const Vector &offset);
+      void TransformPop();
+      Vector TransformApply(const Vector &point) const;
     
       static bool WriteCroppedRect(Vertex *vertex, const Rect &screen, const Color &color, const Rect &bounds); // no fancy lerping
       static bool WriteCroppedTexRect(Vertex *vertex, const Rect &screen, const Rect &tex, const Color &color, const Rect &bounds);  // fancy lerping
@@ -118,6 +124,9 @@ namespace Frames {
       int HeightGet() { return m_height; }
 
     private:
+      // Replays scissors exactly as they were recorded, bypassing the stack
+      friend class Frames::Snapshot;
+
       Environment *m_env; // just for debug functionality
 
       int m_width;
@@ -127,6 +136,18 @@ namespace Frames {
       std::stack<Rect> m_scissor;
 
       std::vector<float> m_alpha; // we'll only really allocate it once
+
+      // What Request and Return actually do, minus transforms
+      virtual Vertex *BufferRequest(int quads) = 0;
+      virtual void BufferReturn(int quads) = 0;
+
+      struct Transform {
+        float scale;
+        Vector offset;
+      };
+      std::vector<Transform> m_transform;  // empty when untransformed, so the common case hands out backend memory directly
+      std::vector<Vertex> m_transformStaging;  // vertices are written here while a transform is active, then copied to the backend as they're transformed
+      int m_transformStagingQuads;
     };
   }
 }
@@ -58,9 +58,6 @@ namespace Frames {
       virtual void Begin(int width, int height) FRAMES_OVERRIDE;
       virtual void End() FRAMES_OVERRIDE;
 
-      virtual Vertex *Request(int quads) FRAMES_OVERRIDE;
-      virtual void Return(int quads = -1) FRAMES_OVERRIDE;  // also renders, count lets you optionally specify the number of quads
-
       virtual TextureBackingPtr TextureCreate(int width, int height, Texture::Format mode) FRAMES_OVERRIDE;
       virtual void TextureSet(const TextureBackingPtr &tex) FRAMES_OVERRIDE;
 
@@ -95,6 +92,9 @@ namespace Frames {
 
       virtual void ScissorSet(const Rect &rect) FRAMES_OVERRIDE;
 
+      virtual Vertex *BufferRequest(int quads) FRAMES_OVERRIDE;
+      virtual void BufferReturn(int quads) FRAMES_OVERRIDE;  // also renders, quads may be -1 to return everything from the last request
+
       GLuint CompileShader(int shaderType, const GLchar *data, const char *readabletype);
     };
   }
@@ -0,0 +1,134 @@
+/*  Copyright 2014 Mandible Games
+    
+    This file is part of Frames.
+    
+    Please see the COPYING file for detailed licensing information.
+    
+    Frames is dual-licensed software. It is available under both a
+    commercial license, and also under the terms of the GNU General
+    Public License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    Frames is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Frames.  If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef FRAMES_SLAB_HEAP
+#define FRAMES_SLAB_HEAP
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+#include "frames/config.h"
+#include "frames/noncopyable.h"
+
+namespace Frames {
+  namespace detail {
+    /// Size-class slab allocator for the small, short-lived objects an Environment churns through.
+    /** Requests are rounded up to a size class and carved out of large slabs; freed blocks go onto a per-class free list for reuse. Slabs are only handed back to the system when the heap is destroyed, so tearing down a large hierarchy costs one free-list push per object, and building the next one reuses the same memory.
+    
+    Requests too large for any size class go straight to the system heap. Defining FRAMES_SLAB_HEAP_DISABLED in config.h sends everything there, for the sake of memory debugging tools. */
+    class SlabHeap : Noncopyable {
+    public:
+      SlabHeap();
+      ~SlabHeap();
+
+      /// Allocates a block of at least the given size.
+      void *Allocate(std::size_t bytes);
+      /// Frees a block; must be given the same size it was allocated with.
+      void Free(void *block, std::size_t bytes);
+
+      /// Number of blocks currently allocated.
+      unsigned int LiveGet() const { return m_live; }
+      /// Bytes currently allocated, after rounding up to size classes.
+      std::size_t LiveBytesGet() const { return m_liveBytes; }
+      /// Bytes currently allocated that bypassed the slabs.
+      std::size_t OversizeBytesGet() const { return m_oversizeBytes; }
+      /// Bytes held in slabs, whether allocated or not.
+      std::size_t ReservedBytesGet() const { return m_slabs.size() * SLAB_BYTES; }
+      /// Number of slabs held.
+      unsigned int SlabCountGet() const { return (unsigned int)m_slabs.size(); }
+      /// Total allocations made over the heap's lifetime.
+      unsigned int AllocationCountGet() const { return m_allocations; }
+
+    private:
+      enum {
+        GRANULARITY = 16,
+        CLASS_COUNT = 64,  // so the largest class is 1024 bytes, comfortably bigger than any of the built-in frame types
+        SLAB_BYTES = 64 * 1024
+      };
+
+      struct FreeBlock {
+        FreeBlock *next;
+      };
+
+      static int ClassGet(std::size_t bytes) { return (int)((bytes + GRANULARITY - 1) / GRANULARITY) - 1; }
+
+      FreeBlock *m_free[CLASS_COUNT];
+      char *m_cursor[CLASS_COUNT];  // unused tail of the newest slab for each class
+      char *m_cursorEnd[CLASS_COUNT];
+      std::vector<char *> m_slabs;
+
+      unsigned int m_live;
+      std::size_t m_liveBytes;
+      std::size_t m_oversizeBytes;
+      unsigned int m_allocations;
+    };
+
+    /// Standard-library allocator that draws from a SlabHeap.
+    /** A default-constructed allocator, or one given a null heap, uses the system heap instead. */
+    template<typename T> class SlabAllocator {
+    public:
+      typedef T value_type;
+      typedef T *pointer;
+      typedef const T *const_pointer;
+      typedef T &reference;
+      typedef const T &const_reference;
+      typedef std::size_t size_type;
+      typedef std::ptrdiff_t difference_type;
+
+      template<typename U> struct rebind { typedef SlabAllocator<U> other; };
+
+      SlabAllocator() : m_heap(0) { }
+      explicit SlabAllocator(SlabHeap *heap) : m_heap(heap) { }
+      template<typename U> SlabAllocator(const SlabAllocator<U> &rhs) : m_heap(rhs.HeapGet()) { }
+
+      pointer address(reference value) const { return &value; }
+      const_pointer address(const_reference value) const { return &value; }
+
+      pointer allocate(size_type count, const void * = 0) {
+        if (m_heap) {
+          return static_cast<pointer>(m_heap->Allocate(count * sizeof(T)));
+        }
+        return static_cast<pointer>(::operator new(count * sizeof(T)));
+      }
+      void deallocate(pointer block, size_type count) {
+        if (m_heap) {
+          m_heap->Free(block, count * sizeof(T));
+        } else {
+          ::operator delete(block);
+        }
+      }
+
+      size_type max_size() const { return size_type(-1) / sizeof(T); }
+
+      void construct(pointer block, const T &value) { new (block) T(value); }
+      void destroy(pointer block) { block->~T(); }
+
+      SlabHeap *HeapGet() const { return m_heap; }
+
+    private:
+      SlabHeap *m_heap;
+    };
+
+    template<typename T, typename U> inline bool operator==(const SlabAllocator<T> &lhs, const SlabAllocator<U> &rhs) { return lhs.HeapGet() == rhs.HeapGet(); }
+    template<typename T, typename U> inline bool operator!=(const SlabAllocator<T> &lhs, const SlabAllocator<U> &rhs) { return lhs.HeapGet() != rhs.HeapGet(); }
+  }
+}
+
+#endif
@@ -0,0 +1,114 @@
+/*  Copyright 2014 Mandible Games
+    
+    This file is part of Frames.
+    
+    Please see the COPYING file for detailed licensing information.
+    
+    Frames is dual-licensed software. It is available under both a
+    commercial license, and also under the terms of the GNU General
+    Public License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    Frames is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Frames.  If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef FRAMES_SNAPSHOT
+#define FRAMES_SNAPSHOT
+
+#include "frames/noncopyable.h"
+#include "frames/rect.h"
+#include "frames/renderer.h"
+
+#include <vector>
+
+namespace Frames {
+  class Environment;
+
+  namespace detail {
+    class SnapshotRecorder;
+  }
+
+  /// A finished frame's worth of geometry, recorded by Environment::SnapshotRecord() for drawing elsewhere.
+  /** A snapshot holds everything needed to draw one frame: every quad in draw order, already positioned, clipped, transformed and faded, along with the texture and scissor changes between them.
+  It doesn't refer back to any Layout, so it can be drawn by one thread while the thread that owns the Environment goes on changing the live hierarchy.
+
+  Snapshots are owned by their Environment and are never modified after being returned, until they are reused; see Environment::SnapshotRecord() for exactly when that happens. */
+  class Snapshot : detail::Noncopyable {
+  public:
+    /// Gets the width of the frame this was recorded from.
+    int WidthGet() const { return m_width; }
+    /// Gets the height of the frame this was recorded from.
+    int HeightGet() const { return m_height; }
+
+    /// Gets the number of quads this will draw.
+    int QuadCountGet() const { return (int)m_vertices.size() / 4; }
+
+    /// Draws this snapshot through a renderer.
+    /** Calls the renderer's Begin() and End() itself. This touches nothing belonging to the Environment except the renderer, so it may run in another thread, as long as nothing else uses that renderer at the same time. */
+    void Render(detail::Renderer *renderer) const;
+
+  private:
+    friend class Environment;
+    friend class detail::SnapshotRecorder;
+
+    Snapshot();
+    ~Snapshot();
+
+    void Clear();
+
+    struct Command {
+      enum Type { DRAW, TEXTURE, SCISSOR };
+
+      Type type;
+      int index;  // first vertex for DRAW, entry in m_textures for TEXTURE
+      int quads;
+      Rect scissor;
+    };
+    std::vector<Command> m_commands;
+    std::vector<detail::Renderer::Vertex> m_vertices;
+    std::vector<detail::TextureBackingPtr> m_textures;  // keeps every texture alive for as long as we might draw it
+
+    int m_width;
+    int m_height;
+  };
+
+  namespace detail {
+    /// Renderer that records into a Snapshot instead of drawing.
+    class SnapshotRecorder : public Renderer {
+    public:
+      SnapshotRecorder(Environment *env);
+      ~SnapshotRecorder();
+
+      /// Sets the snapshot that the next Begin() clears and records into.
+      void TargetSet(Snapshot *snapshot) { m_target = snapshot; }
+
+      virtual void Begin(int width, int height) FRAMES_OVERRIDE;
+      virtual void End() FRAMES_OVERRIDE;
+
+      virtual TextureBackingPtr TextureCreate(int width, int height, Texture::Format mode) FRAMES_OVERRIDE;
+      virtual TextureBackingPtr TextureCreate(const Texture::ContextualPtr &contextual) FRAMES_OVERRIDE;
+      virtual void TextureSet(const TextureBackingPtr &tex) FRAMES_OVERRIDE;
+
+    private:
+      virtual void ScissorSet(const Rect &rect) FRAMES_OVERRIDE;
+
+      virtual Vertex *BufferRequest(int quads) FRAMES_OVERRIDE;
+      virtual void BufferReturn(int quads) FRAMES_OVERRIDE;
+
+      Snapshot *m_target;
+
+      // Texture changes are only recorded once something is drawn with them, so runs of redundant sets collapse
+      TextureBackingPtr m_texture;
+      bool m_textureRecorded;
+
+      int m_requestQuads;
+    };
+  }
+}
+
+#endif
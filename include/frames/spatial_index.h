@@ -0,0 +1,70 @@
+/*  Copyright 2014 Mandible Games
+    
+    This file is part of Frames.
+    
+    Please see the COPYING file for detailed licensing information.
+    
+    Frames is dual-licensed software. It is available under both a
+    commercial license, and also under the terms of the GNU General
+    Public License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    Frames is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Frames.  If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef FRAMES_SPATIAL_INDEX
+#define FRAMES_SPATIAL_INDEX
+
+#include <map>
+#include <vector>
+
+#include "frames/noncopyable.h"
+#include "frames/rect.h"
+
+namespace Frames {
+  class Layout;
+
+  namespace detail {
+    /// Uniform-grid index of layout bounds, used to find mouse probe candidates without walking the hierarchy.
+    /** The index only knows about rectangles; visibility, masking, and z-order are the caller's problem. Layouts that cover a very large number of cells are kept in a separate list that every probe checks. */
+    class SpatialIndex : Noncopyable {
+    public:
+      SpatialIndex() { }
+      ~SpatialIndex() { }
+
+      /// Inserts a layout, or updates its bounds if it's already indexed.
+      void Insert(Layout *layout, const Rect &bounds);
+      /// Removes a layout. Harmless if the layout isn't indexed.
+      void Remove(Layout *layout);
+
+      /// Appends every layout whose bounds contain the given point.
+      /** Uses the same inclusive-start, exclusive-end test as Layout::ProbeAsMouse. */
+      void Probe(float x, float y, std::vector<Layout *> *results) const;
+
+    private:
+      typedef std::pair<int, int> Cell;
+      struct Entry {
+        Rect bounds;
+        Cell start;
+        Cell end;
+        bool oversize;
+      };
+
+      void Link(Layout *layout, const Entry &entry);
+      void Unlink(Layout *layout, const Entry &entry);
+
+      static int CellCoordinate(float coordinate);
+
+      std::map<Cell, std::vector<Layout *> > m_cells;
+      std::map<Layout *, Entry> m_entries;
+      std::vector<Layout *> m_oversize;
+    };
+  }
+}
+
+#endif
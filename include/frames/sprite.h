@@ -59,6 +59,11 @@ namespace Frames {
     /// Renders the Text.
     virtual void RenderElement(detail::Renderer *renderer) const FRAMES_OVERRIDE;
 
+    /// Creates an empty Sprite. See Layout::CloneCreate for inheritance info.
+    virtual Frame *CloneCreate(Layout *parent) const FRAMES_OVERRIDE;
+    /// Copies the texture and tint. See Layout::CloneCopy for inheritance info.
+    virtual void CloneCopy(Layout *clone, const CloneMap &clones) const FRAMES_OVERRIDE;
+
   private:
     std::string m_texture_id;
     detail::TextureChunkPtr m_texture;
@@ -128,6 +128,11 @@ namespace Frames {
     /// Renders the Text.
     virtual void RenderElement(detail::Renderer *renderer) const FRAMES_OVERRIDE;
 
+    /// Creates an empty Text. See Layout::CloneCreate for inheritance info.
+    virtual Frame *CloneCreate(Layout *parent) const FRAMES_OVERRIDE;
+    /// Copies the text, font and display properties. See Layout::CloneCopy for inheritance info.
+    virtual void CloneCopy(Layout *clone, const CloneMap &clones) const FRAMES_OVERRIDE;
+
   private:
   
     void SizeChanged(Handle *handle);
@@ -151,6 +156,17 @@ namespace Frames {
     int m_select;
     int m_cursor;
 
+    // Handlers attached by InteractiveSet(), and the move handlers attached while dragging; kept so they can be detached without a search
+    EventToken m_tokenLeftDown;
+    EventToken m_tokenLeftUp;
+    EventToken m_tokenLeftUpoutside;
+    EventToken m_tokenKeyDown;
+    EventToken m_tokenKeyRepeat;
+    EventToken m_tokenKeyText;
+    EventToken m_tokenMove;
+    EventToken m_tokenMoveoutside;
+    void EventInternalDetach(EventToken *token);
+
     // Event handlers for mouse events
     void EventInternal_LeftDown(Handle *e);
     void EventInternal_LeftUp(Handle *e);
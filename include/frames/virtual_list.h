@@ -0,0 +1,145 @@
+/*  Copyright 2014 Mandible Games
+    
+    This file is part of Frames.
+    
+    Please see the COPYING file for detailed licensing information.
+    
+    Frames is dual-licensed software. It is available under both a
+    commercial license, and also under the terms of the GNU General
+    Public License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    Frames is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Frames.  If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef FRAMES_VIRTUAL_LIST
+#define FRAMES_VIRTUAL_LIST
+
+#include "frames/functor.h"
+#include "frames/mask.h"
+
+#include <map>
+#include <vector>
+
+namespace Frames {
+  /// Vertical list that only creates frames for the rows currently in view.
+  /** VirtualList represents RowCountGet() rows stacked top to bottom, scrolled by ScrollSet(). Only the rows that intersect the list's own bounds exist as frames; rows that scroll out of view are hidden and kept in a pool, then handed out again for whichever rows scroll into view next.
+  A list of a million rows costs about as much as one that fits on the screen.
+
+  Rows are supplied through two callbacks. RowCreateSet() provides a function that creates a new, empty row frame as a child of the list; RowBindSet() provides a function that fills a row frame with the contents of a given index. Since rows are recycled, the bind function must fully overwrite whatever a previous index left behind.
+  The list owns the pins and height of every row frame; the bind function should not change them.
+  Row frames may still be obliterated from outside; the list forgets them when they're destroyed, and the next scroll, resize or invalidation fills the gap with a fresh row.
+  
+  Row heights are either uniform, set with RowHeightSet(float), or supplied per row with RowHeightSet(const RowHeightFunctor &). Per-row heights are queried once for every row when the callback or row count changes, then kept in a structure that finds a row's position, or the row at a position, in logarithmic time.
+
+  Everything is clipped to the list's bounds, as with any Mask. */
+  class VirtualList : public Mask {
+    FRAMES_DECLARE_RTTI();
+    friend class Environment;
+
+  public:
+    /// Callback type that creates a new row frame. The frame must be a child of the given list.
+    typedef Functor<Frame *(VirtualList *list)> RowCreateFunctor;
+    /// Callback type that fills a row frame with the contents of a given row index.
+    typedef Functor<void (Frame *row, int index)> RowBindFunctor;
+    /// Callback type that returns the height of a given row index.
+    typedef Functor<float (int index)> RowHeightFunctor;
+
+    /// Creates a new VirtualList.
+    static VirtualList *Create(Layout *parent, const std::string &name);
+
+    /// Sets the callback used to create new row frames.
+    /** If no callback is set, plain Frames are created. Existing rows are kept. */
+    void RowCreateSet(const RowCreateFunctor &create) { m_rowCreate = create; }
+    /// Sets the callback used to fill row frames with content.
+    /** All visible rows are immediately rebound. */
+    void RowBindSet(const RowBindFunctor &bind);
+
+    /// Sets the number of rows.
+    void RowCountSet(int count);
+    /// Gets the number of rows.
+    int RowCountGet() const { return m_rowCount; }
+
+    /// Sets a uniform height for every row.
+    /** Replaces any per-row height callback. */
+    void RowHeightSet(float height);
+    /// Sets a callback that provides the height of each row.
+    /** The callback is called for every row immediately, and again for each row passed to RowInvalidate(). */
+    void RowHeightSet(const RowHeightFunctor &height);
+
+    /// Informs the list that a row's contents or height have changed.
+    /** The row's height is queried again, if heights come from a callback, and the row is rebound if it's visible. */
+    void RowInvalidate(int index);
+    /// Informs the list that every row's contents or height have changed.
+    void RowInvalidateAll();
+
+    /// Sets the scroll position, in pixels from the top of the first row.
+    /** Clamped so that the list never scrolls past its last row. */
+    void ScrollSet(float scroll);
+    /// Gets the scroll position.
+    float ScrollGet() const { return m_scroll; }
+
+    /// Scrolls so that the given row is in view.
+    /** align chooses where the row ends up: 0 puts its top at the top of the list, 1 puts its bottom at the bottom of the list, and values in between interpolate. */
+    void ScrollToIndex(int index, float align = 0.f);
+
+    /// Returns the total height of all rows.
+    float ContentHeightGet() const;
+    /// Returns the vertical position of the top of a row, relative to the top of the first row.
+    float RowTopGet(int index) const;
+    /// Returns the index of the row at a given vertical position, relative to the top of the first row.
+    /** Returns -1 if there are no rows; positions outside the list are clamped to the first or last row. */
+    int RowIndexGet(float position) const;
+
+    /// Returns the frame currently showing a given row, or null if that row isn't in view.
+    Frame *RowFrameGet(int index) const;
+
+  protected:
+    /// Creates a new VirtualList with the given parameters. "parent" must be non-null.
+    VirtualList(Layout *parent, const std::string &name);
+    virtual ~VirtualList() FRAMES_OVERRIDE;
+
+    /// Creates an empty VirtualList. See Layout::CloneCreate for inheritance info.
+    virtual Frame *CloneCreate(Layout *parent) const FRAMES_OVERRIDE;
+    /// Copies the row callbacks, heights, count and scroll position. See Layout::CloneCopy for inheritance info.
+    virtual void CloneCopy(Layout *clone, const CloneMap &clones) const FRAMES_OVERRIDE;
+    /// Leaves out row frames; the clone creates its own. See Layout::CloneChildTest for inheritance info.
+    virtual bool CloneChildTest(const Layout *child) const FRAMES_OVERRIDE;
+
+  private:
+    void SizeChanged(Handle *handle);
+    void Destroyed(Handle *handle);
+    void RowDestroyed(Handle *handle);
+
+    // Clamps the scroll position, then brings the set of row frames in line with it; rebind forces every visible row to be rebound
+    void Refresh(bool rebind);
+
+    float RowHeightGet(int index) const;
+    void HeightsRebuild();
+
+    int m_rowCount;
+    float m_scroll;
+
+    // Uniform heights are used whenever there is no height callback
+    float m_rowHeight;
+    RowHeightFunctor m_rowHeightCallback;
+
+    // Per-row heights, and a Fenwick tree over them for prefix sums; double to keep positions exact far down long lists
+    std::vector<float> m_heights;
+    std::vector<double> m_heightTree;
+
+    RowCreateFunctor m_rowCreate;
+    RowBindFunctor m_rowBind;
+
+    std::map<int, Frame *> m_rows;  // visible rows by index
+    std::vector<Frame *> m_pool;  // hidden rows waiting to be reused
+    std::map<Layout *, EventToken> m_rowTokens;  // Destroy handler on every row, visible or pooled
+  };
+}
+
+#endif
@@ -0,0 +1,53 @@
+/*  Copyright 2014 Mandible Games
+    
+    This file is part of Frames.
+    
+    Please see the COPYING file for detailed licensing information.
+    
+    Frames is dual-licensed software. It is available under both a
+    commercial license, and also under the terms of the GNU General
+    Public License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    Frames is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Frames.  If not, see <http://www.gnu.org/licenses/>. */
+
+#ifndef FRAMES_WORKER_POOL
+#define FRAMES_WORKER_POOL
+
+#include "frames/noncopyable.h"
+
+namespace Frames {
+  namespace detail {
+    /// Fixed set of threads that run batches of independent jobs.
+    /** Run() hands out job indices one at a time to the workers and to the calling thread, and returns once every job has finished. Jobs are expected to be coarse; handing one out takes a lock. */
+    class WorkerPool : Noncopyable {
+    public:
+      typedef void (*Job)(void *context, int index);
+
+      /// Starts the given number of worker threads, not counting whichever thread calls Run().
+      WorkerPool(int threads);
+      /// Stops and joins every worker.
+      ~WorkerPool();
+
+      /// Gets the number of worker threads.
+      int ThreadCountGet() const { return m_threadCount; }
+
+      /// Calls job(context, i) for every i in [0, count), spread across the workers and the calling thread.
+      /** Jobs may run in any order and at the same time as each other. */
+      void Run(Job job, void *context, int count);
+
+    private:
+      struct Shared;  // everything the workers touch, including the platform's thread and lock types
+      Shared *m_shared;
+      int m_threadCount;
+    };
+  }
+}
+
+#endif
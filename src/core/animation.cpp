@@ -0,0 +1,459 @@
+/*  Copyright 2014 Mandible Games
+    
+    This file is part of Frames.
+    
+    Please see the COPYING file for detailed licensing information.
+    
+    Frames is dual-licensed software. It is available under both a
+    commercial license, and also under the terms of the GNU General
+    Public License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    Frames is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Frames.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include "frames/animation.h"
+
+#include "frames/detail_format.h"
+#include "frames/environment.h"
+#include "frames/frame.h"
+#include "frames/profiler.h"
+#include "frames/sprite.h"
+#include "frames/text.h"
+
+#include <algorithm>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+  #define FRAMES_ANIMATION_SSE
+  #include <xmmintrin.h>
+#endif
+
+namespace Frames {
+  namespace detail {
+    // Every easing curve is a cubic through (0, 0) and (1, 1), stored as the a, b, c in ((a * t + b) * t + c) * t
+    static const float EasingCoefficients[EASING_COUNT][3] = {
+      { 0, 0, 1 },  // EASING_LINEAR
+      { 0, 1, 0 },  // EASING_IN_QUAD
+      { 0, -1, 2 },  // EASING_OUT_QUAD
+      { 1, 0, 0 },  // EASING_IN_CUBIC
+      { 1, -3, 3 },  // EASING_OUT_CUBIC
+      { -2, 3, 0 },  // EASING_IN_OUT
+    };
+  }
+
+  /*static*/ Animator::Target Animator::Target::PinOffset(Frame *frame, Axis axis, float point) {
+    Target target(frame, PROPERTY_PIN_OFFSET);
+    target.axis = axis;
+    target.point = point;
+    return target;
+  }
+
+  /*static*/ Animator::Target Animator::Target::Width(Frame *frame) {
+    return Target(frame, PROPERTY_WIDTH);
+  }
+
+  /*static*/ Animator::Target Animator::Target::Height(Frame *frame) {
+    return Target(frame, PROPERTY_HEIGHT);
+  }
+
+  /*static*/ Animator::Target Animator::Target::Background(Frame *frame) {
+    return Target(frame, PROPERTY_BACKGROUND);
+  }
+
+  /*static*/ Animator::Target Animator::Target::Tint(Sprite *sprite) {
+    return Target(sprite, PROPERTY_TINT);
+  }
+
+  /*static*/ Animator::Target Animator::Target::Rotation(Sprite *sprite) {
+    return Target(sprite, PROPERTY_ROTATION);
+  }
+
+  /*static*/ Animator::Target Animator::Target::TextColor(Text *text) {
+    return Target(text, PROPERTY_TEXT_COLOR);
+  }
+
+  Animator::Track Animator::Tween(const Target &target, float to, double duration, Easing easing /*= EASING_LINEAR*/, double delay /*= 0*/, Timeline timeline /*= 0*/) {
+    return Tween(target, Color(to, 0, 0, 0), duration, easing, delay, timeline);
+  }
+
+  Animator::Track Animator::Tween(const Target &target, const Color &to, double duration, Easing easing /*= EASING_LINEAR*/, double delay /*= 0*/, Timeline timeline /*= 0*/) {
+    if (!target.frame) {
+      m_env->LogError("Attempted to tween a null frame");
+      return 0;
+    }
+
+    std::vector<Keyframe> keyframes;
+    keyframes.push_back(Keyframe(delay, ValueGet(target)));
+    keyframes.push_back(Keyframe(delay + duration, to, easing));
+    return TrackCreate(target, keyframes, false, timeline);
+  }
+
+  Animator::Track Animator::Keyframes(const Target &target, const std::vector<Keyframe> &keyframes, bool loop /*= false*/, Timeline timeline /*= 0*/) {
+    if (!target.frame) {
+      m_env->LogError("Attempted to animate a null frame");
+      return 0;
+    }
+
+    if (keyframes.empty()) {
+      m_env->LogError("Attempted to animate with no keyframes");
+      return 0;
+    }
+
+    for (int i = 1; i < (int)keyframes.size(); ++i) {
+      if (keyframes[i].time < keyframes[i - 1].time) {
+        m_env->LogError("Attempted to animate with keyframes out of order");
+        return 0;
+      }
+    }
+
+    return TrackCreate(target, keyframes, loop, timeline);
+  }
+
+  void Animator::Stop(Track track) {
+    std::map<Track, int>::const_iterator itr = m_trackSlot.find(track);
+    if (itr != m_trackSlot.end()) {
+      TrackRemove(itr->second);
+    }
+  }
+
+  Animator::Timeline Animator::TimelineCreate() {
+    TimelineInfo info;
+    info.time = 0;
+    info.speed = 1;
+    m_timelines[m_timelineNext] = info;
+    return m_timelineNext++;
+  }
+
+  void Animator::TimelineDestroy(Timeline timeline) {
+    if (!m_timelines.count(timeline)) {
+      m_env->LogError(detail::Format("Attempted to destroy nonexistent timeline %d", timeline));
+      return;
+    }
+
+    for (int i = (int)m_tracks.size() - 1; i >= 0; --i) {
+      if (m_tracks[i].timeline == timeline) {
+        TrackRemove(i);
+      }
+    }
+
+    if (timeline != 0) {
+      m_timelines.erase(timeline);
+    }
+  }
+
+  void Animator::TimelineSpeedSet(Timeline timeline, double speed) {
+    std::map<Timeline, TimelineInfo>::iterator itr = m_timelines.find(timeline);
+    if (itr == m_timelines.end()) {
+      m_env->LogError(detail::Format("Attempted to set speed of nonexistent timeline %d", timeline));
+      return;
+    }
+
+    itr->second.speed = speed;
+  }
+
+  double Animator::TimelineSpeedGet(Timeline timeline) const {
+    std::map<Timeline, TimelineInfo>::const_iterator itr = m_timelines.find(timeline);
+    if (itr == m_timelines.end()) {
+      m_env->LogError(detail::Format("Attempted to get speed of nonexistent timeline %d", timeline));
+      return 0;
+    }
+
+    return itr->second.speed;
+  }
+
+  void Animator::Advance(double seconds) {
+    for (std::map<Timeline, TimelineInfo>::iterator itr = m_timelines.begin(); itr != m_timelines.end(); ++itr) {
+      itr->second.time += seconds * itr->second.speed;
+    }
+
+    if (m_tracks.empty()) {
+      return;
+    }
+
+    Environment::Performance perf(m_env, "Animator.Advance", Color(0.8f, 0.4f, 0.8f));
+
+    // Progress is the only part that needs double precision, so work it out up front, moving on through any keyframes we've passed
+    for (int i = 0; i < (int)m_tracks.size(); ++i) {
+      const TrackInfo &info = m_tracks[i];
+      m_progress[i] = info.rate ? (float)((info.clock->time - info.start) * info.rate) : 1.f;
+      while (m_progress[i] >= 1.f && SegmentRemaining(i)) {
+        SegmentNext(i);
+        m_progress[i] = info.rate ? (float)((info.clock->time - info.start) * info.rate) : 1.f;
+      }
+    }
+
+    Evaluate();
+
+    {
+      Environment::LayoutBatch batch(m_env);
+
+      // Removal shuffles slots, so go by track id; when two tracks share a target, the later one has to land last
+      for (std::map<Track, int>::const_iterator itr = m_trackSlot.begin(); itr != m_trackSlot.end(); ++itr) {
+        Apply(itr->second);
+      }
+    }
+
+    // Anything still complete is on its last segment; backwards, so removals don't disturb anything we have yet to look at
+    for (int i = (int)m_tracks.size() - 1; i >= 0; --i) {
+      if (m_progress[i] >= 1.f) {
+        TrackRemove(i);
+      }
+    }
+  }
+
+  Animator::Animator(Environment *env) :
+      m_env(env),
+      m_timelineNext(1),
+      m_trackNext(1),
+      m_autoAdvance(true),
+      m_clockLast(-1)
+  {
+    TimelineInfo info;
+    info.time = 0;
+    info.speed = 1;
+    m_timelines[0] = info;
+  }
+
+  Animator::~Animator() { }
+
+  void Animator::PrepareBegin() {
+    if (!m_autoAdvance) {
+      return;
+    }
+
+    double now = detail::Clock();
+    if (m_clockLast >= 0) {
+      Advance(now - m_clockLast);
+    }
+    m_clockLast = now;
+  }
+
+  void Animator::LayoutDestroyed(const Layout *layout) {
+    std::pair<std::multimap<const Layout *, Track>::iterator, std::multimap<const Layout *, Track>::iterator> range = m_trackTargets.equal_range(layout);
+    if (range.first == range.second) {
+      return;
+    }
+
+    std::vector<Track> doomed;
+    for (std::multimap<const Layout *, Track>::iterator itr = range.first; itr != range.second; ++itr) {
+      doomed.push_back(itr->second);
+    }
+
+    for (int i = 0; i < (int)doomed.size(); ++i) {
+      Stop(doomed[i]);
+    }
+  }
+
+  Animator::Track Animator::TrackCreate(const Target &target, const std::vector<Keyframe> &keyframes, bool loop, Timeline timeline) {
+    std::map<Timeline, TimelineInfo>::const_iterator tl = m_timelines.find(timeline);
+    if (tl == m_timelines.end()) {
+      m_env->LogError(detail::Format("Attempted to animate on nonexistent timeline %d", timeline));
+      return 0;
+    }
+
+    if (target.property == Target::PROPERTY_PIN_OFFSET && !target.frame->PinGet(target.axis, target.point).valid) {
+      m_env->LogError(detail::Format("Attempted to animate the offset of a pin that %s doesn't have", target.frame->DebugNameGet()));
+      return 0;
+    }
+
+    TrackInfo info = { m_trackNext++, target, timeline, &tl->second, tl->second.time, 0, keyframes, 0, loop };
+    m_tracks.push_back(info);
+
+    m_progress.push_back(0);
+    m_easeA.push_back(0);
+    m_easeB.push_back(0);
+    m_easeC.push_back(0);
+    for (int c = 0; c < 4; ++c) {
+      m_from[c].push_back(0);
+      m_delta[c].push_back(0);
+      m_value[c].push_back(0);
+    }
+
+    int slot = (int)m_tracks.size() - 1;
+    m_trackSlot[info.id] = slot;
+    m_trackTargets.insert(std::make_pair(static_cast<const Layout *>(target.frame), info.id));
+
+    // The first segment just holds the first keyframe until its time comes around
+    const Keyframe &first = keyframes[0];
+    m_tracks[slot].rate = first.time > 0 ? 1 / first.time : 0;
+    m_easeC[slot] = 1;
+    m_from[0][slot] = first.value.r;
+    m_from[1][slot] = first.value.g;
+    m_from[2][slot] = first.value.b;
+    m_from[3][slot] = first.value.a;
+
+    return info.id;
+  }
+
+  void Animator::TrackRemove(int slot) {
+    TrackInfo &info = m_tracks[slot];
+
+    std::pair<std::multimap<const Layout *, Track>::iterator, std::multimap<const Layout *, Track>::iterator> range = m_trackTargets.equal_range(info.target.frame);
+    for (std::multimap<const Layout *, Track>::iterator itr = range.first; itr != range.second; ++itr) {
+      if (itr->second == info.id) {
+        m_trackTargets.erase(itr);
+        break;
+      }
+    }
+    m_trackSlot.erase(info.id);
+
+    // Swap the last track into the hole
+    int last = (int)m_tracks.size() - 1;
+    if (slot != last) {
+      std::swap(m_tracks[slot], m_tracks[last]);
+      m_trackSlot[m_tracks[slot].id] = slot;
+
+      m_progress[slot] = m_progress[last];
+      m_easeA[slot] = m_easeA[last];
+      m_easeB[slot] = m_easeB[last];
+      m_easeC[slot] = m_easeC[last];
+      for (int c = 0; c < 4; ++c) {
+        m_from[c][slot] = m_from[c][last];
+        m_delta[c][slot] = m_delta[c][last];
+        m_value[c][slot] = m_value[c][last];
+      }
+    }
+
+    m_tracks.pop_back();
+    m_progress.pop_back();
+    m_easeA.pop_back();
+    m_easeB.pop_back();
+    m_easeC.pop_back();
+    for (int c = 0; c < 4; ++c) {
+      m_from[c].pop_back();
+      m_delta[c].pop_back();
+      m_value[c].pop_back();
+    }
+  }
+
+  bool Animator::SegmentRemaining(int slot) const {
+    const TrackInfo &info = m_tracks[slot];
+    if (info.next + 1 < (int)info.keyframes.size()) {
+      return true;
+    }
+
+    // A loop with no length would never get anywhere
+    return info.loop && info.keyframes.back().time > info.keyframes.front().time;
+  }
+
+  void Animator::SegmentNext(int slot) {
+    TrackInfo &info = m_tracks[slot];
+
+    // Move the segment's start to where it actually ended, so any time left over carries into the next one
+    double previousTime = info.next ? info.keyframes[info.next - 1].time : 0;
+    info.start += info.keyframes[info.next].time - previousTime;
+
+    ++info.next;
+    if (info.next == (int)info.keyframes.size()) {
+      info.next = 1;
+    }
+
+    const Keyframe &from = info.keyframes[info.next - 1];
+    const Keyframe &to = info.keyframes[info.next];
+    double duration = to.time - from.time;
+    info.rate = duration > 0 ? 1 / duration : 0;
+
+    const float *ease = detail::EasingCoefficients[(to.easing >= 0 && to.easing < EASING_COUNT) ? to.easing : EASING_LINEAR];
+    m_easeA[slot] = ease[0];
+    m_easeB[slot] = ease[1];
+    m_easeC[slot] = ease[2];
+
+    m_from[0][slot] = from.value.r;
+    m_from[1][slot] = from.value.g;
+    m_from[2][slot] = from.value.b;
+    m_from[3][slot] = from.value.a;
+    m_delta[0][slot] = to.value.r - from.value.r;
+    m_delta[1][slot] = to.value.g - from.value.g;
+    m_delta[2][slot] = to.value.b - from.value.b;
+    m_delta[3][slot] = to.value.a - from.value.a;
+  }
+
+  void Animator::Evaluate() {
+    int count = (int)m_tracks.size();
+    int i = 0;
+
+#ifdef FRAMES_ANIMATION_SSE
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.f);
+    for (; i + 4 <= count; i += 4) {
+      __m128 t = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(&m_progress[i]), zero), one);
+      __m128 e = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&m_easeA[i]), t), _mm_loadu_ps(&m_easeB[i]));
+      e = _mm_add_ps(_mm_mul_ps(e, t), _mm_loadu_ps(&m_easeC[i]));
+      e = _mm_mul_ps(e, t);
+
+      for (int c = 0; c < 4; ++c) {
+        _mm_storeu_ps(&m_value[c][i], _mm_add_ps(_mm_loadu_ps(&m_from[c][i]), _mm_mul_ps(_mm_loadu_ps(&m_delta[c][i]), e)));
+      }
+    }
+#endif
+
+    // Whatever's left over, or everything if there's no SIMD available
+    for (; i < count; ++i) {
+      float t = std::min(std::max(m_progress[i], 0.f), 1.f);
+      float e = ((m_easeA[i] * t + m_easeB[i]) * t + m_easeC[i]) * t;
+
+      for (int c = 0; c < 4; ++c) {
+        m_value[c][i] = m_from[c][i] + m_delta[c][i] * e;
+      }
+    }
+  }
+
+  void Animator::Apply(int slot) {
+    const Target &target = m_tracks[slot].target;
+    Color value(m_value[0][slot], m_value[1][slot], m_value[2][slot], m_value[3][slot]);
+
+    switch (target.property) {
+      case Target::PROPERTY_PIN_OFFSET: {
+        Layout::PinAxis pin = target.frame->PinGet(target.axis, target.point);
+        if (pin.valid) {
+          target.frame->PinSet(target.axis, target.point, pin.target, pin.point, value.r);
+        }
+        break;
+      }
+      case Target::PROPERTY_WIDTH:
+        target.frame->WidthSet(value.r);
+        break;
+      case Target::PROPERTY_HEIGHT:
+        target.frame->HeightSet(value.r);
+        break;
+      case Target::PROPERTY_BACKGROUND:
+        target.frame->BackgroundSet(value);
+        break;
+      case Target::PROPERTY_TINT:
+        static_cast<Sprite *>(target.frame)->EXPERIMENTAL_TintSet(value);
+        break;
+      case Target::PROPERTY_ROTATION:
+        static_cast<Sprite *>(target.frame)->EXPERIMENTAL_RotateSet(value.r);
+        break;
+      case Target::PROPERTY_TEXT_COLOR:
+        static_cast<Text *>(target.frame)->ColorTextSet(value);
+        break;
+    }
+  }
+
+  Color Animator::ValueGet(const Target &target) const {
+    switch (target.property) {
+      case Target::PROPERTY_PIN_OFFSET:
+        return Color(target.frame->PinGet(target.axis, target.point).offset, 0, 0, 0);
+      case Target::PROPERTY_WIDTH:
+        return Color(target.frame->WidthGet(), 0, 0, 0);
+      case Target::PROPERTY_HEIGHT:
+        return Color(target.frame->HeightGet(), 0, 0, 0);
+      case Target::PROPERTY_BACKGROUND:
+        return target.frame->BackgroundGet();
+      case Target::PROPERTY_TINT:
+        return static_cast<Sprite *>(target.frame)->EXPERIMENTAL_TintGet();
+      case Target::PROPERTY_ROTATION:
+        return Color(static_cast<Sprite *>(target.frame)->EXPERIMENTAL_RotateGet(), 0, 0, 0);
+      case Target::PROPERTY_TEXT_COLOR:
+        return static_cast<Text *>(target.frame)->ColorTextGet();
+    }
+
+    return Color(0, 0, 0, 0);
+  }
+}
@@ -0,0 +1,730 @@
+/*  Copyright 2014 Mandible Games
+    
+    This file is part of Frames.
+    
+    Please see the COPYING file for detailed licensing information.
+    
+    Frames is dual-licensed software. It is available under both a
+    commercial license, and also under the terms of the GNU General
+    Public License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    Frames is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Frames.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include "frames/binary.h"
+
+#include "frames/cast.h"
+#include "frames/configuration.h"
+#include "frames/container.h"
+#include "frames/detail_format.h"
+#include "frames/environment.h"
+#include "frames/frame.h"
+#include "frames/mask.h"
+#include "frames/sprite.h"
+#include "frames/stream.h"
+#include "frames/text.h"
+
+#include <algorithm>
+#include <map>
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+// File layout, all little-endian:
+//
+// Header:  "FRUI", u32 version, u32 string count, u32 frame count
+// Strings: u32 length followed by that many bytes, once per string
+// Frames:  parents before children, each being
+//   u8 type, u32 parent index, u32 name string,
+//   f32 layer, u8 flags, f32 translation x, f32 translation y, f32 scale, f32 opacity,
+//   f32 width, f32 height (detail::Undefined if not set), f32x4 background,
+//   u8 pin count, then per pin: u8 axis, f32 mine, u32 target index, f32 theirs, f32 offset,
+//   then whatever the type adds:
+//     Sprite:    u32 texture string, f32x4 tint
+//     Text:      u32 text string, u32 font string, f32 size, u8 wordwrap, f32x4 text color, f32x4 selection color, f32x4 selected text color, u8 interactivity
+//     Container: u8 arrangement, f32 spacing, f32 padding, u32 grid columns, u32 item count, then a u32 frame index per item
+//
+// The first frame's parent index is c_indexParent. Pin targets may also be c_indexParent, meaning that same parent, or c_indexNone for no target.
+
+namespace Frames {
+  namespace detail {
+    static const unsigned char c_binaryMagic[4] = { 'F', 'R', 'U', 'I' };
+    static const std::size_t c_binaryHeaderBytes = 16;
+    static const std::size_t c_binaryFrameBytesMinimum = 55;  // a plain Frame with no pins
+
+    static const unsigned int c_indexNone = 0xFFFFFFFF;
+    static const unsigned int c_indexParent = 0xFFFFFFFE;
+
+    enum BinaryType {
+      BINARY_FRAME,
+      BINARY_MASK,
+      BINARY_SPRITE,
+      BINARY_TEXT,
+      BINARY_CONTAINER,
+      BINARY_TYPE_COUNT,
+    };
+
+    enum BinaryFlag {
+      BINARY_VISIBLE = 1 << 0,
+      BINARY_IMPLEMENTATION = 1 << 1,
+      BINARY_INPUT = 1 << 2,
+    };
+
+    // Bounds-checked cursor over the raw data. The first problem found is logged, and every read after that fails.
+    class BinaryReader : Noncopyable {
+    public:
+      BinaryReader(Environment *env, const unsigned char *data, std::size_t bytes) : m_env(env), m_data(data), m_bytes(bytes), m_position(0), m_failed(false) { }
+
+      bool U8(unsigned int *value) {
+        if (!Require(1)) {
+          return false;
+        }
+        *value = m_data[m_position++];
+        return true;
+      }
+
+      bool U32(unsigned int *value) {
+        if (!Require(4)) {
+          return false;
+        }
+        *value = m_data[m_position] | (m_data[m_position + 1] << 8) | (m_data[m_position + 2] << 16) | ((unsigned int)m_data[m_position + 3] << 24);
+        m_position += 4;
+        return true;
+      }
+
+      bool F32(float *value) {
+        unsigned int bits;
+        if (!U32(&bits)) {
+          return false;
+        }
+        *value = Reinterpret<float>(bits);
+        return true;
+      }
+
+      bool Color4(Color *color) {
+        return F32(&color->r) && F32(&color->g) && F32(&color->b) && F32(&color->a);
+      }
+
+      bool Bytes(std::string *value, std::size_t bytes) {
+        if (!Require(bytes)) {
+          return false;
+        }
+        value->assign(reinterpret_cast<const char *>(m_data + m_position), bytes);
+        m_position += bytes;
+        return true;
+      }
+
+      // Reads an index into the string table
+      bool String(const std::vector<std::string> &strings, const std::string **value) {
+        unsigned int index;
+        if (!U32(&index)) {
+          return false;
+        }
+        if (index >= strings.size()) {
+          return Fail(Format("string %d doesn't exist", index));
+        }
+        *value = &strings[index];
+        return true;
+      }
+
+      std::size_t RemainingGet() const { return m_bytes - m_position; }
+      bool FailedGet() const { return m_failed; }
+
+      bool Fail(const std::string &problem) {
+        if (!m_failed) {
+          m_failed = true;
+          m_env->LogError(Format("Malformed binary layout at byte %d: %s", m_position, problem));
+        }
+        return false;
+      }
+
+    private:
+      bool Require(std::size_t bytes) {
+        if (m_failed) {
+          return false;
+        }
+        if (m_bytes - m_position < bytes) {
+          return Fail("unexpected end of data");
+        }
+        return true;
+      }
+
+      Environment *m_env;
+      const unsigned char *m_data;
+      std::size_t m_bytes;
+      std::size_t m_position;
+      bool m_failed;
+    };
+
+    // Pins and container items can refer to frames that haven't been read yet, so they're applied once everything exists
+    struct BinaryPin {
+      Frame *frame;
+      Axis axis;
+      float mine;
+      unsigned int target;
+      float theirs;
+      float offset;
+    };
+
+    struct BinaryItems {
+      Container *container;
+      std::size_t first;  // into the shared item list
+      std::size_t count;
+    };
+
+    struct BinaryLoad {
+      std::vector<std::string> strings;
+      std::vector<Frame *> frames;
+      std::vector<BinaryPin> pins;
+      std::vector<BinaryItems> containers;
+      std::vector<unsigned int> items;
+    };
+
+    // Reads one frame record, creating the frame as early as possible so that a failure partway through still leaves it to be cleaned up
+    static void BinaryFrameRead(BinaryReader *reader, Layout *parent, BinaryLoad *load) {
+      unsigned int type;
+      unsigned int parentIndex;
+      const std::string *name;
+      if (!reader->U8(&type) || !reader->U32(&parentIndex) || !reader->String(load->strings, &name)) {
+        return;
+      }
+
+      if (type >= BINARY_TYPE_COUNT) {
+        reader->Fail(Format("unknown frame type %d", type));
+        return;
+      }
+
+      if (load->frames.empty() ? parentIndex != c_indexParent : parentIndex >= load->frames.size()) {
+        reader->Fail(Format("frame %d has parent %d, which isn't an earlier frame", load->frames.size(), parentIndex));
+        return;
+      }
+
+      Layout *frameParent = load->frames.empty() ? parent : load->frames[parentIndex];
+      Frame *frame = 0;
+      switch (type) {
+        case BINARY_FRAME: frame = Frame::Create(frameParent, *name); break;
+        case BINARY_MASK: frame = Mask::Create(frameParent, *name); break;
+        case BINARY_SPRITE: frame = Sprite::Create(frameParent, *name); break;
+        case BINARY_TEXT: frame = Text::Create(frameParent, *name); break;
+        case BINARY_CONTAINER: frame = Container::Create(frameParent, *name); break;
+      }
+      load->frames.push_back(frame);
+
+      float layer;
+      unsigned int flags;
+      Vector translation;
+      float scale;
+      float opacity;
+      float width;
+      float height;
+      Color background;
+      unsigned int pinCount;
+      if (!reader->F32(&layer) || !reader->U8(&flags) || !reader->F32(&translation.x) || !reader->F32(&translation.y) || !reader->F32(&scale) || !reader->F32(&opacity) ||
+          !reader->F32(&width) || !reader->F32(&height) || !reader->Color4(&background) || !reader->U8(&pinCount)) {
+        return;
+      }
+
+      frame->LayerSet(layer);
+      frame->VisibleSet((flags & BINARY_VISIBLE) != 0);
+      frame->ImplementationSet((flags & BINARY_IMPLEMENTATION) != 0);
+      frame->InputModeSet((flags & BINARY_INPUT) ? Layout::IM_ALL : Layout::IM_NONE);
+      frame->RenderTranslationSet(translation);
+      frame->RenderScaleSet(scale);
+      frame->RenderOpacitySet(opacity);
+      if (!IsUndefined(width)) {
+        frame->WidthSet(width);
+      }
+      if (!IsUndefined(height)) {
+        frame->HeightSet(height);
+      }
+      frame->BackgroundSet(background);
+
+      for (unsigned int i = 0; i < pinCount; ++i) {
+        unsigned int axis;
+        BinaryPin pin;
+        pin.frame = frame;
+        if (!reader->U8(&axis) || !reader->F32(&pin.mine) || !reader->U32(&pin.target) || !reader->F32(&pin.theirs) || !reader->F32(&pin.offset)) {
+          return;
+        }
+        if (axis != X && axis != Y) {
+          reader->Fail(Format("pin on axis %d", axis));
+          return;
+        }
+        pin.axis = (Axis)axis;
+        load->pins.push_back(pin);
+      }
+
+      if (type == BINARY_SPRITE) {
+        const std::string *texture;
+        Color tint;
+        if (!reader->String(load->strings, &texture) || !reader->Color4(&tint)) {
+          return;
+        }
+
+        Sprite *sprite = static_cast<Sprite *>(frame);
+        if (!texture->empty()) {
+          sprite->TextureSet(*texture);
+        }
+        sprite->EXPERIMENTAL_TintSet(tint);
+      } else if (type == BINARY_TEXT) {
+        const std::string *text;
+        const std::string *font;
+        float size;
+        unsigned int wordwrap;
+        Color color;
+        Color selection;
+        Color selected;
+        unsigned int interactive;
+        if (!reader->String(load->strings, &text) || !reader->String(load->strings, &font) || !reader->F32(&size) || !reader->U8(&wordwrap) ||
+            !reader->Color4(&color) || !reader->Color4(&selection) || !reader->Color4(&selected) || !reader->U8(&interactive)) {
+          return;
+        }
+        if (interactive > Text::INTERACTIVE_EDIT) {
+          reader->Fail(Format("unknown text interactivity %d", interactive));
+          return;
+        }
+
+        Text *textFrame = static_cast<Text *>(frame);
+        textFrame->FontSet(*font);
+        textFrame->FontSizeSet(size);
+        textFrame->WordwrapSet(wordwrap != 0);
+        textFrame->TextSet(*text);
+        textFrame->ColorTextSet(color);
+        textFrame->ColorSelectionSet(selection);
+        textFrame->ColorTextSelectedSet(selected);
+        textFrame->InteractiveSet((Text::InteractivityMode)interactive);
+      } else if (type == BINARY_CONTAINER) {
+        unsigned int arrangement;
+        float spacing;
+        float padding;
+        unsigned int columns;
+        unsigned int count;
+        if (!reader->U8(&arrangement) || !reader->F32(&spacing) || !reader->F32(&padding) || !reader->U32(&columns) || !reader->U32(&count)) {
+          return;
+        }
+        if (arrangement >= Container::ARRANGEMENT_COUNT || columns < 1 || columns > 0x7FFFFFFF) {
+          reader->Fail("invalid container settings");
+          return;
+        }
+        if (count > reader->RemainingGet() / 4) {
+          reader->Fail(Format("%d container items can't fit in what's left", count));
+          return;
+        }
+
+        Container *container = static_cast<Container *>(frame);
+        container->ArrangementSet((Container::Arrangement)arrangement);
+        container->SpacingSet(spacing);
+        container->PaddingSet(padding);
+        container->GridColumnsSet((int)columns);
+
+        BinaryItems entry = { container, load->items.size(), count };
+        for (unsigned int i = 0; i < count; ++i) {
+          unsigned int item;
+          if (!reader->U32(&item)) {
+            return;
+          }
+          load->items.push_back(item);
+        }
+        load->containers.push_back(entry);
+      }
+    }
+
+    // Friend of Layout, so that pins and explicit sizes can be saved exactly as they were set rather than as they resolved
+    class BinaryWriter : Noncopyable {
+    public:
+      BinaryWriter(Environment *env) : m_env(env), m_ok(true) { }
+
+      bool Write(const Frame *frame, std::vector<unsigned char> *output);
+
+    private:
+      void Gather(const Layout *layout);
+      BinaryType TypeGet(const Layout *layout);
+      unsigned int IndexGet(const Layout *layout) const;
+      void FrameWrite(unsigned int index);
+
+      void U8(unsigned int value) { m_frames.push_back((unsigned char)value); }
+      void U32(unsigned int value) { U32(&m_frames, value); }
+      void F32(float value) { U32(Reinterpret<unsigned int>(value)); }
+      void Color4(const Color &color) { F32(color.r); F32(color.g); F32(color.b); F32(color.a); }
+      void String(const std::string &value);
+
+      static void U32(std::vector<unsigned char> *target, unsigned int value) {
+        target->push_back((unsigned char)value);
+        target->push_back((unsigned char)(value >> 8));
+        target->push_back((unsigned char)(value >> 16));
+        target->push_back((unsigned char)(value >> 24));
+      }
+
+      Environment *m_env;
+      bool m_ok;
+
+      std::vector<const Frame *> m_order;  // parents before children
+      std::map<const Layout *, unsigned int> m_indices;
+
+      std::vector<const std::string *> m_strings;
+      std::map<std::string, unsigned int> m_stringIndices;
+
+      std::vector<unsigned char> m_frames;  // written after the string table, which isn't complete until every frame has been seen
+    };
+
+    bool BinaryWriter::Write(const Frame *frame, std::vector<unsigned char> *output) {
+      // Frames like Container pin their children lazily; save them where they'll actually be, not where they were before the last change
+      if (!m_env->m_arrangeQueue.empty()) {
+        m_env->ArrangeFlush();
+      }
+
+      Gather(frame);
+
+      for (unsigned int i = 0; i < m_order.size(); ++i) {
+        FrameWrite(i);
+      }
+
+      std::size_t bytes = c_binaryHeaderBytes + m_frames.size();
+      for (std::size_t i = 0; i < m_strings.size(); ++i) {
+        bytes += 4 + m_strings[i]->size();
+      }
+      output->reserve(output->size() + bytes);
+
+      output->insert(output->end(), c_binaryMagic, c_binaryMagic + 4);
+      U32(output, Binary::VERSION);
+      U32(output, (unsigned int)m_strings.size());
+      U32(output, (unsigned int)m_order.size());
+      for (std::size_t i = 0; i < m_strings.size(); ++i) {
+        U32(output, (unsigned int)m_strings[i]->size());
+        output->insert(output->end(), m_strings[i]->begin(), m_strings[i]->end());
+      }
+      output->insert(output->end(), m_frames.begin(), m_frames.end());
+
+      return m_ok;
+    }
+
+    void BinaryWriter::Gather(const Layout *layout) {
+      m_indices[layout] = (unsigned int)m_order.size();
+      m_order.push_back(static_cast<const Frame *>(layout));
+
+      for (Layout::ChildrenList::const_iterator itr = layout->m_children.begin(); itr != layout->m_children.end(); ++itr) {
+        Gather(*itr);
+      }
+    }
+
+    BinaryType BinaryWriter::TypeGet(const Layout *layout) {
+      const Rtti *supported[BINARY_TYPE_COUNT] = { InitHelper<Frame>(), InitHelper<Mask>(), InitHelper<Sprite>(), InitHelper<Text>(), InitHelper<Container>() };
+
+      for (const Rtti *current = layout->RttiVirtualGet(); current; current = current->ParentGet()) {
+        for (int type = 0; type < BINARY_TYPE_COUNT; ++type) {
+          if (current == supported[type]) {
+            if (current != layout->RttiVirtualGet()) {
+              m_env->LogError(Format("Saved %s, a %s, as its nearest supported base type", layout->DebugNameGet(), layout->TypeGet()));
+              m_ok = false;
+            }
+            return (BinaryType)type;
+          }
+        }
+      }
+
+      return BINARY_FRAME;  // unreachable, since only frames are ever saved
+    }
+
+    unsigned int BinaryWriter::IndexGet(const Layout *layout) const {
+      std::map<const Layout *, unsigned int>::const_iterator itr = m_indices.find(layout);
+      return itr == m_indices.end() ? c_indexNone : itr->second;
+    }
+
+    void BinaryWriter::String(const std::string &value) {
+      std::map<std::string, unsigned int>::iterator itr = m_stringIndices.find(value);
+      if (itr == m_stringIndices.end()) {
+        itr = m_stringIndices.insert(std::make_pair(value, (unsigned int)m_strings.size())).first;
+        m_strings.push_back(&itr->first);
+      }
+      U32(itr->second);
+    }
+
+    void BinaryWriter::FrameWrite(unsigned int index) {
+      const Frame *frame = m_order[index];
+      BinaryType type = TypeGet(frame);
+
+      U8(type);
+      U32(index ? IndexGet(frame->ParentGet()) : c_indexParent);
+      String(frame->NameGet());
+
+      F32(frame->m_layer);
+      U8((frame->m_visible ? BINARY_VISIBLE : 0) | (frame->m_implementation ? BINARY_IMPLEMENTATION : 0) | (frame->m_inputMode == Layout::IM_ALL ? BINARY_INPUT : 0));
+      F32(frame->m_renderTranslation.x);
+      F32(frame->m_renderTranslation.y);
+      F32(frame->m_renderScale);
+      F32(frame->m_renderOpacity);
+      F32(frame->m_axes[X].size_set);
+      F32(frame->m_axes[Y].size_set);
+      Color4(frame->BackgroundGet());
+
+      // Resolve targets first, so the count leaves out anything we can't represent
+      const Layout *outside = m_order[0]->ParentGet();
+      unsigned int targets[2][2];
+      unsigned int pins = 0;
+      for (int axis = 0; axis < 2; ++axis) {
+        for (int i = 0; i < 2; ++i) {
+          const Layout::AxisData::Connector &connector = frame->m_axes[axis].connections[i];
+          targets[axis][i] = c_indexNone;
+          if (IsUndefined(connector.point_mine)) {
+            continue;
+          }
+
+          if (connector.target) {
+            targets[axis][i] = connector.target == outside ? c_indexParent : IndexGet(connector.target);
+            if (targets[axis][i] == c_indexNone) {
+              m_env->LogError(Format("Left out pin from %s to %s, which is neither saved nor the saved frame's parent", frame->DebugNameGet(), connector.target->DebugNameGet()));
+              m_ok = false;
+              continue;
+            }
+          }
+
+          ++pins;
+        }
+      }
+
+      U8(pins);
+      for (int axis = 0; axis < 2; ++axis) {
+        for (int i = 0; i < 2; ++i) {
+          const Layout::AxisData::Connector &connector = frame->m_axes[axis].connections[i];
+          if (IsUndefined(connector.point_mine) || (connector.target && targets[axis][i] == c_indexNone)) {
+            continue;
+          }
+
+          U8(axis);
+          F32(connector.point_mine);
+          U32(targets[axis][i]);
+          F32(connector.point_target);
+          F32(connector.offset);
+        }
+      }
+
+      if (type == BINARY_SPRITE) {
+        const Sprite *sprite = static_cast<const Sprite *>(frame);
+        String(sprite->TextureGet());
+        Color4(sprite->EXPERIMENTAL_TintGet());
+      } else if (type == BINARY_TEXT) {
+        const Text *text = static_cast<const Text *>(frame);
+        String(text->TextGet());
+        String(text->FontGet());
+        F32(text->FontSizeGet());
+        U8(text->WordwrapGet());
+        Color4(text->ColorTextGet());
+        Color4(text->ColorSelectionGet());
+        Color4(text->ColorTextSelectedGet());
+        U8(text->InteractiveGet());
+      } else if (type == BINARY_CONTAINER) {
+        const Container *container = static_cast<const Container *>(frame);
+        U8(container->ArrangementGet());
+        F32(container->SpacingGet());
+        F32(container->PaddingGet());
+        U32(container->GridColumnsGet());
+        U32(container->ItemCountGet());
+        for (int i = 0; i < container->ItemCountGet(); ++i) {
+          U32(IndexGet(container->ItemGet(i)));
+        }
+      }
+    }
+  }
+
+  bool Binary::Is(const unsigned char *data, std::size_t bytes) {
+    return bytes >= detail::c_binaryHeaderBytes && std::equal(detail::c_binaryMagic, detail::c_binaryMagic + 4, data);
+  }
+
+  Frame *Binary::Load(Layout *parent, const unsigned char *data, std::size_t bytes) {
+    if (!parent) {
+      Configuration::Get().LoggerGet()->LogError("Attempted to load binary layout with null parent");
+      return 0;
+    }
+
+    Environment *env = parent->EnvironmentGet();
+    if (!Is(data, bytes)) {
+      env->LogError("Attempted to load binary layout from data that isn't one");
+      return 0;
+    }
+
+    detail::BinaryReader reader(env, data, bytes);
+
+    unsigned int magic;
+    unsigned int version;
+    unsigned int stringCount;
+    unsigned int frameCount;
+    reader.U32(&magic);  // already checked by Is()
+    reader.U32(&version);
+    reader.U32(&stringCount);
+    reader.U32(&frameCount);
+    if (version != VERSION) {
+      env->LogError(detail::Format("Attempted to load binary layout of version %d, but only version %d is supported", version, VERSION));
+      return 0;
+    }
+
+    // Counts come from the data, so make sure they could possibly fit before sizing anything by them
+    if (stringCount > reader.RemainingGet() / 4) {
+      reader.Fail(detail::Format("%d strings can't fit in what's left", stringCount));
+      return 0;
+    }
+
+    detail::BinaryLoad load;
+    load.strings.resize(stringCount);
+    for (unsigned int i = 0; i < stringCount; ++i) {
+      unsigned int length;
+      if (!reader.U32(&length) || !reader.Bytes(&load.strings[i], length)) {
+        return 0;
+      }
+    }
+
+    if (frameCount == 0 || frameCount > reader.RemainingGet() / detail::c_binaryFrameBytesMinimum) {
+      reader.Fail(detail::Format("%d frames can't fit in what's left", frameCount));
+      return 0;
+    }
+
+    Environment::LayoutBatch batch(env);
+
+    load.frames.reserve(frameCount);
+    load.pins.reserve(frameCount * 2);
+    for (unsigned int i = 0; i < frameCount && !reader.FailedGet(); ++i) {
+      detail::BinaryFrameRead(&reader, parent, &load);
+    }
+
+    for (std::size_t i = 0; i < load.pins.size() && !reader.FailedGet(); ++i) {
+      const detail::BinaryPin &pin = load.pins[i];
+
+      const Layout *target = 0;
+      if (pin.target == detail::c_indexParent) {
+        target = parent;
+      } else if (pin.target != detail::c_indexNone) {
+        if (pin.target >= load.frames.size()) {
+          reader.Fail(detail::Format("pin on %s targets frame %d, which doesn't exist", pin.frame->DebugNameGet(), pin.target));
+          break;
+        }
+        target = load.frames[pin.target];
+      }
+
+      pin.frame->PinSet(pin.axis, pin.mine, target, pin.theirs, pin.offset);
+    }
+
+    for (std::size_t i = 0; i < load.containers.size() && !reader.FailedGet(); ++i) {
+      const detail::BinaryItems &entry = load.containers[i];
+      for (std::size_t j = entry.first; j < entry.first + entry.count; ++j) {
+        unsigned int item = load.items[j];
+        if (item >= load.frames.size() || load.frames[item]->ParentGet() != entry.container) {
+          reader.Fail(detail::Format("item %d of %s isn't one of its children", j - entry.first, entry.container->DebugNameGet()));
+          break;
+        }
+        entry.container->ItemAdd(load.frames[item]);
+      }
+    }
+
+    if (reader.FailedGet()) {
+      if (!load.frames.empty()) {
+        load.frames[0]->Obliterate();
+      }
+      return 0;
+    }
+
+    return load.frames[0];
+  }
+
+  Frame *Binary::Load(Layout *parent, const StreamPtr &stream) {
+    if (!stream) {
+      if (parent) {
+        parent->EnvironmentGet()->LogError("Attempted to load binary layout from null stream");
+      }
+      return 0;
+    }
+
+    std::vector<unsigned char> data;
+    const int64_t chunk = 64 * 1024;
+    while (true) {
+      std::size_t size = data.size();
+      data.resize(size + (std::size_t)chunk);
+      int64_t read = stream->Read(&data[size], chunk);
+      data.resize(size + (std::size_t)std::max(read, (int64_t)0));
+      if (read != chunk) {
+        break;
+      }
+    }
+
+    return Load(parent, data.empty() ? 0 : &data[0], data.size());
+  }
+
+  Frame *Binary::LoadFile(Layout *parent, const std::string &filename) {
+    if (!parent) {
+      Configuration::Get().LoggerGet()->LogError("Attempted to load binary layout with null parent");
+      return 0;
+    }
+
+    Environment *env = parent->EnvironmentGet();
+    Frame *rv = 0;
+
+    #ifdef _WIN32
+      HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+      if (file == INVALID_HANDLE_VALUE) {
+        env->LogError(detail::Format("Attempted to load binary layout from %s, which can't be opened", filename));
+        return 0;
+      }
+
+      LARGE_INTEGER size;
+      if (!GetFileSizeEx(file, &size) || size.QuadPart < (LONGLONG)detail::c_binaryHeaderBytes) {
+        rv = Load(parent, 0, 0);  // too small to map meaningfully; let Load() report it
+      } else {
+        HANDLE mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+        const void *view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : 0;
+        if (view) {
+          rv = Load(parent, static_cast<const unsigned char *>(view), (std::size_t)size.QuadPart);
+          UnmapViewOfFile(view);
+        } else {
+          env->LogError(detail::Format("Attempted to load binary layout from %s, which can't be mapped", filename));
+        }
+        if (mapping) {
+          CloseHandle(mapping);
+        }
+      }
+
+      CloseHandle(file);
+    #else
+      int file = open(filename.c_str(), O_RDONLY);
+      if (file < 0) {
+        env->LogError(detail::Format("Attempted to load binary layout from %s, which can't be opened", filename));
+        return 0;
+      }
+
+      struct stat info;
+      if (fstat(file, &info) || info.st_size < (off_t)detail::c_binaryHeaderBytes) {
+        rv = Load(parent, 0, 0);  // too small to map meaningfully; let Load() report it
+      } else {
+        void *view = mmap(0, (std::size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        if (view != MAP_FAILED) {
+          rv = Load(parent, static_cast<const unsigned char *>(view), (std::size_t)info.st_size);
+          munmap(view, (std::size_t)info.st_size);
+        } else {
+          env->LogError(detail::Format("Attempted to load binary layout from %s, which can't be mapped", filename));
+        }
+      }
+
+      close(file);
+    #endif
+
+    return rv;
+  }
+
+  bool Binary::Save(const Frame *frame, std::vector<unsigned char> *output) {
+    if (!frame) {
+      Configuration::Get().LoggerGet()->LogError("Attempted to save null frame as binary layout");
+      return false;
+    }
+
+    return detail::BinaryWriter(frame->EnvironmentGet()).Write(frame, output);
+  }
+}
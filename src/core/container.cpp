@@ -0,0 +1,333 @@
+/*  Copyright 2014 Mandible Games
+    
+    This file is part of Frames.
+    
+    Please see the COPYING file for detailed licensing information.
+    
+    Frames is dual-licensed software. It is available under both a
+    commercial license, and also under the terms of the GNU General
+    Public License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    Frames is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Frames.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include "frames/container.h"
+
+#include "frames/cast.h"
+#include "frames/configuration.h"
+#include "frames/detail_format.h"
+#include "frames/environment.h"
+
+#include <algorithm>
+
+namespace Frames {
+  FRAMES_DEFINE_RTTI(Container, Frame);
+
+  Container *Container::Create(Layout *parent, const std::string &name = "") {
+    if (!parent) {
+      Configuration::Get().LoggerGet()->LogError("Attempted to create Container with null parent");
+      return 0;
+    }
+    return new (parent->EnvironmentGet()) Container(parent, name);
+  }
+
+  void Container::ArrangementSet(Arrangement arrangement) {
+    if (arrangement < 0 || arrangement >= ARRANGEMENT_COUNT) {
+      EnvironmentGet()->LogError(detail::Format("Attempted to set invalid Container arrangement %d", arrangement));
+      return;
+    }
+
+    if (m_arrangement != arrangement) {
+      m_arrangement = arrangement;
+      ArrangeFrom(0);
+    }
+  }
+
+  void Container::SpacingSet(float spacing) {
+    if (m_spacing != spacing) {
+      m_spacing = spacing;
+      ArrangeFrom(0);
+    }
+  }
+
+  void Container::PaddingSet(float padding) {
+    if (m_padding != padding) {
+      m_padding = padding;
+      ArrangeFrom(0);
+    }
+  }
+
+  void Container::GridColumnsSet(int columns) {
+    if (columns < 1) {
+      EnvironmentGet()->LogError(detail::Format("Attempted to set Container grid columns to %d", columns));
+      return;
+    }
+
+    if (m_gridColumns != columns) {
+      m_gridColumns = columns;
+      ArrangeFrom(0);
+    }
+  }
+
+  void Container::ItemInsert(int index, Frame *item) {
+    if (!item) {
+      EnvironmentGet()->LogError("Attempted to add null item to Container");
+      return;
+    }
+
+    if (index < 0 || index > (int)m_items.size()) {
+      EnvironmentGet()->LogError(detail::Format("Attempted to insert Container item at index %d out of %d", index, m_items.size()));
+      return;
+    }
+
+    if (m_itemIndex.count(item)) {
+      EnvironmentGet()->LogError(detail::Format("Attempted to add %s to Container twice", item->DebugNameGet()));
+      return;
+    }
+
+    if (item->ParentGet() != this) {
+      item->ParentSet(this);
+    }
+
+    Item entry;
+    entry.frame = item;
+    entry.sizeToken = item->EventAttach(Event::Size, Delegate<void (Handle *)>(this, &Container::ItemSizeChanged));
+    entry.destroyToken = item->EventAttach(Event::Destroy, Delegate<void (Handle *)>(this, &Container::ItemDestroyed));
+    entry.width = 0;
+    entry.height = 0;
+    entry.x = 0;
+    entry.y = 0;
+    entry.lineStart = 0;
+
+    m_items.insert(m_items.begin() + index, entry);
+    IndexRebuild(index);
+
+    ArrangeFrom(index);
+  }
+
+  void Container::ItemRemove(Frame *item) {
+    std::map<const Layout *, int>::iterator itr = m_itemIndex.find(item);
+    if (itr == m_itemIndex.end()) {
+      EnvironmentGet()->LogError(detail::Format("Attempted to remove %s from Container, but it isn't an item", item ? item->DebugNameGet() : "null"));
+      return;
+    }
+
+    int index = itr->second;
+    item->EventDetach(m_items[index].sizeToken);
+    item->EventDetach(m_items[index].destroyToken);
+    item->PinClear(TOPLEFT);
+
+    m_items.erase(m_items.begin() + index);
+    m_itemIndex.erase(itr);
+    IndexRebuild(index);
+
+    ArrangeFrom(index);
+  }
+
+  Frame *Container::ItemGet(int index) const {
+    if (index < 0 || index >= (int)m_items.size()) {
+      return 0;
+    }
+    return m_items[index].frame;
+  }
+
+  void Container::Arrange(int index) {
+    if (m_arrangement == GRID) {
+      // Cell size is shared by every item, so a change to it moves everything
+      float cellWidth = 0;
+      float cellHeight = 0;
+      for (int i = 0; i < (int)m_items.size(); ++i) {
+        if (i >= index) {
+          m_items[i].width = m_items[i].frame->WidthGet();
+          m_items[i].height = m_items[i].frame->HeightGet();
+        }
+        cellWidth = std::max(cellWidth, m_items[i].width);
+        cellHeight = std::max(cellHeight, m_items[i].height);
+      }
+      if (cellWidth != m_gridCellWidth || cellHeight != m_gridCellHeight) {
+        m_gridCellWidth = cellWidth;
+        m_gridCellHeight = cellHeight;
+        index = 0;
+      }
+    } else if (m_arrangement == FLOW && index > 0 && index < (int)m_items.size()) {
+      // Everything on the same line might rewrap
+      index = m_items[index - 1].lineStart;
+    }
+
+    float innerWidth = 0;
+    if (m_arrangement == FLOW) {
+      innerWidth = WidthGet() - m_padding * 2;
+      m_lastWidth = WidthGet();
+    }
+
+    for (int i = index; i < (int)m_items.size(); ++i) {
+      Item &item = m_items[i];
+      const Item *previous = i ? &m_items[i - 1] : 0;
+
+      if (m_arrangement != GRID) {
+        item.width = item.frame->WidthGet();
+        item.height = item.frame->HeightGet();
+      }
+
+      if (m_arrangement == STACK_VERTICAL) {
+        item.x = m_padding;
+        item.y = previous ? previous->y + previous->height + m_spacing : m_padding;
+      } else if (m_arrangement == STACK_HORIZONTAL) {
+        item.x = previous ? previous->x + previous->width + m_spacing : m_padding;
+        item.y = m_padding;
+      } else if (m_arrangement == GRID) {
+        item.x = m_padding + (i % m_gridColumns) * (m_gridCellWidth + m_spacing);
+        item.y = m_padding + (i / m_gridColumns) * (m_gridCellHeight + m_spacing);
+      } else {
+        item.x = m_padding;
+        item.y = m_padding;
+        item.lineStart = i;
+
+        if (previous) {
+          float x = previous->x + previous->width + m_spacing;
+          if (x + item.width <= m_padding + innerWidth) {
+            // Continues the line
+            item.x = x;
+            item.y = previous->y;
+            item.lineStart = previous->lineStart;
+          } else {
+            // Starts a new line below the tallest item on the previous one
+            float bottom = 0;
+            for (int j = previous->lineStart; j < i; ++j) {
+              bottom = std::max(bottom, m_items[j].y + m_items[j].height);
+            }
+            item.y = bottom + m_spacing;
+          }
+        }
+      }
+
+      item.frame->PinSet(TOPLEFT, this, TOPLEFT, item.x, item.y);
+    }
+
+    // Grow to fit, for whichever axes aren't set explicitly
+    float right = 0;
+    float bottom = 0;
+    for (int i = 0; i < (int)m_items.size(); ++i) {
+      right = std::max(right, m_items[i].x + m_items[i].width);
+      bottom = std::max(bottom, m_items[i].y + m_items[i].height);
+    }
+    if (m_arrangement != FLOW) {
+      WidthDefaultSet(m_items.empty() ? m_padding * 2 : right + m_padding);
+    }
+    HeightDefaultSet(m_items.empty() ? m_padding * 2 : bottom + m_padding);
+  }
+
+  void Container::ArrangeFrom(int index) {
+    if (m_arrangeFrom < 0 || index < m_arrangeFrom) {
+      m_arrangeFrom = index;
+    }
+    ArrangeQueue();
+  }
+
+  void Container::ArrangeDeferred() {
+    int index = m_arrangeFrom;
+    m_arrangeFrom = -1;
+    if (index >= 0) {
+      Arrange(index);
+    }
+  }
+
+  void Container::IndexRebuild(int index) {
+    for (int i = index; i < (int)m_items.size(); ++i) {
+      m_itemIndex[m_items[i].frame] = i;
+    }
+  }
+
+  void Container::SizeChanged(Handle *handle) {
+    // Only FLOW cares about our own size, and only about the width
+    if (m_arrangement == FLOW && WidthGet() != m_lastWidth) {
+      ArrangeFrom(0);
+    }
+  }
+
+  void Container::Destroyed(Handle *handle) {
+    // Our items are about to be destroyed along with us; don't bother rearranging them as they go
+    for (int i = 0; i < (int)m_items.size(); ++i) {
+      m_items[i].frame->EventDetach(m_items[i].sizeToken);
+      m_items[i].frame->EventDetach(m_items[i].destroyToken);
+    }
+    m_items.clear();
+    m_itemIndex.clear();
+  }
+
+  void Container::ItemSizeChanged(Handle *handle) {
+    std::map<const Layout *, int>::iterator itr = m_itemIndex.find(handle->TargetGet());
+    if (itr == m_itemIndex.end()) {
+      return;
+    }
+
+    const Item &item = m_items[itr->second];
+    if (item.frame->WidthGet() != item.width || item.frame->HeightGet() != item.height) {
+      ArrangeFrom(itr->second);
+    }
+  }
+
+  void Container::ItemDestroyed(Handle *handle) {
+    std::map<const Layout *, int>::iterator itr = m_itemIndex.find(handle->TargetGet());
+    if (itr == m_itemIndex.end()) {
+      return;
+    }
+
+    int index = itr->second;
+    m_items.erase(m_items.begin() + index);
+    m_itemIndex.erase(itr);
+    IndexRebuild(index);
+
+    ArrangeFrom(index);
+  }
+
+  Frame *Container::CloneCreate(Layout *parent) const {
+    return Container::Create(parent, NameGet());
+  }
+
+  void Container::CloneCopy(Layout *clone, const CloneMap &clones) const {
+    Frame::CloneCopy(clone, clones);
+
+    Container *container = static_cast<Container *>(clone);
+    container->m_arrangement = m_arrangement;
+    container->m_spacing = m_spacing;
+    container->m_padding = m_padding;
+    container->m_gridColumns = m_gridColumns;
+
+    // Items are always our children, so every one of them has a clone by now
+    container->m_items.reserve(m_items.size());
+    for (int i = 0; i < (int)m_items.size(); ++i) {
+      CloneMap::const_iterator itr = clones.find(m_items[i].frame);
+      if (itr != clones.end()) {
+        container->ItemAdd(static_cast<Frame *>(itr->second));
+      }
+    }
+
+    container->ArrangeFrom(0);
+  }
+
+  Container::Container(Layout *parent, const std::string &name) :
+      Frame(parent, name),
+      m_arrangement(STACK_VERTICAL),
+      m_spacing(0),
+      m_padding(0),
+      m_gridColumns(1),
+      m_gridCellWidth(0),
+      m_gridCellHeight(0),
+      m_lastWidth(0),
+      m_arrangeFrom(-1)
+  {
+    WidthDefaultSet(0);
+    HeightDefaultSet(0);
+
+    EventAttach(Event::Size, Delegate<void (Handle *)>(this, &Container::SizeChanged));
+    EventAttach(Event::Destroy, Delegate<void (Handle *)>(this, &Container::Destroyed));
+  };
+  Container::~Container() { };
+}
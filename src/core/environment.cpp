@@ -19,13 +19,19 @@
 
 #include "frames/environment.h"
 
+#include "frames/animation.h"
 #include "frames/detail_format.h"
 #include "frames/frame.h"
+#include "frames/profiler.h"
 #include "frames/renderer.h"
 #include "frames/renderer_opengl.h"
+#include "frames/snapshot.h"
 #include "frames/text_manager.h"
 #include "frames/texture.h"
 #include "frames/texture_chunk.h"
+#include "frames/worker_pool.h"
+
+#include <algorithm>
 
 namespace Frames {
   /*static*/ EnvironmentPtr Environment::Create(const Configuration::Local &config) {
@@ -205,6 +211,44 @@ namespace Frames {
     }
   }
 
+  void Environment::Prepare() {
+    Performance perf(this, "Environment.Prepare", Color(0.5f, 0.3f, 0.3f));
+
+    // Animations go first, so their changes are resolved along with everything else
+    if (m_animator) {
+      m_animator->PrepareBegin();
+    }
+
+    {
+      Performance perf(this, "Environment.Prepare.Resolve", Color(1, 0, 0));
+
+      // Resolve everything, then deliver Move/Size parent-first. Handlers are free to change layout, which means another pass; we cap the number of passes so feedback loops can't hang the frame
+      // (ProbeAsMouse can resolve behind our back, in which case there may be notifications waiting even though nothing's invalidated)
+      if (!m_arrangeQueue.empty()) {
+        ArrangeFlush();
+      }
+      if (!m_layoutBatchPending.empty()) {
+        LayoutBatchFlush();
+      }
+
+      m_resolveGroups = 0;
+
+      int iteration = 0;
+      while (!m_invalidated.empty() || !m_layoutNotify.empty() || !m_arrangeQueue.empty()) {
+        if (iteration == detail::LayoutIterationLimit) {
+          LogError(detail::Format("Layout failed to settle after %d passes, %d layouts deferred to the next frame; check for Move/Size handlers that change layout every time they fire", iteration, m_invalidated.size()));
+          break;
+        }
+        ++iteration;
+
+        ResolvePending();
+        LayoutNotifyFlush();
+      }
+    }
+
+    m_prepared = true;
+  }
+
   void Environment::Render(const Layout *root) {
     Performance perf(this, "Environment.Render", Color(0.3f, 0.5f, 0.3f));
 
@@ -217,46 +261,181 @@ namespace Frames {
       return;
     }
 
+    if (!m_prepared) {
+      Prepare();
+    }
+    m_prepared = false;
+
+    RenderProcess(root, m_renderer);
+  }
+
+  const Snapshot *Environment::SnapshotRecord(const Layout *root) {
+    Performance perf(this, "Environment.SnapshotRecord", Color(0.3f, 0.3f, 0.5f));
+
+    if (!root) {
+      root = m_root;
+    }
+
+    if (root->EnvironmentGet() != this) {
+      Configuration::Get().LoggerGet()->LogError("Attempt to record a frame through an unrelated environment");
+      return 0;
+    }
+
+    if (!m_prepared) {
+      Prepare();
+    }
+    m_prepared = false;
+
+    if (!m_snapshotRecorder) {
+      m_snapshotRecorder = new detail::SnapshotRecorder(this);
+      m_snapshots[0] = new Snapshot();
+      m_snapshots[1] = new Snapshot();
+    }
+
+    Snapshot *snapshot = m_snapshots[m_snapshotNext];
+    m_snapshotNext = 1 - m_snapshotNext;
+
+    m_snapshotRecorder->TargetSet(snapshot);
+    RenderProcess(root, m_snapshotRecorder);
+    m_snapshotRecorder->TargetSet(0);
+
+    return snapshot;
+  }
+
+  void Environment::RenderProcess(const Layout *root, detail::Renderer *renderer) {
+    Performance perf(this, "Environment.Render.Process", Color(0.5f, 0.8f, 0.5f));
+
     {
-      Performance perf(this, "Environment.Render.Resolve", Color(1, 0, 0));
-      // We want to batch up events if possible (todo: is this the case? which is faster - flushing as they go, or flushing all at once?) so, two nested loops
-      while (!m_invalidated.empty()) {
-        while (!m_invalidated.empty()) {
-          Layout *layout = m_invalidated.front();
-          m_invalidated.pop_front();
-
-          layout->Resolve();
-        }
+      Performance perf(this, "Environment.Render.Process.Begin", Color(0.4f, 0.2f, 0.2f));
+      renderer->Begin((int)m_root->WidthGet(), (int)m_root->HeightGet());
+    }
 
-        // send events here
+    {
+      Performance perf(this, "Environment.Render.Process.Render", Color(0.8f, 0.6f, 0.6f));
+      if (root == m_root) {
+        DisplayListRender(renderer);
+      } else {
+        root->Render(renderer);
       }
     }
 
     {
-      Performance perf(this, "Environment.Render.Process", Color(0.5f, 0.8f, 0.5f));
+      Performance perf(this, "Environment.Render.Process.End", Color(0.4f, 0.2f, 0.2f));
+      renderer->End();
+    }
+  }
+
+  void Environment::LayoutBatchBegin() {
+    ++m_layoutBatchDepth;
+  }
+
+  void Environment::LayoutBatchEnd() {
+    if (m_layoutBatchDepth <= 0) {
+      LogError("Layout batch ended without a matching LayoutBatchBegin");
+      return;
+    }
+
+    --m_layoutBatchDepth;
+    if (m_layoutBatchDepth == 0) {
+      LayoutBatchFlush();
+    }
+  }
+
+  Layout *Environment::ProbeAsMouse(float x, float y) const {
+    // The index is only as fresh as the last resolve. Resolving doesn't fire any events, so this is safe to do from a const function.
+    const_cast<Environment *>(this)->ResolvePending();
 
-      {
-        Performance perf(this, "Environment.Render.Process.Begin", Color(0.4f, 0.2f, 0.2f));
-        m_renderer->Begin((int)m_root->WidthGet(), (int)m_root->HeightGet());
+    m_probeCandidates.clear();
+    m_probeIndex.Probe(x, y, &m_probeCandidates);
+
+    // The index only knows untransformed bounds, so anything under a render transform has to be looked up again in that transform's space
+    for (std::set<const Layout *>::const_iterator itr = m_renderTransformed.begin(); itr != m_renderTransformed.end(); ++itr) {
+      Vector local(x, y);
+      if (ProbeDescend(*itr, &local) && (local.x != x || local.y != y)) {
+        m_probeIndex.Probe(local.x, local.y, &m_probeCandidates);
       }
+    }
 
-      {
-        Performance perf(this, "Environment.Render.Process.Render", Color(0.8f, 0.6f, 0.6f));
-        root->Render(m_renderer);
+    // Candidates come back in no particular order, possibly more than once, and possibly from a lookup in some other layout's space; find the topmost one that really accepts the point
+    Layout *best = 0;
+    for (std::vector<Layout *>::const_iterator itr = m_probeCandidates.begin(); itr != m_probeCandidates.end(); ++itr) {
+      if (best && !ProbeAbove(*itr, best)) {
+        continue;
       }
 
-      {
-        Performance perf(this, "Environment.Render.Process.End", Color(0.4f, 0.2f, 0.2f));
-        m_renderer->End();
+      if (ProbeAccepts(*itr, x, y)) {
+        best = *itr;
       }
     }
+
+    return best;
   }
 
-  Layout *Environment::ProbeAsMouse(float x, float y) const {
-    // TODO: de-invalidate
-    return m_root->ProbeAsMouse(x, y);
+  /*static*/ bool Environment::ProbeAccepts(const Layout *layout, float x, float y) {
+    Vector local(x, y);
+    if (!ProbeDescend(layout, &local)) {
+      return false;
+    }
+
+    // Same inclusive-start, exclusive-end test as Layout::ProbeAsMouse
+    return local.x >= layout->LeftGet() && local.y >= layout->TopGet() && local.x < layout->RightGet() && local.y < layout->BottomGet();
   }
-  
+
+  /*static*/ bool Environment::ProbeDescend(const Layout *layout, Vector *point) {
+    // Mirrors the conditions Layout::ProbeAsMouse checks on the way down, each in that layout's own space
+    if (layout->m_parent && !ProbeDescend(layout->m_parent, point)) {
+      return false;
+    }
+
+    if (!layout->m_visible) {
+      return false;
+    }
+
+    if (layout->RenderTransformGet()) {
+      *point = layout->RenderTransformInverse(*point);
+    }
+
+    if (layout->m_fullMouseMasking && !layout->MouseMaskingTest(point->x, point->y)) {
+      return false;
+    }
+
+    return true;
+  }
+
+  /*static*/ bool Environment::ProbeAbove(const Layout *lhs, const Layout *rhs) {
+    int ldepth = 0;
+    for (const Layout *ancestor = lhs->m_parent; ancestor; ancestor = ancestor->m_parent) {
+      ++ldepth;
+    }
+    int rdepth = 0;
+    for (const Layout *ancestor = rhs->m_parent; ancestor; ancestor = ancestor->m_parent) {
+      ++rdepth;
+    }
+
+    // Bring both up to the same depth
+    const Layout *l = lhs;
+    const Layout *r = rhs;
+    for (int i = ldepth; i > rdepth; --i) {
+      l = l->m_parent;
+    }
+    for (int i = rdepth; i > ldepth; --i) {
+      r = r->m_parent;
+    }
+
+    // One is the ancestor of the other; children render over their parents
+    if (l == r) {
+      return ldepth > rdepth;
+    }
+
+    while (l->m_parent != r->m_parent) {
+      l = l->m_parent;
+      r = r->m_parent;
+    }
+
+    // Siblings, so both are Frames; later in the children list means rendered later
+    return detail::FrameOrderSorter()(static_cast<const Frame *>(r), static_cast<const Frame *>(l));
+  }
+
   Environment::Performance::Performance(Environment *env, const char *name, const Color &color) : m_env(env) {
     m_handle = m_env->ConfigurationGet().PerformanceGet()->Push(name, color);
   }
@@ -264,6 +443,13 @@ namespace Frames {
     m_env->ConfigurationGet().PerformanceGet()->Pop(m_handle);
   }
 
+  Environment::LayoutBatch::LayoutBatch(Environment *env) : m_env(env) {
+    m_env->LayoutBatchBegin();
+  }
+  Environment::LayoutBatch::~LayoutBatch() {
+    m_env->LayoutBatchEnd();
+  }
+
   unsigned int Environment::RegisterFrame() {
     if (m_counter == -1) {
       LogError("Frame counter exceeded 4 billion, this maybe should be increased to a 64-bit integer");
@@ -272,14 +458,29 @@ namespace Frames {
   }
 
   Environment::Environment(const Configuration::Local &config) :
+    m_counter(0),
+    m_resolveHiddenLazy(false),
+    m_resolvePool(0),
+    m_resolveGroups(0),
+    m_prepared(false),
+    m_layoutBatchDepth(0),
+    m_eventMaskGeneration(1),
+    m_eventProfiler(0),
+    m_animator(0),
+    m_snapshotRecorder(0),
+    m_snapshotNext(0),
+    m_displayListDirty(true),
+    m_layoutStackSuspended(false),
     m_renderer(0),
     m_text_manager(0),
     m_root(0),
     m_over(0),
     m_focus(0),
-    m_counter(0),
     m_obliterateLockCount(0)
   {
+    m_snapshots[0] = 0;
+    m_snapshots[1] = 0;
+
     m_config = config;
 
     // Reset config values to defaults, if uninitialized
@@ -316,7 +517,7 @@ namespace Frames {
       return; // This will crash horribly. Maybe someday it shouldn't. Maybe.
     }
 
-    m_root = new Layout(this, "Root");
+    m_root = new (this) Layout(this, "Root");
 
     m_renderer = m_config.RendererGet()->Create(this);
     m_text_manager = new detail::TextManager(this);
@@ -326,19 +527,331 @@ namespace Frames {
     m_root->zinternalObliterate();
 
     // this flushes everything out of memory
+    ResolvePending();
+
+    // Snapshots hold texture references, so they go while the renderer that made the textures is still around
+    delete m_snapshots[0];
+    delete m_snapshots[1];
+    delete m_snapshotRecorder;
+
+    delete m_resolvePool;
+
+    delete m_text_manager;
+    delete m_renderer;
+    delete m_eventProfiler;
+    delete m_animator;
+  }
+
+  Animator *Environment::AnimatorGet() {
+    if (!m_animator) {
+      m_animator = new Animator(this);
+    }
+
+    return m_animator;
+  }
+
+  void Environment::EventProfilerSet(bool enabled) {
+    if (enabled && !m_eventProfiler) {
+      m_eventProfiler = new EventProfiler();
+    } else if (!enabled) {
+      delete m_eventProfiler;
+      m_eventProfiler = 0;
+    }
+  }
+
+  void Environment::ResolveHiddenLazySet(bool lazy) {
+    if (m_resolveHiddenLazy == lazy) {
+      return;
+    }
+
+    m_resolveHiddenLazy = lazy;
+    if (!lazy) {
+      ResolveUnpark();
+    }
+  }
+
+  void Environment::ResolveThreadsSet(int threads) {
+    if (threads < 0) {
+      LogError(detail::Format("Attempted to set resolve thread count to %d, which is negative", threads));
+      return;
+    }
+
+    if (threads == ResolveThreadsGet()) {
+      return;
+    }
+
+    delete m_resolvePool;
+    m_resolvePool = threads ? new detail::WorkerPool(threads) : 0;
+  }
+
+  int Environment::ResolveThreadsGet() const {
+    return m_resolvePool ? m_resolvePool->ThreadCountGet() : 0;
+  }
+
+  Environment::AllocationStats Environment::AllocationStatsGet() const {
+    AllocationStats stats;
+    stats.live = m_slabHeap.LiveGet();
+    stats.liveBytes = m_slabHeap.LiveBytesGet();
+    stats.oversizeBytes = m_slabHeap.OversizeBytesGet();
+    stats.reservedBytes = m_slabHeap.ReservedBytesGet();
+    stats.slabs = m_slabHeap.SlabCountGet();
+    stats.allocations = m_slabHeap.AllocationCountGet();
+    return stats;
+  }
+
+  void Environment::MarkInvalidated(Layout *layout) {
+    m_invalidated.push_back(layout);
+  }
+
+  void Environment::ResolvePending() {
+    if (!m_arrangeQueue.empty()) {
+      ArrangeFlush();
+    }
+    if (!m_layoutBatchPending.empty()) {
+      LayoutBatchFlush();
+    }
+
+    if (m_resolvePool && (int)m_invalidated.size() >= detail::ResolveParallelMinimum) {
+      ResolveParallel();
+    }
+
     while (!m_invalidated.empty()) {
       Layout *layout = m_invalidated.front();
       m_invalidated.pop_front();
 
+      if (m_resolveHiddenLazy) {
+        if (Layout *hidden = ResolveHiddenFind(layout)) {
+          // Stays unresolved, so further invalidations don't requeue it
+          layout->m_resolveParked = hidden;
+          m_resolveParked[hidden].push_back(layout);
+          continue;
+        }
+      }
+
       layout->Resolve();
     }
+  }
 
-    delete m_text_manager;
-    delete m_renderer;
+  namespace detail {
+    int ResolveGroupFind(std::vector<int> &parents, int node) {
+      while (parents[node] != node) {
+        parents[node] = parents[parents[node]];
+        node = parents[node];
+      }
+      return node;
+    }
+
+    void ResolveGroupJob(void *context, int index) {
+      // Asking for every edge caches everything Layout::Resolve() will ask for
+      const std::vector<const Layout *> &group = (*static_cast<std::vector<std::vector<const Layout *> > *>(context))[index];
+      for (std::vector<const Layout *>::const_iterator itr = group.begin(); itr != group.end(); ++itr) {
+        (*itr)->LeftGet();
+        (*itr)->RightGet();
+        (*itr)->TopGet();
+        (*itr)->BottomGet();
+      }
+    }
+
+    struct ResolveGroupSizeSorter {
+      bool operator()(const std::vector<const Layout *> &lhs, const std::vector<const Layout *> &rhs) const {
+        return lhs.size() > rhs.size();
+      }
+    };
   }
 
-  void Environment::MarkInvalidated(Layout *layout) {
-    m_invalidated.push_back(layout);
+  void Environment::ResolveParallel() {
+    // Workers can't flush these from inside a getter; ResolvePending() has normally just done so anyway
+    if (!m_arrangeQueue.empty() || !m_layoutBatchPending.empty()) {
+      return;
+    }
+
+    // Nearly everything hangs off the root, so settle it now rather than letting it tie every group together
+    m_root->SizeGet(X);
+    m_root->SizeGet(Y);
+
+    // Group the layouts that need resolving by the unresolved layouts they reach through pins. Layouts whose caches are full are only read, so they can be shared freely and don't join groups.
+    // Walking depth-first also finds loops; those groups are left for the serial pass, which knows how to report them.
+    std::vector<const Layout *> nodes;
+    std::vector<int> parents;
+    std::vector<char> open;  // still on the walk stack
+    std::vector<char> looped;  // only meaningful on group roots
+    std::vector<const Layout *> seeds;
+    std::vector<std::pair<const Layout *, int> > walk;  // layout, next connector to follow
+
+    for (std::deque<Layout *>::const_iterator itr = m_invalidated.begin(); itr != m_invalidated.end(); ++itr) {
+      const Layout *seed = *itr;
+      if (!seed->ResolveEagerGet() || (m_resolveHiddenLazy && !seed->zinternalVisibleChainGet()) || seed->ResolveCachedGet()) {
+        continue;
+      }
+      seeds.push_back(seed);
+
+      if (seed->m_resolveComponent >= 0) {
+        continue;
+      }
+
+      seed->m_resolveComponent = (int)nodes.size();
+      nodes.push_back(seed);
+      parents.push_back(seed->m_resolveComponent);
+      open.push_back(1);
+      looped.push_back(0);
+      walk.push_back(std::make_pair(seed, 0));
+
+      while (!walk.empty()) {
+        const Layout *current = walk.back().first;
+        int connection = walk.back().second++;
+        if (connection == 4) {
+          open[current->m_resolveComponent] = 0;
+          walk.pop_back();
+          continue;
+        }
+
+        const Layout *target = current->m_axes[connection / 2].connections[connection % 2].target;
+        if (!target) {
+          continue;
+        }
+
+        int group = detail::ResolveGroupFind(parents, current->m_resolveComponent);
+        if (target->m_resolveComponent >= 0) {
+          if (open[target->m_resolveComponent]) {
+            looped[group] = 1;
+          }
+
+          int other = detail::ResolveGroupFind(parents, target->m_resolveComponent);
+          if (other != group) {
+            parents[other] = group;
+            looped[group] |= looped[other];
+          }
+          continue;
+        }
+
+        if (target->ResolveCachedGet()) {
+          continue;
+        }
+
+        target->m_resolveComponent = (int)nodes.size();
+        nodes.push_back(target);
+        parents.push_back(group);
+        open.push_back(1);
+        looped.push_back(0);
+        walk.push_back(std::make_pair(target, 0));
+      }
+    }
+
+    std::vector<int> groupIndex(nodes.size(), -1);
+    std::vector<std::vector<const Layout *> > groups;
+    for (std::vector<const Layout *>::const_iterator itr = seeds.begin(); itr != seeds.end(); ++itr) {
+      int group = detail::ResolveGroupFind(parents, (*itr)->m_resolveComponent);
+      if (looped[group]) {
+        continue;
+      }
+
+      if (groupIndex[group] < 0) {
+        groupIndex[group] = (int)groups.size();
+        groups.push_back(std::vector<const Layout *>());
+      }
+      groups[groupIndex[group]].push_back(*itr);
+    }
+
+    for (std::vector<const Layout *>::const_iterator itr = nodes.begin(); itr != nodes.end(); ++itr) {
+      (*itr)->m_resolveComponent = -1;
+    }
+
+    if (groups.size() < 2) {
+      return;
+    }
+
+    // Biggest first, so one large group doesn't start last and hold everyone up
+    std::sort(groups.begin(), groups.end(), detail::ResolveGroupSizeSorter());
+
+    m_resolveGroups += (int)groups.size();
+
+    m_layoutStackSuspended = true;
+    m_resolvePool->Run(detail::ResolveGroupJob, &groups, (int)groups.size());
+    m_layoutStackSuspended = false;
+  }
+
+  /*static*/ Layout *Environment::ResolveHiddenFind(Layout *layout) {
+    for (; layout; layout = layout->m_parent) {
+      if (!layout->m_visible) {
+        return layout;
+      }
+    }
+
+    return 0;
+  }
+
+  void Environment::ResolveUnpark() {
+    for (ParkedMap::const_iterator itr = m_resolveParked.begin(); itr != m_resolveParked.end(); ++itr) {
+      for (std::vector<Layout *>::const_iterator parked = itr->second.begin(); parked != itr->second.end(); ++parked) {
+        (*parked)->m_resolveParked = 0;
+        m_invalidated.push_back(*parked);
+      }
+    }
+    m_resolveParked.clear();
+  }
+
+  void Environment::ResolveUnparkShown(Layout *layout) {
+    ParkedMap::iterator itr = m_resolveParked.find(layout);
+    if (itr == m_resolveParked.end()) {
+      return;
+    }
+
+    // Anything that's still hidden by a frame further up just gets parked again, under that frame, by ResolvePending()
+    for (std::vector<Layout *>::const_iterator parked = itr->second.begin(); parked != itr->second.end(); ++parked) {
+      (*parked)->m_resolveParked = 0;
+      m_invalidated.push_back(*parked);
+    }
+    m_resolveParked.erase(itr);
+  }
+
+  void Environment::ResolveUnparkMoving(Layout *layout) {
+    // Called before the move. Layouts parked under hidden frames inside the subtree stay hidden wherever it goes; only the ones filed under a hidden frame above it might be revealed.
+    for (Layout *ancestor = layout->m_parent; ancestor; ancestor = ancestor->m_parent) {
+      if (ancestor->m_visible) {
+        continue;
+      }
+
+      ParkedMap::iterator itr = m_resolveParked.find(ancestor);
+      if (itr == m_resolveParked.end()) {
+        continue;
+      }
+
+      std::vector<Layout *> &parked = itr->second;
+      std::vector<Layout *>::iterator kept = parked.begin();
+      for (std::vector<Layout *>::iterator candidate = parked.begin(); candidate != parked.end(); ++candidate) {
+        const Layout *walk = *candidate;
+        while (walk != layout && walk != ancestor) {
+          walk = walk->m_parent;
+        }
+
+        if (walk == layout) {
+          (*candidate)->m_resolveParked = 0;
+          m_invalidated.push_back(*candidate);
+        } else {
+          *kept++ = *candidate;
+        }
+      }
+      parked.erase(kept, parked.end());
+
+      if (parked.empty()) {
+        m_resolveParked.erase(itr);
+      }
+    }
+  }
+
+  void Environment::UnmarkParked(Layout *layout) {
+    ParkedMap::iterator parked = m_resolveParked.find(layout->m_resolveParked);
+    std::vector<Layout *>::iterator itr;
+    if (parked == m_resolveParked.end() || (itr = find(parked->second.begin(), parked->second.end(), layout)) == parked->second.end()) {
+      LogError("Internal problem, attempted to unmark parked layout and failed");
+      return;
+    }
+
+    *itr = parked->second.back();
+    parked->second.pop_back();
+    if (parked->second.empty()) {
+      m_resolveParked.erase(parked);
+    }
   }
 
   void Environment::UnmarkInvalidated(Layout *layout) {
@@ -350,17 +863,201 @@ namespace Frames {
     }
   }
 
+  void Environment::DisplayListBuild() {
+    m_displayList.clear();
+    DisplayListAppend(m_root);
+    m_displayListDirty = false;
+  }
+
+  void Environment::DisplayListAppend(const Layout *layout) {
+    // Mirrors Layout::Render
+    if (!layout->m_visible) {
+      return;
+    }
+
+    DisplayEntry entry;
+    entry.layout = layout;
+
+    bool transform = layout->RenderTransformGet();
+    if (transform) {
+      entry.type = DisplayEntry::TRANSFORM_PUSH;
+      m_displayList.push_back(entry);
+    }
+
+    entry.type = DisplayEntry::ELEMENT;
+    m_displayList.push_back(entry);
+
+    if (!layout->m_children.empty()) {
+      entry.type = DisplayEntry::PRECHILD;
+      m_displayList.push_back(entry);
+
+      for (Layout::ChildrenList::const_iterator itr = layout->m_children.begin(); itr != layout->m_children.end(); ++itr) {
+        DisplayListAppend(*itr);
+      }
+
+      entry.type = DisplayEntry::POSTCHILD;
+      m_displayList.push_back(entry);
+    }
+
+    if (transform) {
+      entry.type = DisplayEntry::TRANSFORM_POP;
+      m_displayList.push_back(entry);
+    }
+  }
+
+  void Environment::DisplayListRender(detail::Renderer *renderer) {
+    if (m_displayListDirty) {
+      DisplayListBuild();
+    }
+
+    for (std::vector<DisplayEntry>::const_iterator itr = m_displayList.begin(); itr != m_displayList.end(); ++itr) {
+      switch (itr->type) {
+        case DisplayEntry::ELEMENT:
+          itr->layout->RenderElement(renderer);
+          break;
+        case DisplayEntry::PRECHILD:
+          itr->layout->RenderElementPreChild(renderer);
+          break;
+        case DisplayEntry::POSTCHILD:
+          itr->layout->RenderElementPostChild(renderer);
+          break;
+        case DisplayEntry::TRANSFORM_PUSH:
+          itr->layout->RenderTransformPush(renderer);
+          break;
+        case DisplayEntry::TRANSFORM_POP:
+          itr->layout->RenderTransformPop(renderer);
+          break;
+      }
+    }
+  }
+
+  namespace detail {
+    struct LayoutNotifySorter {
+      bool operator()(const std::pair<int, Layout *> &lhs, const std::pair<int, Layout *> &rhs) const {
+        if (lhs.first != rhs.first) return lhs.first < rhs.first;
+        return LayoutIdSorter()(lhs.second, rhs.second);
+      }
+    };
+  }
+
+  void Environment::LayoutNotifyFlush() {
+    if (m_layoutNotify.empty()) {
+      return;
+    }
+
+    // Parents first, so a child's handler sees its parent's final position; ties are broken by construction order to keep things deterministic
+    std::vector<std::pair<int, Layout *> > order;
+    order.reserve(m_layoutNotify.size());
+    for (std::vector<Layout *>::const_iterator itr = m_layoutNotify.begin(); itr != m_layoutNotify.end(); ++itr) {
+      int depth = 0;
+      for (const Layout *parent = (*itr)->ParentGet(); parent; parent = parent->ParentGet()) {
+        ++depth;
+      }
+      order.push_back(std::make_pair(depth, *itr));
+    }
+    m_layoutNotify.clear();
+
+    std::sort(order.begin(), order.end(), detail::LayoutNotifySorter());
+
+    // Handlers may obliterate frames that are still waiting in our list; hold that off until we're done
+    ObliterateLock();
+    for (std::vector<std::pair<int, Layout *> >::const_iterator itr = order.begin(); itr != order.end(); ++itr) {
+      itr->second->ResolveNotify();
+    }
+    ObliterateUnlock();
+  }
+
+  void Environment::LayoutNotifyUnqueue(Layout *layout) {
+    std::vector<Layout *>::iterator itr = find(m_layoutNotify.begin(), m_layoutNotify.end(), layout);
+    if (itr == m_layoutNotify.end()) {
+      LogError("Internal problem, attempted to unqueue layout notification and failed");
+    } else {
+      m_layoutNotify.erase(itr);
+    }
+  }
+
+  void Environment::ArrangeFlush() {
+    // Arranging reads layout, which would otherwise flush again from inside; anything queued while we're working gets its own flush
+    std::vector<Layout *> queue;
+    queue.swap(m_arrangeQueue);
+
+    for (std::vector<Layout *>::const_iterator itr = queue.begin(); itr != queue.end(); ++itr) {
+      (*itr)->m_arrangeQueued = false;
+    }
+
+    // Arrangers commonly read a lot of layout, then change a lot of it; batching keeps the changes from cascading one at a time
+    LayoutBatchBegin();
+    for (std::vector<Layout *>::const_iterator itr = queue.begin(); itr != queue.end(); ++itr) {
+      (*itr)->ArrangeDeferred();
+    }
+    LayoutBatchEnd();
+  }
+
+  void Environment::ArrangeUnqueue(Layout *layout) {
+    std::vector<Layout *>::iterator itr = find(m_arrangeQueue.begin(), m_arrangeQueue.end(), layout);
+    if (itr == m_arrangeQueue.end()) {
+      LogError("Internal problem, attempted to unqueue layout arrangement and failed");
+    } else {
+      m_arrangeQueue.erase(itr);
+    }
+  }
+
+  void Environment::LayoutBatchFlush() {
+    // Invalidate() only defers while a batch is open, so close it temporarily; a flush can happen from a geometry query in the middle of a batch
+    int depth = m_layoutBatchDepth;
+    m_layoutBatchDepth = 0;
+
+    // Each layout appears once no matter how many times it was changed, and the recursive invalidation stops at anything already invalidated, so every dependent is visited once
+    for (std::vector<Layout *>::const_iterator itr = m_layoutBatchPending.begin(); itr != m_layoutBatchPending.end(); ++itr) {
+      Layout *layout = *itr;
+      unsigned char axes = layout->m_batchPending;
+      layout->m_batchPending = 0;
+
+      if (axes & (1 << X)) {
+        layout->Invalidate(X);
+      }
+      if (axes & (1 << Y)) {
+        layout->Invalidate(Y);
+      }
+    }
+    m_layoutBatchPending.clear();
+
+    m_layoutBatchDepth = depth;
+  }
+
+  void Environment::LayoutBatchUnqueue(Layout *layout) {
+    std::vector<Layout *>::iterator itr = find(m_layoutBatchPending.begin(), m_layoutBatchPending.end(), layout);
+    if (itr == m_layoutBatchPending.end()) {
+      LogError("Internal problem, attempted to unqueue from layout batch and failed");
+    } else {
+      m_layoutBatchPending.erase(itr);
+    }
+    layout->m_batchPending = 0;
+  }
+
   void Environment::LayoutStack_Push(const Layout *layout, Axis axis, float pt) {
+    if (m_layoutStackSuspended) {
+      return;
+    }
+
     LayoutStack_Entry entry = {layout, axis, pt};
     m_layoutStack.push_back(entry);
   }
 
   void Environment::LayoutStack_Push(const Layout *layout, Axis axis) {
+    if (m_layoutStackSuspended) {
+      return;
+    }
+
     LayoutStack_Entry entry = {layout, axis, detail::Undefined};
     m_layoutStack.push_back(entry);
   }
 
   void Environment::LayoutStack_Pop() {
+    if (m_layoutStackSuspended) {
+      return;
+    }
+
     m_layoutStack.pop_back();
   }
 
@@ -391,6 +1088,13 @@ namespace Frames {
   }
 
   void Environment::DestroyingLayout(Layout *layout) {
+    if (m_animator) {
+      m_animator->LayoutDestroyed(layout);
+    }
+
+    // Normally ChildRemove() has already done this, but the root never has a parent
+    m_displayListDirty = true;
+
     if (m_over == layout) {
       m_over = 0;
       // TODO: refresh mouse position based on the new layout?
@@ -485,18 +1189,91 @@ namespace Frames {
     }
 
     if (m_obliterateLockCount == 0) {
-      // WARNING: At the moment, changes to this function must be mirrored in Layout::zinternalObliterate. This solution sucks and should be fixed.
+      ObliterateFlush();
+    }
+  }
 
-      // Detach all before destroying; this isn't strictly necessary for correctness, but it will prevent error spam
-      for (std::set<Layout *, detail::LayoutIdSorter>::const_iterator itr = m_obliterateQueues.begin(); itr != m_obliterateQueues.end(); ++itr) {
+  void Environment::ObliterateFlush() {
+    // Destroy fires for everything before anything is torn down, so handlers still see an intact hierarchy. Anything they obliterate joins the same sweep.
+    std::vector<Layout *> roots;
+    ++m_obliterateLockCount;
+    while (!m_obliterateQueues.empty()) {
+      std::vector<Layout *> detaching(m_obliterateQueues.begin(), m_obliterateQueues.end());
+      m_obliterateQueues.clear();
+
+      for (std::vector<Layout *>::const_iterator itr = detaching.begin(); itr != detaching.end(); ++itr) {
         (*itr)->ObliterateDetach();
       }
+      roots.insert(roots.end(), detaching.begin(), detaching.end());
+    }
+    --m_obliterateLockCount;
 
-      // Completely destroy the frames
-      while (!m_obliterateQueues.empty()) {
-        (*m_obliterateQueues.begin())->ObliterateExtract(); // will remove itself from the table, in theory
+    ObliterateSweep(roots);
+  }
+
+  void Environment::ObliterateSweep(const std::vector<Layout *> &roots) {
+    std::vector<Layout *> doomed;
+    for (std::vector<Layout *>::const_iterator itr = roots.begin(); itr != roots.end(); ++itr) {
+      (*itr)->ObliterateMark(&doomed);
+    }
+
+    // Pins between doomed layouts simply vanish with them; only pins that cross the boundary need individual attention.
+    // Outgoing pins go first. Survivors never depend on the layouts that pin to them, so dropping those costs no invalidation, and afterwards the invalidation caused by clearing incoming pins can't wander into the doomed set.
+    for (std::vector<Layout *>::const_iterator itr = doomed.begin(); itr != doomed.end(); ++itr) {
+      (*itr)->ObliterateUnlinkTargets();
+    }
+    for (std::vector<Layout *>::const_iterator itr = doomed.begin(); itr != doomed.end(); ++itr) {
+      (*itr)->ObliterateUnlinkDependents();
+    }
+
+    // One pass over each pending list, rather than a search per layout
+    m_invalidated.erase(std::remove_if(m_invalidated.begin(), m_invalidated.end(), &Environment::ObliterateDoomed), m_invalidated.end());
+    // Parked layouts are filed under one of their own ancestors, and obliteration takes whole subtrees, so a doomed key never holds survivors
+    for (ParkedMap::iterator itr = m_resolveParked.begin(); itr != m_resolveParked.end(); ) {
+      if (!itr->first->m_obliterating) {
+        itr->second.erase(std::remove_if(itr->second.begin(), itr->second.end(), &Environment::ObliterateDoomed), itr->second.end());
+      }
+      if (itr->first->m_obliterating || itr->second.empty()) {
+        m_resolveParked.erase(itr++);
+      } else {
+        ++itr;
       }
     }
+    m_layoutNotify.erase(std::remove_if(m_layoutNotify.begin(), m_layoutNotify.end(), &Environment::ObliterateDoomed), m_layoutNotify.end());
+    m_arrangeQueue.erase(std::remove_if(m_arrangeQueue.begin(), m_arrangeQueue.end(), &Environment::ObliterateDoomed), m_arrangeQueue.end());
+    m_layoutBatchPending.erase(std::remove_if(m_layoutBatchPending.begin(), m_layoutBatchPending.end(), &Environment::ObliterateDoomed), m_layoutBatchPending.end());
+
+    // Only the roots need to leave a surviving parent; everything else goes along with its own parent's child lists
+    for (std::vector<Layout *>::const_iterator itr = roots.begin(); itr != roots.end(); ++itr) {
+      Layout *root = *itr;
+      if (root->m_parent && !root->m_parent->m_obliterating) {
+        root->m_parent->ChildRemove(static_cast<Frame *>(root));
+      }
+    }
+
+    for (std::vector<Layout *>::const_iterator itr = doomed.begin(); itr != doomed.end(); ++itr) {
+      Layout *layout = *itr;
+
+      // Already out of all our lists, so the destructor doesn't need to go looking
+      layout->m_resolved = true;
+      layout->m_resolveParked = 0;
+      layout->m_notifyQueued = false;
+      layout->m_arrangeQueued = false;
+      layout->m_batchPending = 0;
+
+      layout->m_parent = 0;
+      layout->m_children.clear();
+      layout->m_children_implementation.clear();
+      layout->m_children_nonimplementation.clear();
+    }
+
+    for (std::vector<Layout *>::const_iterator itr = doomed.begin(); itr != doomed.end(); ++itr) {
+      delete *itr;
+    }
+  }
+
+  /*static*/ bool Environment::ObliterateDoomed(const Layout *layout) {
+    return layout->m_obliterating;
   }
 
   bool Environment::ObliterateLocked() const {
@@ -506,9 +1283,5 @@ namespace Frames {
   void Environment::ObliterateQueue(Layout *layout) {
     m_obliterateQueues.insert(layout);
   }
-
-  void Environment::ObliterateDequeue(Layout *layout) {
-    m_obliterateQueues.erase(layout);
-  }
 }
 
@@ -19,4 +19,11 @@
 
 #include "frames/event.h"
 
-// File currently exists for the sole purpose of ensuring that its associated header builds cleanly.
+namespace Frames {
+  // Plain zero-initialized static, so it's valid before any dynamic initialization happens; verbs are usually globals constructed in arbitrary order
+  static unsigned int s_verbCount;
+
+  /*static*/ unsigned int VerbGeneric::IndexAllocate() {
+    return s_verbCount++;
+  }
+}
@@ -33,7 +33,7 @@ namespace Frames {
       Configuration::Get().LoggerGet()->LogError("Attempted to create Frame with null parent");
       return 0;
     }
-    return new Frame(parent, name);
+    return new (parent->EnvironmentGet()) Frame(parent, name);
   }
 
   void Frame::BackgroundSet(const Color &color) {
@@ -72,6 +72,16 @@ namespace Frames {
     }
   }
 
+  Frame *Frame::CloneCreate(Layout *parent) const {
+    return Frame::Create(parent, NameGet());
+  }
+
+  void Frame::CloneCopy(Layout *clone, const CloneMap &clones) const {
+    Layout::CloneCopy(clone, clones);
+
+    static_cast<Frame *>(clone)->BackgroundSet(m_bg);
+  }
+
   Frame::Frame(Layout *parent, const std::string &name) :
     Layout(parent->EnvironmentGet(), name),
       m_bg(0, 0, 0, 0)
@@ -346,6 +346,40 @@ namespace Frames {
     m_queue.push_back(element);
   }
 
+  void Input::Sequence::Coalesce() {
+    if (m_queue.empty()) {
+      return;
+    }
+
+    // Classic in-place compaction; "last" is the most recent Command we're keeping
+    int last = 0;
+    for (int i = 1; i < (int)m_queue.size(); ++i) {
+      Command &kept = m_queue[last];
+      const Command &next = m_queue[i];
+
+      if (kept.m_type == next.m_type) {
+        if (next.m_type == Command::MOUSEMOVE) {
+          kept.m_mouseMoveX = next.m_mouseMoveX;
+          kept.m_mouseMoveY = next.m_mouseMoveY;
+          continue;
+        } else if (next.m_type == Command::MOUSEWHEEL) {
+          kept.m_mouseWheelDelta += next.m_mouseWheelDelta;
+          continue;
+        } else if (next.m_type == Command::KEYTEXT) {
+          kept.m_keyText += next.m_keyText;
+          continue;
+        }
+      }
+
+      ++last;
+      if (last != i) {
+        m_queue[last] = next;
+      }
+    }
+
+    m_queue.resize(last + 1);
+  }
+
   void Input::Sequence::Process(Environment *env) const {
     for (int i = 0; i < (int)m_queue.size(); ++i)
     {
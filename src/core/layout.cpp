@@ -24,6 +24,7 @@
 #include "frames/environment.h"
 #include "frames/event_definition.h"
 #include "frames/frame.h"
+#include "frames/profiler.h"
 #include "frames/rect.h"
 #include "frames/renderer.h"
 
@@ -127,6 +128,14 @@ namespace Frames {
       return 0.f;
     }
 
+    // Deferred arrangements and invalidations have to land before we trust any cache
+    if (!m_env->m_arrangeQueue.empty()) {
+      m_env->ArrangeFlush();
+    }
+    if (!m_env->m_layoutBatchPending.empty()) {
+      m_env->LayoutBatchFlush();
+    }
+
     const AxisData &ax = m_axes[axis];
 
     // Check our caches
@@ -236,6 +245,14 @@ namespace Frames {
       return 0.f;
     }
 
+    // Deferred arrangements and invalidations have to land before we trust any cache
+    if (!m_env->m_arrangeQueue.empty()) {
+      m_env->ArrangeFlush();
+    }
+    if (!m_env->m_layoutBatchPending.empty()) {
+      m_env->LayoutBatchFlush();
+    }
+
     const AxisData &ax = m_axes[axis];
 
     // Check our cache
@@ -278,6 +295,13 @@ namespace Frames {
   Layout *Layout::ProbeAsMouse(float x, float y) const {
     if (!VisibleGet()) return 0; // nope
 
+    // Everything from here down is tested in our own untransformed space
+    if (RenderTransformGet()) {
+      Vector local = RenderTransformInverse(Vector(x, y));
+      x = local.x;
+      y = local.y;
+    }
+
     if (m_fullMouseMasking && !MouseMaskingTest(x, y)) return 0;
 
     for (ChildrenList::const_reverse_iterator itr = m_children.rbegin(); itr != m_children.rend(); ++itr) {
@@ -293,18 +317,61 @@ namespace Frames {
   }
 
   Frame *Layout::ChildGetByName(const std::string &name) const {
-    for (ChildrenList::const_iterator itr = m_children_nonimplementation.begin(); itr != m_children_nonimplementation.end(); ++itr) {
-      if ((*itr)->NameGet() == name) {
-        return *itr;
+    // If nothing has the name, it isn't interned, and nothing can match
+    const detail::Name *interned = m_env->m_names.Find(name);
+    return interned ? ChildGetByNameInterned(interned, false) : 0;
+  }
+
+  Frame *Layout::ChildImplementationGetByName(const std::string &name) const {
+    const detail::Name *interned = m_env->m_names.Find(name);
+    return interned ? ChildGetByNameInterned(interned, true) : 0;
+  }
+
+  Frame *Layout::FindByPath(const std::string &path) const {
+    const Layout *current = this;
+    std::string::size_type start = 0;
+    while (current) {
+      std::string::size_type end = path.find('.', start);
+      Frame *child = current->ChildGetByName(path.substr(start, end == std::string::npos ? std::string::npos : end - start));
+      if (end == std::string::npos) {
+        return child;
       }
+
+      current = child;
+      start = end + 1;
     }
 
     return 0;
   }
 
-  Frame *Layout::ChildImplementationGetByName(const std::string &name) const {
-    for (ChildrenList::const_iterator itr = m_children_implementation.begin(); itr != m_children_implementation.end(); ++itr) {
-      if ((*itr)->NameGet() == name) {
+  Frame *Layout::ChildGetByNameInterned(const detail::Name *name, bool implementation) const {
+    if (!m_childIndex && m_children.size() >= CHILD_INDEX_MINIMUM) {
+      m_childIndex = new ChildIndex(ChildIndex::key_compare(), ChildIndex::allocator_type(&m_env->m_slabHeap));
+      for (ChildrenList::const_iterator itr = m_children.begin(); itr != m_children.end(); ++itr) {
+        m_childIndex->insert(std::make_pair(ChildIndexKeyGet(*itr), *itr));
+      }
+    }
+
+    if (m_childIndex) {
+      // Sorts before every child with this name and strata, so we land on the one a scan of our children would have found first
+      ChildIndexKey key;
+      key.name = name;
+      key.implementation = implementation;
+      key.layer = -std::numeric_limits<float>::infinity();
+      key.order = 0;
+
+      ChildIndex::const_iterator itr = m_childIndex->lower_bound(key);
+      if (itr == m_childIndex->end() || itr->first.name != name || itr->first.implementation != implementation) {
+        return 0;
+      }
+
+      return itr->second;
+    }
+
+    // Interned, so comparing addresses is enough
+    const ChildrenList &children = implementation ? m_children_implementation : m_children_nonimplementation;
+    for (ChildrenList::const_iterator itr = children.begin(); itr != children.end(); ++itr) {
+      if ((*itr)->m_name == name) {
         return *itr;
       }
     }
@@ -312,6 +379,47 @@ namespace Frames {
     return 0;
   }
 
+  bool Layout::ChildIndexKey::operator<(const ChildIndexKey &rhs) const {
+    // Interned, so any consistent order on addresses will do for names; the rest matches detail::FrameOrderSorter
+    if (name != rhs.name)
+      return name < rhs.name;
+    if (implementation != rhs.implementation)
+      return implementation < rhs.implementation;
+    if (layer != rhs.layer)
+      return layer < rhs.layer;
+    return order < rhs.order;
+  }
+
+  /*static*/ Layout::ChildIndexKey Layout::ChildIndexKeyGet(const Frame *child) {
+    ChildIndexKey key;
+    key.name = child->m_name;
+    key.implementation = child->m_implementation;
+    key.layer = child->m_layer;
+    key.order = child->m_constructionOrder;
+    return key;
+  }
+
+  void Layout::zinternalNameSet(const std::string &name) {
+    if (m_name->text == name) {
+      return;
+    }
+
+    // Only frames have parents; the index entry has to come out while it still matches our old name
+    Frame *frame = m_parent ? static_cast<Frame *>(this) : 0;
+    if (frame && m_parent->m_childIndex) {
+      m_parent->m_childIndex->erase(ChildIndexKeyGet(frame));
+    }
+
+    const detail::Name *previous = m_name;
+    m_name = m_env->m_names.Intern(name);
+
+    if (frame && m_parent->m_childIndex) {
+      m_parent->m_childIndex->insert(std::make_pair(ChildIndexKeyGet(frame), frame));
+    }
+
+    m_env->m_names.Release(previous);
+  }
+
   void Layout::DebugLayoutDump() const {
     FRAMES_DEBUG("Dump for layout %s", DebugNameGet().c_str());
     FRAMES_DEBUG("  XAXIS:");
@@ -338,17 +446,32 @@ namespace Frames {
   // DUPLICATE CODE WARNING: Initializers are also used in the parent constructor!
   Layout::Layout(Environment *env, const std::string &name) :
       m_resolved(false),
+      m_resolveParked(0),
+      m_resolveComponent(-1),
+      m_batchPending(0),
       m_last_width(-1),
       m_last_height(-1),
       m_last_x(-1),
       m_last_y(-1),
+      m_notifyQueued(false),
+      m_arrangeQueued(false),
+      m_obliterating(false),
       m_layer(0),
       m_implementation(false),
       m_parent(0),
       m_visible(true),
+      m_renderTranslation(0, 0),
+      m_renderScale(1),
+      m_renderOpacity(1),
+      m_children(ChildrenList::key_compare(), ChildrenList::allocator_type(env ? &env->m_slabHeap : 0)),
+      m_children_implementation(ChildrenList::key_compare(), ChildrenList::allocator_type(env ? &env->m_slabHeap : 0)),
+      m_children_nonimplementation(ChildrenList::key_compare(), ChildrenList::allocator_type(env ? &env->m_slabHeap : 0)),
       m_fullMouseMasking(false),
       m_inputMode(IM_NONE),
-      m_name(name),
+      m_name(env ? env->m_names.Intern(name) : 0),
+      m_childIndex(0),
+      m_events(env ? &env->m_slabHeap : 0),
+      m_eventMaskChainGeneration(0),
       m_env(0)
   {
     if (!env) {
@@ -373,19 +496,87 @@ namespace Frames {
     FRAMES_LAYOUT_CHECK(m_children.empty(), "Layout destroyed while still connected");
 
     // Clear ourselves out of the resolved todo
-    if (!m_resolved) {
+    if (m_resolveParked) {
+      m_env->UnmarkParked(this);
+    } else if (!m_resolved) {
       m_env->UnmarkInvalidated(this);
     }
+
+    // And out of the pending notifications
+    if (m_notifyQueued) {
+      m_env->LayoutNotifyUnqueue(this);
+    }
+
+    // And out of the probe index
+    if (m_inputMode) {
+      m_env->m_probeIndex.Remove(this);
+    }
+
+    // And out of the set of transformed layouts
+    if (RenderTransformGet()) {
+      m_env->m_renderTransformed.erase(this);
+    }
+
+    // And out of the arrangement queue
+    if (m_arrangeQueued) {
+      m_env->ArrangeUnqueue(this);
+    }
+
+    // And out of any open layout batch
+    if (m_batchPending) {
+      m_env->LayoutBatchUnqueue(this);
+    }
     
     // Take out all our event handlers
-    while (!m_events.empty()) {
-      EventLookup::iterator eventTable = m_events.begin();
-      EventDestroy(eventTable, eventTable->second.begin()); // kaboom!
+    while (!m_events.Empty()) {
+      EventLookup::const_iterator eventTable = m_events.begin();
+      EventDestroy(eventTable->verb, eventTable->callbacks->begin()); // kaboom!
       // this potentially invalidates our eventTable iterator so now we need to go and do it all again
     }
 
     // Notify the environment
     m_env->DestroyingLayout(this);
+
+    delete m_childIndex;
+    m_env->m_names.Release(m_name);
+  }
+
+  // Prefixed to every layout allocation, so that delete can find its way back to the heap it came from
+  struct LayoutAllocationHeader {
+    detail::SlabHeap *heap;
+    std::size_t bytes;
+  };
+  static const std::size_t c_layoutAllocationHeaderBytes = 16;  // keeps the layout itself suitably aligned
+  BOOST_STATIC_ASSERT(sizeof(LayoutAllocationHeader) <= c_layoutAllocationHeaderBytes);
+
+  /*static*/ void *Layout::operator new(std::size_t bytes, Environment *env) {
+    detail::SlabHeap *heap = env ? &env->m_slabHeap : 0;
+    std::size_t total = bytes + c_layoutAllocationHeaderBytes;
+    LayoutAllocationHeader *header = static_cast<LayoutAllocationHeader *>(heap ? heap->Allocate(total) : ::operator new(total));
+    header->heap = heap;
+    header->bytes = total;
+    return reinterpret_cast<char *>(header) + c_layoutAllocationHeaderBytes;
+  }
+
+  /*static*/ void *Layout::operator new(std::size_t bytes) {
+    return operator new(bytes, 0);
+  }
+
+  /*static*/ void Layout::operator delete(void *block) {
+    if (!block) {
+      return;
+    }
+
+    LayoutAllocationHeader *header = reinterpret_cast<LayoutAllocationHeader *>(static_cast<char *>(block) - c_layoutAllocationHeaderBytes);
+    if (header->heap) {
+      header->heap->Free(header, header->bytes);
+    } else {
+      ::operator delete(header);
+    }
+  }
+
+  /*static*/ void Layout::operator delete(void *block, Environment *env) {
+    operator delete(block);
   }
 
   void Layout::zinternalPinSet(Axis axis, float mypt, const Layout *target, float targetpt, float offset /*= 0.f*/) {
@@ -413,6 +604,14 @@ namespace Frames {
         return;
       }
 
+      // Only the offset changed, and nothing else decides where this axis is, so everything just slides over
+      // (pending arrangements would land in the middle of the walk, so those take the slow path)
+      if (axa.target == target && (!target || axa.point_target == targetpt) && detail::IsUndefined(ax.connections[1].point_mine) && !m_env->m_layoutBatchDepth && m_env->m_arrangeQueue.empty()) {
+        axa.offset = offset;
+        InvalidateShift(axis);
+        return;
+      }
+
       // If we've been used, then we need to invalidate
       if (!detail::IsUndefined(axa.cached)) {
         Invalidate(axis);
@@ -441,6 +640,14 @@ namespace Frames {
         return;
       }
 
+      // Only the offset changed, and nothing else decides where this axis is, so everything just slides over
+      // (pending arrangements would land in the middle of the walk, so those take the slow path)
+      if (axb.target == target && (!target || axb.point_target == targetpt) && detail::IsUndefined(axa.point_mine) && !m_env->m_layoutBatchDepth && m_env->m_arrangeQueue.empty()) {
+        axb.offset = offset;
+        InvalidateShift(axis);
+        return;
+      }
+
       // If we've been used, then we need to invalidate
       if (!detail::IsUndefined(axb.cached)) {
         Invalidate(axis);
@@ -854,6 +1061,9 @@ namespace Frames {
       return;
     }
 
+    // Anything parked below us may be about to move out from under a hidden frame
+    m_env->ResolveUnparkMoving(this);
+
     // First, remove ourselves from our old parent
     if (m_parent) {
       m_parent->ChildRemove(frame);
@@ -862,6 +1072,9 @@ namespace Frames {
     m_parent = layout;
 
     m_parent->ChildAdd(frame);
+
+    // Our ancestry changed, so every cached ancestor summary below us is wrong
+    ++m_env->m_eventMaskGeneration;
   }
 
   void Layout::zinternalLayerSet(float layer) {
@@ -916,38 +1129,151 @@ namespace Frames {
     }
 
     m_visible = visible;
+    m_env->DisplayListDirty();
+
+    // Anything parked under us may be visible now
+    if (visible) {
+      m_env->ResolveUnparkShown(this);
+    }
+  }
+
+  void Layout::RenderTranslationSet(const Vector &translation) {
+    bool previous = RenderTransformGet();
+    m_renderTranslation = translation;
+    RenderTransformChanged(previous);
+  }
+
+  void Layout::RenderScaleSet(float scale) {
+    if (!(scale > 0)) {
+      m_env->LogError(detail::Format("Attempted to set render scale of %s to %f, which is not positive", DebugNameGet(), scale));
+      return;
+    }
+
+    bool previous = RenderTransformGet();
+    m_renderScale = scale;
+    RenderTransformChanged(previous);
+  }
+
+  void Layout::RenderOpacitySet(float opacity) {
+    bool previous = RenderTransformGet();
+    m_renderOpacity = opacity;
+    RenderTransformChanged(previous);
+  }
+
+  bool Layout::zinternalVisibleChainGet() const {
+    for (const Layout *layout = this; layout; layout = layout->m_parent) {
+      if (!layout->m_visible) {
+        return false;
+      }
+    }
+
+    return true;
   }
 
   // The obliterate process is complicated and worthy of documenting.
-  // If a layout is locked for whatever reason, the obliteration is deferred until later.
+  // Everything goes through the environment's queue. If the environment is locked for whatever reason, the obliteration is deferred until later.
   // The Destroy event fires. This is the last point at which any functions may be called on this frame.
-  // The next step is detaching - the obliterated frame, and all its children, have their event table cleared and all their constraints removed. Also, if any of those frames is the focus, the focus is cleared.
-  // In theory, at this point, this section of the frame hierarchy should no longer be referred to. In practice, we want to be very careful, so we run the Extraction step.
-  // Extraction tracks down all things that refer to this frame, or any of its children, spits out errors, and cleans them up appropriately.
-  // Finally, the frame is entirely shut down and can be deleted.
+  // The next step is detaching - the obliterated frame, and all its children, have their event table cleared. Also, if any of those frames is the focus, the focus is cleared.
+  // Then the whole subtree is swept at once (see Environment::ObliterateSweep). Pins within the subtree are simply forgotten. Pins to layouts outside it are dropped quietly, and pins from layouts outside it are cleared with an error, since in theory nobody should be referring to this section of the hierarchy any more.
+  // Finally, the frames are entirely shut down and can be deleted.
   void Layout::zinternalObliterate() {
-    // WARNING: At the moment, changes to this function must be mirrored in Environment::ObliterateUnlock. This solution sucks and should be fixed.
+    m_env->ObliterateQueue(this);
 
-    if (m_env->ObliterateLocked()) {
-      // The environment will do all the necessarily obliteration
-      m_env->ObliterateQueue(this);
-      return;
+    if (!m_env->ObliterateLocked()) {
+      m_env->ObliterateFlush();
+    }
+  }
+
+  // Cloning happens in three passes over the prototype, all inside one layout batch.
+  // First every clone is created, parents before children, so that the rest can refer to any of them.
+  // Then the generic layout state is copied; pins and handlers that point inside the prototype are remapped or skipped as they go.
+  // Finally each frame type copies its own state, with the entire subtree already in place.
+  Frame *Layout::zinternalCloneSubtree(Layout *parent) const {
+    if (!parent) {
+      FRAMES_LAYOUT_CHECK(false, ":CloneSubtree() attempted with null parent");
+      return 0;
+    }
+
+    if (m_env != parent->EnvironmentGet()) {
+      FRAMES_LAYOUT_CHECK(false, ":CloneSubtree() attempted across environment boundaries");
+      return 0;
+    }
+
+    std::vector<const Layout *> prototypes;
+    CloneGather(&prototypes);
+
+    Environment::LayoutBatch batch(m_env);
+
+    CloneMap clones;
+    Frame *result = 0;
+    for (std::size_t i = 0; i < prototypes.size(); ++i) {
+      const Layout *prototype = prototypes[i];
+
+      Layout *cloneParent = parent;
+      if (prototype != this) {
+        CloneMap::const_iterator itr = clones.find(prototype->m_parent);
+        if (itr == clones.end()) {
+          continue; // parent failed to clone; it's already been reported
+        }
+        cloneParent = itr->second;
+      }
+
+      Layout *clone = prototype->CloneCreate(cloneParent);
+      if (!clone) {
+        continue;
+      }
+
+      if (clone->RttiVirtualGet() != prototype->RttiVirtualGet()) {
+        m_env->LogError(detail::Format("Cloned %s as a %s, since %s doesn't overload CloneCreate()", prototype->DebugNameGet(), clone->TypeGet(), prototype->TypeGet()));
+      }
+
+      clones[prototype] = clone;
+      if (prototype == this) {
+        result = static_cast<Frame *>(clone);
+      }
+    }
+
+    // Our own parent maps to the new one, so pins to it keep the clone in the same place relative to its new parent, and the old parent's plumbing stays behind
+    if (m_parent) {
+      clones[m_parent] = parent;
+    }
+
+    for (std::size_t i = 0; i < prototypes.size(); ++i) {
+      CloneMap::const_iterator itr = clones.find(prototypes[i]);
+      if (itr != clones.end()) {
+        prototypes[i]->CloneCopyLayout(itr->second, clones);
+      }
+    }
+
+    for (std::size_t i = 0; i < prototypes.size(); ++i) {
+      CloneMap::const_iterator itr = clones.find(prototypes[i]);
+      if (itr != clones.end()) {
+        prototypes[i]->CloneCopy(itr->second, clones);
+      }
     }
 
-    ObliterateDetach();
-    ObliterateExtract();
+    return result;
+  }
+
+  Frame *Layout::CloneCreate(Layout *parent) const {
+    m_env->LogError(detail::Format("Attempted to clone %s, which doesn't support cloning", DebugNameGet()));
+    return 0;
   }
 
   bool Layout::EventHooked(const VerbGeneric &event) const {
-    std::map<const VerbGeneric *, std::multiset<Callback, Callback::Sorter> >::const_iterator itr = m_events.find(&event);
-    if (itr == m_events.end()) {
+    if (!m_eventMask.Test(event.IndexGet())) {
       // no handles, we're good
       return false;
     }
+
+    const EventMultiset *eventSet = m_events.Find(&event);
+    if (!eventSet) {
+      // just a collision in the mask
+      return false;
+    }
     
     // We now need to iterate over all events just in case they're all destroy-flagged
-    const std::multiset<Callback, Callback::Sorter> &eventSet = itr->second;
-    for (std::multiset<Callback, Callback::Sorter>::const_iterator itr = eventSet.begin(); itr != eventSet.end(); ++itr) {
+    for (EventMultiset::const_iterator itr = eventSet->begin(); itr != eventSet->end(); ++itr) {
       if (!itr->DestroyFlagGet()) {
         return true;
       }
@@ -957,23 +1283,136 @@ namespace Frames {
     return false;
   }
 
+  void Layout::EventDetach(const EventToken &token) {
+    if (!token.m_layout) {
+      return;
+    }
+
+    if (token.m_layout != this) {
+      FRAMES_LAYOUT_CHECK(false, "Attempted to detach an event using a token from another layout");
+      return;
+    }
+
+    EventDestroy(token.m_verb, token.m_callback);
+  }
+
+  void Layout::EventProfileRecord(const Handle *handle, const Callback &callback, double start) {
+    // The handler may have just turned profiling off
+    if (m_env->m_eventProfiler) {
+      m_env->m_eventProfiler->Record(handle->VerbContextGet(), handle->TargetContextGet()->TypeGet(), callback.FunctorGet(), detail::Clock() - start);
+    }
+  }
+
   void Layout::InputModeSet(InputMode imode) {
     if (imode < 0 || imode >= IM_COUNT) {
       FRAMES_LAYOUT_CHECK(false, "Input mode is invalid");
       return;
     }
 
+    if (m_inputMode == imode) {
+      return;
+    }
+
     m_inputMode = imode;
+
+    // Keep the environment's probe index in sync; if we're not resolved yet, Resolve() will take care of it
+    if (!m_inputMode) {
+      m_env->m_probeIndex.Remove(this);
+    } else if (m_resolved) {
+      m_env->m_probeIndex.Insert(this, BoundsGet());
+    }
   }
   
   void Layout::ChildAdd(Frame *child) {
+    m_env->DisplayListDirty();
     m_children.insert(child);
     (child->zinternalImplementationGet() ? m_children_implementation : m_children_nonimplementation).insert(child);
+
+    if (m_childIndex) {
+      m_childIndex->insert(std::make_pair(ChildIndexKeyGet(child), child));
+    }
   }
 
   void Layout::ChildRemove(Frame *child) {
+    m_env->DisplayListDirty();
     m_children.erase(child);
     (child->zinternalImplementationGet() ? m_children_implementation : m_children_nonimplementation).erase(child);
+
+    if (m_childIndex) {
+      m_childIndex->erase(ChildIndexKeyGet(child));
+    }
+  }
+
+  void Layout::CloneGather(std::vector<const Layout *> *prototypes) const {
+    prototypes->push_back(this);
+
+    for (ChildrenList::const_iterator itr = m_children.begin(); itr != m_children.end(); ++itr) {
+      if (CloneChildTest(*itr)) {
+        (*itr)->CloneGather(prototypes);
+      }
+    }
+  }
+
+  void Layout::CloneCopyLayout(Layout *clone, const CloneMap &clones) const {
+    clone->zinternalLayerSet(m_layer);
+    clone->zinternalImplementationSet(m_implementation);
+    clone->VisibleSet(m_visible);
+    clone->RenderTranslationSet(m_renderTranslation);
+    clone->RenderScaleSet(m_renderScale);
+    clone->RenderOpacitySet(m_renderOpacity);
+    clone->InputModeSet(m_inputMode);
+    clone->MouseMaskingFullSet(m_fullMouseMasking);
+
+    for (int axis = 0; axis < 2; ++axis) {
+      const AxisData &ax = m_axes[axis];
+
+      clone->SizeDefaultSet((Axis)axis, ax.size_default);
+      if (!detail::IsUndefined(ax.size_set)) {
+        clone->zinternalSizeSet((Axis)axis, ax.size_set);
+      }
+
+      for (int i = 0; i < 2; ++i) {
+        const AxisData::Connector &connector = ax.connections[i];
+        if (detail::IsUndefined(connector.point_mine)) {
+          continue;
+        }
+
+        // Pins within the prototype follow it to the clones; pins that leave it stay where they were
+        const Layout *target = connector.target;
+        CloneMap::const_iterator itr = clones.find(target);
+        if (itr != clones.end()) {
+          target = itr->second;
+        }
+
+        clone->zinternalPinSet((Axis)axis, connector.point_mine, target, connector.point_target, connector.offset);
+      }
+    }
+
+    // Delegates bound to a layout we're cloning are part of that layout's plumbing, and its clone has already set up its own
+    for (EventLookup::const_iterator entry = m_events.begin(); entry != m_events.end(); ++entry) {
+      for (EventMultiset::const_iterator callback = entry->callbacks->begin(); callback != entry->callbacks->end(); ++callback) {
+        if (callback->DestroyFlagGet()) {
+          continue;
+        }
+
+        DelegateMemento memento;
+        if (callback->FunctorGet().MementoGet(&memento) && clones.count(static_cast<const Layout *>(memento.GetBoundObject()))) {
+          continue;
+        }
+
+        clone->ResolveEagerPrepare(entry->verb);
+        clone->m_events.Get(entry->verb).insert(callback->CloneGet());
+        clone->m_eventMask.Set(entry->verb->IndexGet());
+      }
+    }
+    ++m_env->m_eventMaskGeneration;
+  }
+
+  void Layout::ArrangeQueue() {
+    if (!m_arrangeQueued) {
+      m_arrangeQueued = true;
+      m_env->m_arrangeQueue.push_back(this);
+    }
   }
 
   void Layout::Render(detail::Renderer *renderer) const {
@@ -982,7 +1421,13 @@ namespace Frames {
       return;
     }
 
+    // Environment::DisplayListAppend mirrors this; keep them in sync
     if (m_visible) {
+      bool transform = RenderTransformGet();
+      if (transform) {
+        RenderTransformPush(renderer);
+      }
+
       RenderElement(renderer);
 
       if (!m_children.empty()) {
@@ -994,9 +1439,43 @@ namespace Frames {
 
         RenderElementPostChild(renderer);
       }
+
+      if (transform) {
+        RenderTransformPop(renderer);
+      }
+    }
+  }
+
+  void Layout::RenderTransformChanged(bool previous) {
+    // Only switching transforms on or off changes anything structural; the values themselves are read as we render
+    bool current = RenderTransformGet();
+    if (current != previous) {
+      if (current) {
+        m_env->m_renderTransformed.insert(this);
+      } else {
+        m_env->m_renderTransformed.erase(this);
+      }
+      m_env->DisplayListDirty();
     }
   }
 
+  void Layout::RenderTransformPush(detail::Renderer *renderer) const {
+    // Scale about our center: p -> center + (p - center) * scale + translation
+    Vector center((LeftGet() + RightGet()) / 2, (TopGet() + BottomGet()) / 2);
+    renderer->TransformPush(m_renderScale, center * (1 - m_renderScale) + m_renderTranslation);
+    renderer->AlphaPush(m_renderOpacity);
+  }
+
+  void Layout::RenderTransformPop(detail::Renderer *renderer) const {
+    renderer->AlphaPop();
+    renderer->TransformPop();
+  }
+
+  Vector Layout::RenderTransformInverse(const Vector &point) const {
+    Vector center((LeftGet() + RightGet()) / 2, (TopGet() + BottomGet()) / 2);
+    return (point - center * (1 - m_renderScale) - m_renderTranslation) / m_renderScale;
+  }
+
   // Technically, invalidate could be a lot more specific. There are cases where invalidating an entire axis is unnecessary - A depends on one connection, B depends on another connection, and only A's connection is invalidated.
   // It's unclear if this would be worth the additional overhead and complexity.
   // Invalidating extra stuff, while slow, is at least always correct.
@@ -1010,6 +1489,15 @@ namespace Frames {
     const AxisData &ax = m_axes[axis];
 
     if (!detail::IsUndefined(ax.size_cached) || !detail::IsUndefined(ax.connections[0].cached) || !detail::IsUndefined(ax.connections[1].cached)) {
+      // Inside a layout batch we just remember the axis; the recursive invalidation happens once, when the batch ends
+      if (m_env->m_layoutBatchDepth) {
+        if (!m_batchPending) {
+          m_env->m_layoutBatchPending.push_back(this);
+        }
+        m_batchPending |= 1 << axis;
+        return;
+      }
+
       // Do these first so we don't get ourselves trapped in an infinite loop
       ax.size_cached = detail::Undefined;
       ax.connections[0].cached = detail::Undefined;
@@ -1026,15 +1514,65 @@ namespace Frames {
     }
   }
 
+  void Layout::InvalidateShift(Axis axis) {
+    const AxisData &ax = m_axes[axis];
+    const AxisData::Connector &axa = ax.connections[0];
+    const AxisData::Connector &axb = ax.connections[1];
+
+    // If our points were never computed then nothing downstream was either
+    if (detail::IsUndefined(axa.cached) && detail::IsUndefined(axb.cached)) {
+      return;
+    }
+
+    // Half-computed or broken values (this includes detail::Processing) can't be shifted; start over
+    if ((!detail::IsUndefined(axa.cached) && axa.cached != axa.cached) || (!detail::IsUndefined(axb.cached) && axb.cached != axb.cached)) {
+      Invalidate(axis);
+      return;
+    }
+
+    // Recompute from the target rather than adding the difference, so repeated slides can't accumulate rounding error; whatever we're pinned to is already up to date
+    if (!detail::IsUndefined(axa.cached)) {
+      axa.cached = axa.target ? axa.target->PointGet(axis, axa.point_target) + axa.offset : axa.offset;
+    }
+    if (!detail::IsUndefined(axb.cached)) {
+      axb.cached = axb.target ? axb.target->PointGet(axis, axb.point_target) + axb.offset : axb.offset;
+    }
+
+    // Our size hasn't changed, so anything hanging entirely off us moves the same way; anything else needs recomputing
+    // Children appear once per connection to us, so skip duplicates
+    for (AxisData::ChildrenList::const_iterator itr = ax.children.begin(); itr != ax.children.end(); itr = ax.children.upper_bound(*itr)) {
+      if ((*itr)->InvalidateShiftPure(axis, this)) {
+        (*itr)->InvalidateShift(axis);
+      } else {
+        (*itr)->Invalidate(axis);
+      }
+    }
+
+    if (m_resolved) {
+      m_resolved = false;
+      m_env->MarkInvalidated(this);
+    }
+  }
+
+  bool Layout::InvalidateShiftPure(Axis axis, const Layout *target) const {
+    const AxisData &ax = m_axes[axis];
+    for (int i = 0; i < 2; ++i) {
+      if (!detail::IsUndefined(ax.connections[i].point_mine) && ax.connections[i].target != target) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
   void Layout::ObliterateDetach() {
     // fire off our final event
     EventTrigger(Event::Destroy);
 
     // clear events so they can't fire
-    m_events.clear();
-
-    // kill my layout to unpin things
-    zinternalConstraintClearAll();
+    m_events.Clear();
+    m_eventMask.Clear();
+    ++m_env->m_eventMaskGeneration;
 
     if (m_env->FocusGet() == this) {
       m_env->FocusSet(0);
@@ -1046,51 +1584,47 @@ namespace Frames {
     }
   }
 
-  void Layout::ObliterateExtract() {
-    // at this point, nobody should be referring to me, in theory
-    ObliterateExtractAxis(X);
-    ObliterateExtractAxis(Y);
-
-    // but just to make sure
-    if (m_env->FocusGet() == this) {
-      m_env->FocusSet(0);
-    }
-
-    // OBLITERATE ALL CHILDREN.
-    for (ChildrenList::const_iterator itr = m_children.begin(); itr != m_children.end(); ) {
-      // little dance here 'cause our children are going to be fucking around with our structure
-      ChildrenList::const_iterator kill = itr;
-      ++itr;
-      (*kill)->ObliterateExtract();
+  void Layout::ObliterateMark(std::vector<Layout *> *doomed) {
+    if (m_obliterating) {
+      // Already covered by an ancestor that's also being obliterated
+      return;
     }
 
-    // Detach ourselves from our parent
-    if (m_parent) {
-      Frame *frame = Cast<Frame>(this);
-      if (!frame) {
-        FRAMES_LAYOUT_CHECK(false, ":Obliterate() called on a non-frame that somehow has a parent");
-        return;
-      }
+    m_obliterating = true;
+    doomed->push_back(this);
 
-      m_parent->ChildRemove(frame);
+    for (ChildrenList::const_iterator itr = m_children.begin(); itr != m_children.end(); ++itr) {
+      (*itr)->ObliterateMark(doomed);
     }
-    m_parent = 0;
-
-    // And now we're safe to delete ourselves
-    m_env->ObliterateDequeue(this);
-    delete this;
   }
 
-  void Layout::ObliterateExtractAxis(Axis axis) {
-    if (!(axis == X || axis == Y)) {
-      FRAMES_LAYOUT_CHECK(false, "Axis is invalid");
-      return;
+  void Layout::ObliterateUnlinkTargets() {
+    for (int axis = 0; axis < 2; ++axis) {
+      for (int i = 0; i < 2; ++i) {
+        AxisData::Connector &connector = m_axes[axis].connections[i];
+        if (connector.target && !connector.target->m_obliterating) {
+          connector.target->m_axes[axis].children.erase(this);
+        }
+
+        connector.target = 0;
+        connector.point_mine = detail::Undefined;
+        connector.point_target = detail::Undefined;
+        connector.offset = detail::Undefined;
+      }
     }
+  }
 
-    const AxisData &ax = m_axes[axis];
-    while (!ax.children.empty()) {
-      Layout *layout = *ax.children.begin();
-      layout->ObliterateExtractFrom(axis, this);
+  void Layout::ObliterateUnlinkDependents() {
+    for (int axis = 0; axis < 2; ++axis) {
+      const AxisData &ax = m_axes[axis];
+      AxisData::ChildrenList::const_iterator itr = ax.children.begin();
+      while (itr != ax.children.end()) {
+        Layout *dependent = *itr;
+        if (!dependent->m_obliterating) {
+          dependent->ObliterateExtractFrom((Axis)axis, this);  // removes it from our list
+        }
+        itr = ax.children.upper_bound(dependent);
+      }
     }
   }
 
@@ -1119,16 +1653,42 @@ namespace Frames {
   }
 
   void Layout::Resolve() {
+    if (!ResolveEagerGet()) {
+      // Nothing needs our geometry right now, so leave it to be computed by whoever asks first; usually that's the render pass
+      m_resolved = true;
+      return;
+    }
+
     float nx = LeftGet();
-    RightGet();
+    float nr = RightGet();
     float ny = TopGet();
-    BottomGet();
+    float nb = BottomGet();
     
     float nw = WidthGet();
     float nh = HeightGet();
 
     m_resolved = true;
 
+    if (m_inputMode) {
+      m_env->m_probeIndex.Insert(this, Rect(nx, ny, nr, nb));
+    }
+
+    // Events don't fire here; the environment delivers them once everything is resolved, so each layout gets at most one Move/Size per pass
+    if (!m_notifyQueued && (nw != m_last_width || nh != m_last_height || nx != m_last_x || ny != m_last_y)) {
+      m_notifyQueued = true;
+      m_env->LayoutNotifyQueue(this);
+    }
+  }
+
+  void Layout::ResolveNotify() {
+    m_notifyQueued = false;
+
+    // We may have moved again since we were queued, possibly right back to where we were
+    float nx = LeftGet();
+    float ny = TopGet();
+    float nw = WidthGet();
+    float nh = HeightGet();
+
     bool sizechange = (nw != m_last_width || nh != m_last_height);
     bool movechange = (nx != m_last_x || ny != m_last_y);
 
@@ -1144,29 +1704,65 @@ namespace Frames {
     if (sizechange || movechange) {
       EventTrigger(Event::Move);
     }
+  }
+
+  bool Layout::ResolveEagerGet() const {
+    // Mask collisions just make us eager for no reason, which is harmless
+    return m_inputMode || m_eventMask.Test(Event::Move.IndexGet()) || m_eventMask.Test(Event::Size.IndexGet());
+  }
+
+  bool Layout::ResolveCachedGet() const {
+    for (int axis = 0; axis < 2; ++axis) {
+      const AxisData &ax = m_axes[axis];
+      if (detail::IsUndefined(ax.size_cached)) {
+        return false;
+      }
+
+      for (int i = 0; i < 2; ++i) {
+        if (!detail::IsUndefined(ax.connections[i].point_mine) && detail::IsUndefined(ax.connections[i].cached)) {
+          return false;
+        }
+      }
+    }
+
+    return true;
+  }
+
+  void Layout::ResolveEagerPrepare(const VerbGeneric *event) {
+    if ((event != &Event::Move && event != &Event::Size) || !m_resolved || ResolveEagerGet()) {
+      return;
+    }
 
-    // Todo: queue up movement events
+    // We haven't been tracking our geometry, so catch up now; otherwise the new handler would be told about every change made since we were last eager
+    m_last_x = LeftGet();
+    m_last_y = TopGet();
+    m_last_width = WidthGet();
+    m_last_height = HeightGet();
   }
 
   bool Layout::Callback::Sorter::operator()(const Layout::Callback &lhs, const Layout::Callback &rhs) const {
     return lhs.m_priority < rhs.m_priority;
   }
   
+  Layout::Callback Layout::Callback::CloneGet() const {
+    Callback rv;
+    rv.m_priority = m_priority;
+    rv.m_functor = m_functor;
+    rv.m_invoke = m_invoke;
+    return rv;
+  }
+
   void Layout::Callback::Teardown(Environment *env) const {
     
   }
 
   //Layout::CallbackIterator::CallbackIterator() : m_state(STATE_COMPLETE), m_diveIndex(0), m_target(0), m_event(0) { };
 
-  Layout::CallbackIterator::CallbackIterator(Layout *target, const VerbGeneric *event) : m_state(STATE_DIVE), m_diveIndex(0), m_target(target), m_event(event) { // set to STATE_DIVE so that NextIndex() does the right thing
+  Layout::CallbackIterator::CallbackIterator(Layout *target, const VerbGeneric *event) : m_state(STATE_DIVE), m_dives(m_divesInline), m_diveCount(0), m_diveIndex(0), m_diveGeneration(0), m_target(target), m_event(event) { // set to STATE_DIVE so that NextIndex() does the right thing
     if (event->DiveGet()) {
       // Dive event! Accumulate everything we need
-      Layout *ctar = target;
-      while (ctar) {
-        m_dives.push_back(ctar);
-        ctar = ctar->ParentGet();
-      }
-      m_diveIndex = (int)m_dives.size();
+      DiveGather();
+      m_diveIndex = m_diveCount;
       
       IndexNext();
     } else {
@@ -1177,6 +1773,35 @@ namespace Frames {
       m_current->LockFlagIncrement();
     }
   };
+
+  void Layout::CallbackIterator::DiveGather() {
+    m_diveGeneration = m_target->m_env->m_eventMaskGeneration;
+
+    // If nobody up the chain is listening, there's no need to walk it at all
+    const EventMask &chain = m_target->EventMaskChainGet();
+    if (!chain.Test(m_event->DiveGet()->IndexGet()) && !chain.Test(m_event->BubbleGet()->IndexGet())) {
+      return;
+    }
+
+    // Otherwise take the whole chain, since handlers may be attached further up it while we're dispatching; IndexNext() checks each layout's mask as it's reached
+    for (Layout *ctar = m_target; ctar; ctar = ctar->ParentGet()) {
+      DivePush(ctar);
+    }
+  }
+
+  void Layout::CallbackIterator::DivePush(Layout *layout) {
+    if (m_diveCount < DIVES_INLINE) {
+      m_divesInline[m_diveCount++] = layout;
+      return;
+    }
+
+    if (m_divesOverflow.empty()) {
+      m_divesOverflow.assign(m_divesInline, m_divesInline + DIVES_INLINE);
+    }
+    m_divesOverflow.push_back(layout);
+    m_dives = &m_divesOverflow[0];
+    ++m_diveCount;
+  }
   
   Layout::CallbackIterator::~CallbackIterator() {
     if (m_state != STATE_COMPLETE) {
@@ -1223,7 +1848,7 @@ namespace Frames {
         event = event->BubbleGet();
       }
       
-      layout->EventDestroy(layout->m_events.find(event), itr);
+      layout->EventDestroy(event, itr);
     }
   }
   
@@ -1236,14 +1861,19 @@ namespace Frames {
           --m_diveIndex;
         }
       } else if (m_state == STATE_MAIN) {
-        if (m_dives.empty()) {
+        if (!m_diveCount && m_event->DiveGet() && m_diveGeneration != m_target->m_env->m_eventMaskGeneration) {
+          // We skipped the chain, but the main handlers may have hooked the bubble somewhere along it
+          DiveGather();
+        }
+
+        if (!m_diveCount) {
           m_state = STATE_COMPLETE;
           return;
         } else {
           m_state = STATE_BUBBLE; // m_diveIndex is still 0
         }
       } else if (m_state == STATE_BUBBLE) {
-        if (m_diveIndex == (int)m_dives.size() - 1) {
+        if (m_diveIndex == m_diveCount - 1) {
           m_state = STATE_COMPLETE;
           return;
         } else {
@@ -1254,12 +1884,14 @@ namespace Frames {
       Layout *layout = LayoutGet();
       const VerbGeneric *event = VerbGet();
       
-      // TODO: can probably be optimized by not doing a ton of lookups
-      if (layout->m_events.count(event)) {
-        // Sweet! We actually have events here
-        m_current = layout->m_events[event].begin();
-        m_last = layout->m_events[event].end();
-        return;
+      if (layout->m_eventMask.Test(event->IndexGet())) {
+        EventMultiset *eventSet = layout->m_events.Find(event);
+        if (eventSet) {
+          // Sweet! We actually have events here
+          m_current = eventSet->begin();
+          m_last = eventSet->end();
+          return;
+        }
       }
     }
   }
@@ -1282,17 +1914,110 @@ namespace Frames {
     }
   }
   
-  void Layout::EventDestroy(EventLookup::iterator eventTable, EventMultiset::iterator toBeRemoved) {
+  void Layout::EventDestroy(const VerbGeneric *event, EventMultiset::iterator toBeRemoved) {
     if (toBeRemoved->LockFlagGet()) {
       toBeRemoved->DestroyFlagSet();
     } else {
       toBeRemoved->Teardown(m_env);
-      eventTable->second.erase(toBeRemoved);
-      if (eventTable->second.empty()) {
+      EventMultiset *eventSet = m_events.Find(event);
+      eventSet->erase(toBeRemoved);
+      if (eventSet->empty()) {
         // we know nobody's got it locked, so . . .
-        m_events.erase(eventTable);
+        m_events.Erase(event);
+        EventMaskRebuild();
       }
     }
   }
-}
 
+  void Layout::EventMaskRebuild() {
+    // Other verbs may share a bit with the one we just removed, so start over from the table
+    m_eventMask.Clear();
+    for (EventLookup::const_iterator itr = m_events.begin(); itr != m_events.end(); ++itr) {
+      m_eventMask.Set(itr->verb->IndexGet());
+    }
+    ++m_env->m_eventMaskGeneration;
+  }
+
+  const Layout::EventMask &Layout::EventMaskChainGet() const {
+    if (m_eventMaskChainGeneration != m_env->m_eventMaskGeneration) {
+      m_eventMaskChain = m_eventMask;
+      if (m_parent) {
+        m_eventMaskChain.Merge(m_parent->EventMaskChainGet());
+      }
+      m_eventMaskChainGeneration = m_env->m_eventMaskGeneration;
+    }
+
+    return m_eventMaskChain;
+  }
+
+  Layout::EventMultiset *Layout::EventLookup::Find(const VerbGeneric *verb) const {
+    // Binary search; tables are small, but a layout with a lot of hooks shouldn't be penalized
+    int lo = 0;
+    int hi = (int)m_entries.size();
+    unsigned int index = verb->IndexGet();
+    while (lo < hi) {
+      int mid = (lo + hi) / 2;
+      unsigned int current = m_entries[mid].verb->IndexGet();
+      if (current == index) {
+        return m_entries[mid].callbacks;
+      } else if (current < index) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+
+    return 0;
+  }
+
+  Layout::EventMultiset &Layout::EventLookup::Get(const VerbGeneric *verb) {
+    std::vector<Entry>::iterator itr = LowerBound(verb);
+    if (itr != m_entries.end() && itr->verb == verb) {
+      return *itr->callbacks;
+    }
+
+    void *block = m_heap ? m_heap->Allocate(sizeof(EventMultiset)) : ::operator new(sizeof(EventMultiset));
+    Entry entry = { verb, new (block) EventMultiset(Callback::Sorter(), EventMultiset::allocator_type(m_heap)) };
+    return *m_entries.insert(itr, entry)->callbacks;
+  }
+
+  void Layout::EventLookup::Erase(const VerbGeneric *verb) {
+    std::vector<Entry>::iterator itr = LowerBound(verb);
+    if (itr != m_entries.end() && itr->verb == verb) {
+      SetDestroy(itr->callbacks);
+      m_entries.erase(itr);
+    }
+  }
+
+  void Layout::EventLookup::Clear() {
+    for (std::vector<Entry>::const_iterator itr = m_entries.begin(); itr != m_entries.end(); ++itr) {
+      SetDestroy(itr->callbacks);
+    }
+    m_entries.clear();
+  }
+
+  void Layout::EventLookup::SetDestroy(EventMultiset *callbacks) {
+    callbacks->~EventMultiset();
+    if (m_heap) {
+      m_heap->Free(callbacks, sizeof(EventMultiset));
+    } else {
+      ::operator delete(callbacks);
+    }
+  }
+
+  std::vector<Layout::EventLookup::Entry>::iterator Layout::EventLookup::LowerBound(const VerbGeneric *verb) {
+    int lo = 0;
+    int hi = (int)m_entries.size();
+    unsigned int index = verb->IndexGet();
+    while (lo < hi) {
+      int mid = (lo + hi) / 2;
+      if (m_entries[mid].verb->IndexGet() < index) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+
+    return m_entries.begin() + lo;
+  }
+}
@@ -32,13 +32,17 @@ namespace Frames {
       Configuration::Get().LoggerGet()->LogError("Attempted to create Mask with null parent");
       return 0;
     }
-    return new Mask(parent, name);
+    return new (parent->EnvironmentGet()) Mask(parent, name);
   }
 
   bool Mask::MouseMaskingTest(float x, float y) const {
     return x >= LeftGet() && y >= TopGet() && x < RightGet() && y < BottomGet();
   }
 
+  Frame *Mask::CloneCreate(Layout *parent) const {
+    return Mask::Create(parent, NameGet());
+  }
+
   void Mask::RenderElementPreChild(detail::Renderer *renderer) const {
     Frame::RenderElementPreChild(renderer);
 
@@ -0,0 +1,48 @@
+/*  Copyright 2014 Mandible Games
+    
+    This file is part of Frames.
+    
+    Please see the COPYING file for detailed licensing information.
+    
+    Frames is dual-licensed software. It is available under both a
+    commercial license, and also under the terms of the GNU General
+    Public License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    Frames is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Frames.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include "frames/name_table.h"
+
+namespace Frames {
+  namespace detail {
+    const Name *NameTable::Intern(const std::string &text) {
+      Table::iterator itr = m_names.find(text);
+      if (itr == m_names.end()) {
+        Name name;
+        name.text = text;
+        name.references = 0;
+        itr = m_names.insert(name).first;
+      }
+
+      ++itr->references;
+      return &*itr;
+    }
+
+    void NameTable::Release(const Name *name) {
+      if (--name->references == 0) {
+        m_names.erase(m_names.iterator_to(*name));
+      }
+    }
+
+    const Name *NameTable::Find(const std::string &text) const {
+      Table::const_iterator itr = m_names.find(text);
+      return itr == m_names.end() ? 0 : &*itr;
+    }
+  }
+}
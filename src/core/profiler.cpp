@@ -0,0 +1,190 @@
+/*  Copyright 2014 Mandible Games
+    
+    This file is part of Frames.
+    
+    Please see the COPYING file for detailed licensing information.
+    
+    Frames is dual-licensed software. It is available under both a
+    commercial license, and also under the terms of the GNU General
+    Public License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    Frames is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Frames.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include "frames/profiler.h"
+
+#include "frames/detail_format.h"
+#include "frames/event.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <time.h>
+#endif
+
+namespace Frames {
+  void *Configuration::PerformanceTrace::Push(const char *name, Color color) {
+    Block block;
+    block.name = name;
+    block.start = detail::Clock();
+    block.end = -1;
+    m_blocks.push_back(block);
+
+    // Blocks are strictly LIFO, so the index is all we need to find it again; offset by one so the handle is never null
+    return reinterpret_cast<void *>(m_blocks.size());
+  }
+
+  void Configuration::PerformanceTrace::Pop(void *handle) {
+    m_blocks[reinterpret_cast<size_t>(handle) - 1].end = detail::Clock();
+  }
+
+  std::string Configuration::PerformanceTrace::ChromeTraceGet() const {
+    std::string result = "{\"traceEvents\":[";
+
+    bool first = true;
+    for (int i = 0; i < (int)m_blocks.size(); ++i) {
+      const Block &block = m_blocks[i];
+      if (block.end < 0) {
+        continue;
+      }
+
+      std::string name;
+      for (const char *c = block.name; *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+          name += '\\';
+        }
+        name += *c;
+      }
+
+      result += detail::Format("%s\n{\"name\":\"%s\",\"cat\":\"frames\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1}", first ? "" : ",", name, block.start * 1000000, (block.end - block.start) * 1000000);
+      first = false;
+    }
+
+    result += "\n]}\n";
+    return result;
+  }
+
+  namespace detail {
+    struct EventProfilerEntrySorter {
+      bool operator()(const EventProfiler::Entry &lhs, const EventProfiler::Entry &rhs) const {
+        return lhs.total > rhs.total;
+      }
+    };
+
+    template<typename T> void EventProfilerCollect(const T &source, std::vector<EventProfiler::Entry> *results) {
+      for (typename T::const_iterator itr = source.begin(); itr != source.end(); ++itr) {
+        results->push_back(itr->second);
+      }
+    }
+
+    double Clock() {
+      #ifdef _WIN32
+        static double s_frequency = 0;
+        if (!s_frequency) {
+          LARGE_INTEGER frequency;
+          QueryPerformanceFrequency(&frequency);
+          s_frequency = (double)frequency.QuadPart;
+        }
+
+        LARGE_INTEGER counter;
+        QueryPerformanceCounter(&counter);
+        return counter.QuadPart / s_frequency;
+      #else
+        timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        return now.tv_sec + now.tv_nsec / 1000000000.0;
+      #endif
+    }
+  }
+
+  void EventProfiler::TopGet(Category category, int count, std::vector<Entry> *results) const {
+    results->clear();
+
+    if (category == CATEGORY_VERB) {
+      detail::EventProfilerCollect(m_verbs, results);
+    } else if (category == CATEGORY_TYPE) {
+      detail::EventProfilerCollect(m_types, results);
+    } else if (category == CATEGORY_HANDLER) {
+      detail::EventProfilerCollect(m_handlers, results);
+    }
+
+    std::sort(results->begin(), results->end(), detail::EventProfilerEntrySorter());
+
+    if (count >= 0 && count < (int)results->size()) {
+      results->resize(count);
+    }
+  }
+
+  std::string EventProfiler::ReportGet(int count) const {
+    static const char *const names[CATEGORY_COUNT] = { "Verb", "Layout type", "Handler" };
+
+    std::string result;
+    std::vector<Entry> entries;
+    for (int category = 0; category < CATEGORY_COUNT; ++category) {
+      TopGet((Category)category, count, &entries);
+
+      result += detail::Format("%s:\n", names[category]);
+      for (int i = 0; i < (int)entries.size(); ++i) {
+        const Entry &entry = entries[i];
+
+        std::string label;
+        if (category == CATEGORY_VERB) {
+          label = entry.verb->NameGet();
+        } else if (category == CATEGORY_TYPE) {
+          label = entry.type;
+        } else if (!entry.handler.empty()) {
+          label = detail::Format("%p::%p", entry.handler.GetBoundObject(), entry.handler.GetFunctionAddress());
+        } else {
+          label = "(function object)";
+        }
+
+        result += detail::Format("  %-36s %8d calls %10.3fms total %8.3fms max\n", label, entry.count, entry.total * 1000, entry.max * 1000);
+      }
+    }
+
+    return result;
+  }
+
+  void EventProfiler::Reset() {
+    m_verbs.clear();
+    m_types.clear();
+    m_handlers.clear();
+  }
+
+  void EventProfiler::Record(const VerbGeneric *verb, const char *type, const detail::FunctorBase &handler, double seconds) {
+    Entry &verbEntry = m_verbs[verb];
+    verbEntry.verb = verb;
+    RecordEntry(&verbEntry, seconds);
+
+    Entry &typeEntry = m_types[type];
+    typeEntry.type = type;
+    RecordEntry(&typeEntry, seconds);
+
+    HandlerKey key(handler.TypeGet(), DelegateMemento());
+    handler.MementoGet(&key.second);
+
+    Entry &handlerEntry = m_handlers[key];
+    handlerEntry.handler = key.second;
+    RecordEntry(&handlerEntry, seconds);
+  }
+
+  /*static*/ void EventProfiler::RecordEntry(Entry *entry, double seconds) {
+    ++entry->count;
+    entry->total += seconds;
+    entry->max = std::max(entry->max, seconds);
+
+    int bucket = 0;
+    for (double limit = 0.000001; bucket < HISTOGRAM_BUCKETS - 1 && seconds >= limit; limit *= 2) {
+      ++bucket;
+    }
+    ++entry->histogram[bucket];
+  }
+}
@@ -34,7 +34,7 @@ namespace Frames {
       Configuration::Get().LoggerGet()->LogError("Attempted to create Raw with null parent");
       return 0;
     }
-    return new Raw(parent, name);
+    return new (parent->EnvironmentGet()) Raw(parent, name);
   }
 
   void Raw::RenderElement(detail::Renderer *renderer) const {
@@ -45,6 +45,10 @@ namespace Frames {
     const_cast<Raw*>(this)->EventTrigger(Event::Render);
   }
 
+  Frame *Raw::CloneCreate(Layout *parent) const {
+    return Raw::Create(parent, NameGet());
+  }
+
   Raw::Raw(Layout *parent, const std::string &name) :
       Frame(parent, name)
   {  };
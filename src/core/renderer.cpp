@@ -69,7 +69,8 @@ namespace Frames {
     Renderer::Renderer(Environment *env) :
         m_env(env),
         m_width(1920),
-        m_height(1080)
+        m_height(1080),
+        m_transformStagingQuads(0)
     {
       // prime our alpha stack
       m_alpha.push_back(1);
@@ -91,6 +92,44 @@ namespace Frames {
           m_scissor.pop();
         }
       }
+
+      if (!m_transform.empty()) {
+        EnvironmentGet()->LogError("Mismatched transform push/pop at end of frame.");
+        m_transform.clear();
+      }
+    }
+
+    Renderer::Vertex *Renderer::Request(int quads) {
+      if (m_transform.empty()) {
+        return BufferRequest(quads);
+      }
+
+      m_transformStaging.resize(quads * 4);
+      m_transformStagingQuads = quads;
+      return quads ? &m_transformStaging[0] : 0;
+    }
+
+    void Renderer::Return(int quads /*= -1*/) {
+      if (!m_transformStagingQuads) {
+        BufferReturn(quads);
+        return;
+      }
+
+      if (quads == -1) quads = m_transformStagingQuads;
+      m_transformStagingQuads = 0;
+
+      Vertex *vertices = BufferRequest(quads);
+      if (!vertices) {
+        return;
+      }
+
+      const Transform &transform = m_transform.back();
+      for (int i = 0; i < quads * 4; ++i) {
+        vertices[i] = m_transformStaging[i];
+        vertices[i].p = vertices[i].p * transform.scale + transform.offset;
+      }
+
+      BufferReturn(quads);
     }
 
     TextureBackingPtr Renderer::TextureCreate(const Texture::ContextualPtr &contextual) {
@@ -99,6 +138,10 @@ namespace Frames {
     }
 
     void Renderer::ScissorPush(Rect rect) {
+      // Scales are never negative, so the rect stays axis-aligned
+      rect.s = TransformApply(rect.s);
+      rect.e = TransformApply(rect.e);
+
       if (!m_scissor.empty()) {
         // Create the intersection of scissors
         rect.s.x = max(rect.s.x, m_scissor.top().s.x);
@@ -143,6 +186,34 @@ namespace Frames {
       m_alpha.pop_back();
     }
 
+    void Renderer::TransformPush(float scale, const Vector &offset) {
+      Transform transform;
+      transform.scale = scale;
+      transform.offset = offset;
+      if (!m_transform.empty()) {
+        transform.scale *= m_transform.back().scale;
+        transform.offset = TransformApply(offset);
+      }
+      m_transform.push_back(transform);
+    }
+
+    void Renderer::TransformPop() {
+      if (m_transform.empty()) {
+        EnvironmentGet()->LogError("Excessive transform popping");
+        return;
+      }
+
+      m_transform.pop_back();
+    }
+
+    Vector Renderer::TransformApply(const Vector &point) const {
+      if (m_transform.empty()) {
+        return point;
+      }
+
+      return point * m_transform.back().scale + m_transform.back().offset;
+    }
+
     bool Renderer::WriteCroppedRect(Vertex *verts, const Rect &screen, const Color &color, const Rect &bounds) {
       if (screen.s.x > bounds.e.x || screen.e.x < bounds.s.x || screen.s.y > bounds.e.y || screen.e.y < bounds.s.y) {
         return false;
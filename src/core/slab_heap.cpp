@@ -0,0 +1,101 @@
+/*  Copyright 2014 Mandible Games
+    
+    This file is part of Frames.
+    
+    Please see the COPYING file for detailed licensing information.
+    
+    Frames is dual-licensed software. It is available under both a
+    commercial license, and also under the terms of the GNU General
+    Public License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    Frames is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Frames.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include "frames/slab_heap.h"
+
+namespace Frames {
+  namespace detail {
+    SlabHeap::SlabHeap() :
+        m_live(0),
+        m_liveBytes(0),
+        m_oversizeBytes(0),
+        m_allocations(0)
+    {
+      for (int i = 0; i < CLASS_COUNT; ++i) {
+        m_free[i] = 0;
+        m_cursor[i] = 0;
+        m_cursorEnd[i] = 0;
+      }
+    }
+
+    SlabHeap::~SlabHeap() {
+      for (int i = 0; i < (int)m_slabs.size(); ++i) {
+        ::operator delete(m_slabs[i]);
+      }
+    }
+
+    void *SlabHeap::Allocate(std::size_t bytes) {
+      ++m_allocations;
+      ++m_live;
+
+      int sizeClass = ClassGet(bytes ? bytes : 1);
+#ifndef FRAMES_SLAB_HEAP_DISABLED
+      if (sizeClass < CLASS_COUNT) {
+        std::size_t classBytes = (sizeClass + 1) * GRANULARITY;
+        m_liveBytes += classBytes;
+
+        if (m_free[sizeClass]) {
+          FreeBlock *block = m_free[sizeClass];
+          m_free[sizeClass] = block->next;
+          return block;
+        }
+
+        if (m_cursorEnd[sizeClass] - m_cursor[sizeClass] < (std::ptrdiff_t)classBytes) {
+          char *slab = static_cast<char *>(::operator new(SLAB_BYTES));
+          m_slabs.push_back(slab);
+          m_cursor[sizeClass] = slab;
+          m_cursorEnd[sizeClass] = slab + SLAB_BYTES - SLAB_BYTES % classBytes;
+        }
+
+        void *block = m_cursor[sizeClass];
+        m_cursor[sizeClass] += classBytes;
+        return block;
+      }
+#endif
+
+      m_liveBytes += bytes;
+      m_oversizeBytes += bytes;
+      return ::operator new(bytes);
+    }
+
+    void SlabHeap::Free(void *block, std::size_t bytes) {
+      if (!block) {
+        return;
+      }
+
+      --m_live;
+
+      int sizeClass = ClassGet(bytes ? bytes : 1);
+#ifndef FRAMES_SLAB_HEAP_DISABLED
+      if (sizeClass < CLASS_COUNT) {
+        m_liveBytes -= (sizeClass + 1) * GRANULARITY;
+
+        FreeBlock *freed = static_cast<FreeBlock *>(block);
+        freed->next = m_free[sizeClass];
+        m_free[sizeClass] = freed;
+        return;
+      }
+#endif
+
+      m_liveBytes -= bytes;
+      m_oversizeBytes -= bytes;
+      ::operator delete(block);
+    }
+  }
+}
@@ -0,0 +1,164 @@
+/*  Copyright 2014 Mandible Games
+    
+    This file is part of Frames.
+    
+    Please see the COPYING file for detailed licensing information.
+    
+    Frames is dual-licensed software. It is available under both a
+    commercial license, and also under the terms of the GNU General
+    Public License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    Frames is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Frames.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include "frames/snapshot.h"
+
+#include "frames/environment.h"
+
+#include <algorithm>
+
+namespace Frames {
+  Snapshot::Snapshot() : m_width(0), m_height(0) { }
+  Snapshot::~Snapshot() { }
+
+  void Snapshot::Clear() {
+    // Keep the capacity; the next frame will almost always need about the same
+    m_commands.clear();
+    m_vertices.clear();
+    m_textures.clear();
+  }
+
+  void Snapshot::Render(detail::Renderer *renderer) const {
+    renderer->Begin(m_width, m_height);
+
+    for (std::vector<Command>::const_iterator itr = m_commands.begin(); itr != m_commands.end(); ++itr) {
+      switch (itr->type) {
+        case Command::DRAW: {
+          detail::Renderer::Vertex *vertices = renderer->Request(itr->quads);
+          if (vertices) {
+            std::copy(m_vertices.begin() + itr->index, m_vertices.begin() + itr->index + itr->quads * 4, vertices);
+            renderer->Return(itr->quads);
+          }
+          break;
+        }
+        case Command::TEXTURE:
+          renderer->TextureSet(m_textures[itr->index]);
+          break;
+        case Command::SCISSOR:
+          // Already clipped against everything it was nested in when it was recorded
+          renderer->ScissorSet(itr->scissor);
+          break;
+      }
+    }
+
+    renderer->End();
+  }
+
+  namespace detail {
+    SnapshotRecorder::SnapshotRecorder(Environment *env) :
+      Renderer(env),
+      m_target(0),
+      m_textureRecorded(false),
+      m_requestQuads(0)
+    { }
+
+    SnapshotRecorder::~SnapshotRecorder() { }
+
+    void SnapshotRecorder::Begin(int width, int height) {
+      m_target->Clear();
+      m_target->m_width = width;
+      m_target->m_height = height;
+
+      m_texture = TextureBackingPtr();
+      m_textureRecorded = false;
+
+      Renderer::Begin(width, height);
+    }
+
+    void SnapshotRecorder::End() {
+      Renderer::End();
+
+      // Don't hold textures past the frame; the snapshot has its own references
+      m_texture = TextureBackingPtr();
+    }
+
+    TextureBackingPtr SnapshotRecorder::TextureCreate(int width, int height, Texture::Format mode) {
+      return Renderer::GetFrom(EnvironmentGet())->TextureCreate(width, height, mode);
+    }
+
+    TextureBackingPtr SnapshotRecorder::TextureCreate(const Texture::ContextualPtr &contextual) {
+      return Renderer::GetFrom(EnvironmentGet())->TextureCreate(contextual);
+    }
+
+    void SnapshotRecorder::TextureSet(const TextureBackingPtr &tex) {
+      if (m_textureRecorded && m_texture.Get() == tex.Get()) {
+        return;
+      }
+
+      m_texture = tex;
+      m_textureRecorded = false;
+    }
+
+    void SnapshotRecorder::ScissorSet(const Rect &rect) {
+      Snapshot::Command command;
+      command.type = Snapshot::Command::SCISSOR;
+      command.index = 0;
+      command.quads = 0;
+      command.scissor = rect;
+
+      // A scissor nothing was drawn under is dead
+      if (!m_target->m_commands.empty() && m_target->m_commands.back().type == Snapshot::Command::SCISSOR) {
+        m_target->m_commands.back() = command;
+      } else {
+        m_target->m_commands.push_back(command);
+      }
+    }
+
+    Renderer::Vertex *SnapshotRecorder::BufferRequest(int quads) {
+      m_requestQuads = quads;
+      if (!quads) {
+        return 0;
+      }
+
+      m_target->m_vertices.resize(m_target->m_vertices.size() + quads * 4);
+      return &m_target->m_vertices[m_target->m_vertices.size() - quads * 4];
+    }
+
+    void SnapshotRecorder::BufferReturn(int quads) {
+      if (quads == -1 || quads > m_requestQuads) {
+        quads = m_requestQuads;
+      }
+
+      // Drop anything requested but not used
+      int first = (int)m_target->m_vertices.size() - m_requestQuads * 4;
+      m_target->m_vertices.resize(first + quads * 4);
+      m_requestQuads = 0;
+
+      if (!quads) {
+        return;
+      }
+
+      if (!m_textureRecorded) {
+        Snapshot::Command command;
+        command.type = Snapshot::Command::TEXTURE;
+        command.index = (int)m_target->m_textures.size();
+        command.quads = 0;
+        m_target->m_commands.push_back(command);
+        m_target->m_textures.push_back(m_texture);
+        m_textureRecorded = true;
+      }
+
+      Snapshot::Command command;
+      command.type = Snapshot::Command::DRAW;
+      command.index = first;
+      command.quads = quads;
+      m_target->m_commands.push_back(command);
+    }
+  }
+}
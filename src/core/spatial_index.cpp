@@ -0,0 +1,137 @@
+/*  Copyright 2014 Mandible Games
+    
+    This file is part of Frames.
+    
+    Please see the COPYING file for detailed licensing information.
+    
+    Frames is dual-licensed software. It is available under both a
+    commercial license, and also under the terms of the GNU General
+    Public License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    Frames is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Frames.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include "frames/spatial_index.h"
+
+#include <algorithm>
+
+#include <math.h>
+
+namespace Frames {
+  namespace detail {
+    static const float SpatialCellSize = 128.f;
+    static const int SpatialCellLimit = 256; // past this many cells, a layout goes in the always-checked oversize list
+
+    void SpatialIndex::Insert(Layout *layout, const Rect &bounds) {
+      // Anything that can't contain a point doesn't need to be indexed; this also catches NaN from broken layouts
+      if (!(bounds.s.x < bounds.e.x && bounds.s.y < bounds.e.y)) {
+        Remove(layout);
+        return;
+      }
+
+      Entry entry;
+      entry.bounds = bounds;
+      entry.start = Cell(CellCoordinate(bounds.s.x), CellCoordinate(bounds.s.y));
+      entry.end = Cell(CellCoordinate(bounds.e.x), CellCoordinate(bounds.e.y));
+      entry.oversize = (float)(entry.end.first - entry.start.first + 1) * (float)(entry.end.second - entry.start.second + 1) > SpatialCellLimit;
+
+      std::map<Layout *, Entry>::iterator itr = m_entries.find(layout);
+      if (itr != m_entries.end()) {
+        Entry &old = itr->second;
+        if (old.start == entry.start && old.end == entry.end && old.oversize == entry.oversize) {
+          // Same cells, we only need the new bounds
+          old.bounds = entry.bounds;
+          return;
+        }
+
+        Unlink(layout, old);
+        old = entry;
+      } else {
+        m_entries[layout] = entry;
+      }
+
+      Link(layout, entry);
+    }
+
+    void SpatialIndex::Remove(Layout *layout) {
+      std::map<Layout *, Entry>::iterator itr = m_entries.find(layout);
+      if (itr == m_entries.end()) {
+        return;
+      }
+
+      Unlink(layout, itr->second);
+      m_entries.erase(itr);
+    }
+
+    void SpatialIndex::Probe(float x, float y, std::vector<Layout *> *results) const {
+      for (std::vector<Layout *>::const_iterator itr = m_oversize.begin(); itr != m_oversize.end(); ++itr) {
+        const Rect &bounds = m_entries.find(*itr)->second.bounds;
+        if (x >= bounds.s.x && y >= bounds.s.y && x < bounds.e.x && y < bounds.e.y) {
+          results->push_back(*itr);
+        }
+      }
+
+      std::map<Cell, std::vector<Layout *> >::const_iterator cell = m_cells.find(Cell(CellCoordinate(x), CellCoordinate(y)));
+      if (cell == m_cells.end()) {
+        return;
+      }
+
+      for (std::vector<Layout *>::const_iterator itr = cell->second.begin(); itr != cell->second.end(); ++itr) {
+        const Rect &bounds = m_entries.find(*itr)->second.bounds;
+        if (x >= bounds.s.x && y >= bounds.s.y && x < bounds.e.x && y < bounds.e.y) {
+          results->push_back(*itr);
+        }
+      }
+    }
+
+    void SpatialIndex::Link(Layout *layout, const Entry &entry) {
+      if (entry.oversize) {
+        m_oversize.push_back(layout);
+        return;
+      }
+
+      for (int cx = entry.start.first; cx <= entry.end.first; ++cx) {
+        for (int cy = entry.start.second; cy <= entry.end.second; ++cy) {
+          m_cells[Cell(cx, cy)].push_back(layout);
+        }
+      }
+    }
+
+    void SpatialIndex::Unlink(Layout *layout, const Entry &entry) {
+      if (entry.oversize) {
+        m_oversize.erase(std::find(m_oversize.begin(), m_oversize.end(), layout));
+        return;
+      }
+
+      for (int cx = entry.start.first; cx <= entry.end.first; ++cx) {
+        for (int cy = entry.start.second; cy <= entry.end.second; ++cy) {
+          std::map<Cell, std::vector<Layout *> >::iterator cell = m_cells.find(Cell(cx, cy));
+          std::vector<Layout *> &contents = cell->second;
+
+          // Order within a cell doesn't matter, so swap-and-pop
+          std::vector<Layout *>::iterator itr = std::find(contents.begin(), contents.end(), layout);
+          *itr = contents.back();
+          contents.pop_back();
+
+          if (contents.empty()) {
+            m_cells.erase(cell);
+          }
+        }
+      }
+    }
+
+    /*static*/ int SpatialIndex::CellCoordinate(float coordinate) {
+      // Clamp so that enormous layouts can't overflow the cell math; they end up oversize anyway
+      float cell = floorf(coordinate / SpatialCellSize);
+      if (cell < -1000000.f) return -1000000;
+      if (cell > 1000000.f) return 1000000;
+      return (int)cell;
+    }
+  }
+}
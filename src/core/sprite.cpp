@@ -31,7 +31,7 @@ namespace Frames {
       Configuration::Get().LoggerGet()->LogError("Attempted to create Sprite with null parent");
       return 0;
     }
-    return new Sprite(parent, name);
+    return new (parent->EnvironmentGet()) Sprite(parent, name);
   }
 
   void Sprite::TextureSet(const std::string &id) {
@@ -93,6 +93,21 @@ namespace Frames {
     }
   }
 
+  Frame *Sprite::CloneCreate(Layout *parent) const {
+    return Sprite::Create(parent, NameGet());
+  }
+
+  void Sprite::CloneCopy(Layout *clone, const CloneMap &clones) const {
+    Frame::CloneCopy(clone, clones);
+
+    // Share the texture chunk rather than looking it up again; default sizes have already come across with the layout
+    Sprite *sprite = static_cast<Sprite *>(clone);
+    sprite->m_texture_id = m_texture_id;
+    sprite->m_texture = m_texture;
+    sprite->m_angle = m_angle;
+    sprite->m_tint = m_tint;
+  }
+
   Sprite::Sprite(Layout *parent, const std::string &name) :
       Frame(parent, name),
       m_tint(1, 1, 1, 1),
@@ -32,7 +32,7 @@ namespace Frames {
       Configuration::Get().LoggerGet()->LogError("Attempted to create Text with null parent");
       return 0;
     }
-    return new Text(parent, name);
+    return new (parent->EnvironmentGet()) Text(parent, name);
   }
 
   void Text::TextSet(const std::string &text) {
@@ -85,25 +85,28 @@ namespace Frames {
       }
     }
 
-    // clear event handlers
-    EventDetach(Event::MouseLeftDown, Delegate<void (Handle *)>(this, &Text::EventInternal_LeftDown));
-    EventDetach(Event::MouseLeftUp, Delegate<void (Handle *)>(this, &Text::EventInternal_LeftUp));
-    EventDetach(Event::MouseLeftUpoutside, Delegate<void (Handle *)>(this, &Text::EventInternal_LeftUp));
+    // clear event handlers, including any drag in progress, since the handler that would end it is going away
+    EventInternalDetach(&m_tokenLeftDown);
+    EventInternalDetach(&m_tokenLeftUp);
+    EventInternalDetach(&m_tokenLeftUpoutside);
 
-    EventDetach(Event::KeyDown, Delegate<void (Handle *, Input::Key)>(this, &Text::EventInternal_KeyDownOrRepeat));
-    EventDetach(Event::KeyRepeat, Delegate<void (Handle *, Input::Key)>(this, &Text::EventInternal_KeyDownOrRepeat));
-    EventDetach(Event::KeyText, Delegate<void (Handle *, const std::string &)>(this, &Text::EventInternal_KeyText));
+    EventInternalDetach(&m_tokenKeyDown);
+    EventInternalDetach(&m_tokenKeyRepeat);
+    EventInternalDetach(&m_tokenKeyText);
+
+    EventInternalDetach(&m_tokenMove);
+    EventInternalDetach(&m_tokenMoveoutside);
 
     // if necessary, insert event handlers
     if (interactive == INTERACTIVE_SELECT || interactive == INTERACTIVE_CURSOR || interactive == INTERACTIVE_EDIT) {
-      EventAttach(Event::MouseLeftDown, Delegate<void (Handle *)>(this, &Text::EventInternal_LeftDown));
-      EventAttach(Event::MouseLeftUp, Delegate<void (Handle *)>(this, &Text::EventInternal_LeftUp));
-      EventAttach(Event::MouseLeftUpoutside, Delegate<void (Handle *)>(this, &Text::EventInternal_LeftUp));
+      m_tokenLeftDown = EventAttach(Event::MouseLeftDown, Delegate<void (Handle *)>(this, &Text::EventInternal_LeftDown));
+      m_tokenLeftUp = EventAttach(Event::MouseLeftUp, Delegate<void (Handle *)>(this, &Text::EventInternal_LeftUp));
+      m_tokenLeftUpoutside = EventAttach(Event::MouseLeftUpoutside, Delegate<void (Handle *)>(this, &Text::EventInternal_LeftUp));
     
       // These are needed mostly for ctrl-C
-      EventAttach(Event::KeyDown, Delegate<void (Handle *, Input::Key)>(this, &Text::EventInternal_KeyDownOrRepeat));
-      EventAttach(Event::KeyRepeat, Delegate<void (Handle *, Input::Key)>(this, &Text::EventInternal_KeyDownOrRepeat));
-      EventAttach(Event::KeyText, Delegate<void (Handle *, const std::string &)>(this, &Text::EventInternal_KeyText));
+      m_tokenKeyDown = EventAttach(Event::KeyDown, Delegate<void (Handle *, Input::Key)>(this, &Text::EventInternal_KeyDownOrRepeat));
+      m_tokenKeyRepeat = EventAttach(Event::KeyRepeat, Delegate<void (Handle *, Input::Key)>(this, &Text::EventInternal_KeyDownOrRepeat));
+      m_tokenKeyText = EventAttach(Event::KeyText, Delegate<void (Handle *, const std::string &)>(this, &Text::EventInternal_KeyText));
     }
   }
 
@@ -166,6 +169,29 @@ namespace Frames {
     m_color_selected = color;
   }
 
+  Frame *Text::CloneCreate(Layout *parent) const {
+    return Text::Create(parent, NameGet());
+  }
+
+  void Text::CloneCopy(Layout *clone, const CloneMap &clones) const {
+    Frame::CloneCopy(clone, clones);
+
+    // Cursor and selection are editing state, not appearance, so they start fresh
+    Text *text = static_cast<Text *>(clone);
+    text->m_font = m_font;
+    text->m_size = m_size;
+    text->m_text = m_text;
+    text->m_wordwrap = m_wordwrap;
+    text->m_color_text = m_color_text;
+    text->m_color_selection = m_color_selection;
+    text->m_color_selected = m_color_selected;
+    text->m_scroll = m_scroll;
+    text->InteractiveSet(m_interactive);
+
+    // Everything that affects the layout changed at once, so rebuild it once
+    text->UpdateLayout();
+  }
+
   Text::Text(Layout *parent, const std::string &name) :
       Frame(parent, name),
       m_size(16),
@@ -320,8 +346,11 @@ namespace Frames {
     CursorSet(pos);
     SelectionClear();
 
-    EventAttach(Event::MouseMove, Delegate<void (Handle *, const Vector &pt)>(this, &Text::EventInternal_Move));
-    EventAttach(Event::MouseMoveoutside, Delegate<void (Handle *, const Vector &pt)>(this, &Text::EventInternal_Move));
+    // A second press without a release in between is already being tracked
+    if (!m_tokenMove.ValidGet()) {
+      m_tokenMove = EventAttach(Event::MouseMove, Delegate<void (Handle *, const Vector &pt)>(this, &Text::EventInternal_Move));
+      m_tokenMoveoutside = EventAttach(Event::MouseMoveoutside, Delegate<void (Handle *, const Vector &pt)>(this, &Text::EventInternal_Move));
+    }
 
     if (m_interactive >= INTERACTIVE_SELECT) {
       EnvironmentGet()->FocusSet(this);
@@ -341,8 +370,13 @@ namespace Frames {
     }
     CursorSet(pos);
 
-    EventDetach(Event::MouseMove, Delegate<void (Handle *, const Vector &pt)>(this, &Text::EventInternal_Move));
-    EventDetach(Event::MouseMoveoutside, Delegate<void (Handle *, const Vector &pt)>(this, &Text::EventInternal_Move));
+    EventInternalDetach(&m_tokenMove);
+    EventInternalDetach(&m_tokenMoveoutside);
+  }
+
+  void Text::EventInternalDetach(EventToken *token) {
+    EventDetach(*token);
+    *token = EventToken();
   }
 
   void Text::EventInternal_Move(Handle *e, const Vector &pt) {
@@ -0,0 +1,349 @@
+/*  Copyright 2014 Mandible Games
+    
+    This file is part of Frames.
+    
+    Please see the COPYING file for detailed licensing information.
+    
+    Frames is dual-licensed software. It is available under both a
+    commercial license, and also under the terms of the GNU General
+    Public License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    Frames is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Frames.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include "frames/virtual_list.h"
+
+#include "frames/cast.h"
+#include "frames/configuration.h"
+#include "frames/detail_format.h"
+#include "frames/environment.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Frames {
+  FRAMES_DEFINE_RTTI(VirtualList, Mask);
+
+  VirtualList *VirtualList::Create(Layout *parent, const std::string &name = "") {
+    if (!parent) {
+      Configuration::Get().LoggerGet()->LogError("Attempted to create VirtualList with null parent");
+      return 0;
+    }
+    return new (parent->EnvironmentGet()) VirtualList(parent, name);
+  }
+
+  void VirtualList::RowBindSet(const RowBindFunctor &bind) {
+    m_rowBind = bind;
+    Refresh(true);
+  }
+
+  void VirtualList::RowCountSet(int count) {
+    if (count < 0) {
+      EnvironmentGet()->LogError(detail::Format("Attempted to set VirtualList row count to %d", count));
+      count = 0;
+    }
+
+    if (count == m_rowCount) {
+      return;
+    }
+
+    m_rowCount = count;
+    HeightsRebuild();
+    Refresh(false);
+  }
+
+  void VirtualList::RowHeightSet(float height) {
+    if (!(height > 0)) {
+      EnvironmentGet()->LogError(detail::Format("Attempted to set VirtualList row height to %f", height));
+      return;
+    }
+
+    m_rowHeight = height;
+    m_rowHeightCallback = RowHeightFunctor();
+    HeightsRebuild();
+    Refresh(false);
+  }
+
+  void VirtualList::RowHeightSet(const RowHeightFunctor &height) {
+    m_rowHeightCallback = height;
+    HeightsRebuild();
+    Refresh(false);
+  }
+
+  void VirtualList::RowInvalidate(int index) {
+    if (index < 0 || index >= m_rowCount) {
+      EnvironmentGet()->LogError(detail::Format("Attempted to invalidate VirtualList row %d out of %d", index, m_rowCount));
+      return;
+    }
+
+    if (!m_rowHeightCallback.Empty()) {
+      float height = std::max(m_rowHeightCallback(index), 0.f);
+      double delta = height - m_heights[index];
+      m_heights[index] = height;
+      for (int i = index + 1; i <= (int)m_heights.size(); i += i & -i) {
+        m_heightTree[i] += delta;
+      }
+    }
+
+    std::map<int, Frame *>::iterator itr = m_rows.find(index);
+    if (itr != m_rows.end() && !m_rowBind.Empty()) {
+      m_rowBind(itr->second, index);
+    }
+
+    Refresh(false);
+  }
+
+  void VirtualList::RowInvalidateAll() {
+    HeightsRebuild();
+    Refresh(true);
+  }
+
+  void VirtualList::ScrollSet(float scroll) {
+    m_scroll = scroll;
+    Refresh(false);
+  }
+
+  void VirtualList::ScrollToIndex(int index, float align /*= 0.f*/) {
+    if (index < 0 || index >= m_rowCount) {
+      EnvironmentGet()->LogError(detail::Format("Attempted to scroll VirtualList to row %d out of %d", index, m_rowCount));
+      return;
+    }
+
+    float top = RowTopGet(index);
+    float slack = HeightGet() - RowHeightGet(index);
+    ScrollSet(top - slack * align);
+  }
+
+  float VirtualList::ContentHeightGet() const {
+    if (m_rowHeightCallback.Empty()) {
+      return m_rowHeight * m_rowCount;
+    }
+
+    return RowTopGet(m_rowCount);
+  }
+
+  float VirtualList::RowTopGet(int index) const {
+    index = detail::Clamp(index, 0, m_rowCount);
+
+    if (m_rowHeightCallback.Empty()) {
+      return m_rowHeight * index;
+    }
+
+    double sum = 0;
+    for (int i = index; i > 0; i -= i & -i) {
+      sum += m_heightTree[i];
+    }
+    return (float)sum;
+  }
+
+  int VirtualList::RowIndexGet(float position) const {
+    if (!m_rowCount) {
+      return -1;
+    }
+
+    if (m_rowHeightCallback.Empty()) {
+      return detail::Clamp((int)std::floor(position / m_rowHeight), 0, m_rowCount - 1);
+    }
+
+    // Standard Fenwick descent: find the largest prefix whose total is <= position
+    int index = 0;
+    double remaining = position;
+    int step = 1;
+    while (step * 2 <= m_rowCount) {
+      step *= 2;
+    }
+    for (; step; step /= 2) {
+      if (index + step <= m_rowCount && m_heightTree[index + step] <= remaining) {
+        index += step;
+        remaining -= m_heightTree[index];
+      }
+    }
+
+    return detail::Clamp(index, 0, m_rowCount - 1);
+  }
+
+  Frame *VirtualList::RowFrameGet(int index) const {
+    std::map<int, Frame *>::const_iterator itr = m_rows.find(index);
+    if (itr == m_rows.end()) {
+      return 0;
+    }
+    return itr->second;
+  }
+
+  void VirtualList::SizeChanged(Handle *handle) {
+    Refresh(false);
+  }
+
+  void VirtualList::Destroyed(Handle *handle) {
+    // Our rows go down with us; no need to hear about each one
+    for (std::map<Layout *, EventToken>::iterator itr = m_rowTokens.begin(); itr != m_rowTokens.end(); ++itr) {
+      itr->first->EventDetach(itr->second);
+    }
+    m_rowTokens.clear();
+    m_rows.clear();
+    m_pool.clear();
+  }
+
+  void VirtualList::RowDestroyed(Handle *handle) {
+    Layout *row = handle->TargetGet();
+    if (!m_rowTokens.erase(row)) {
+      return;
+    }
+
+    for (std::map<int, Frame *>::iterator itr = m_rows.begin(); itr != m_rows.end(); ++itr) {
+      if (itr->second == row) {
+        m_rows.erase(itr);
+        return;
+      }
+    }
+
+    m_pool.erase(std::remove(m_pool.begin(), m_pool.end(), row), m_pool.end());
+  }
+
+  void VirtualList::Refresh(bool rebind) {
+    // Everything here is pin and size changes on rows we own, so batch them up
+    Environment::LayoutBatch batch(EnvironmentGet());
+
+    float height = HeightGet();
+    m_scroll = std::max(std::min(m_scroll, ContentHeightGet() - height), 0.f);
+
+    int first = 0;
+    int last = -1;
+    if (m_rowCount) {
+      first = RowIndexGet(m_scroll);
+      last = first;
+      if (height > 0) {
+        last = RowIndexGet(m_scroll + height);
+        if (last > first && RowTopGet(last) >= m_scroll + height) {
+          --last;  // ends exactly on a row boundary; the next row isn't actually visible
+        }
+      } else {
+        last = first - 1;
+      }
+    }
+
+    // Recycle everything that's gone out of view
+    for (std::map<int, Frame *>::iterator itr = m_rows.begin(); itr != m_rows.end(); ) {
+      if (itr->first < first || itr->first > last) {
+        itr->second->VisibleSet(false);
+        m_pool.push_back(itr->second);
+        m_rows.erase(itr++);
+      } else {
+        ++itr;
+      }
+    }
+
+    for (int index = first; index <= last; ++index) {
+      std::map<int, Frame *>::iterator itr = m_rows.find(index);
+      Frame *row;
+      bool bind = rebind;
+      if (itr != m_rows.end()) {
+        row = itr->second;
+      } else {
+        if (!m_pool.empty()) {
+          row = m_pool.back();
+          m_pool.pop_back();
+          row->VisibleSet(true);
+        } else {
+          row = m_rowCreate.Empty() ? Frame::Create(this, "") : m_rowCreate(this);
+          if (!row) {
+            EnvironmentGet()->LogError("VirtualList row creation callback returned null");
+            return;
+          }
+          if (row->ParentGet() != this) {
+            EnvironmentGet()->LogError("VirtualList row creation callback returned a frame that isn't a child of the list");
+          }
+
+          row->PinSet(X, 0.f, this, 0.f);
+          row->PinSet(X, 1.f, this, 1.f);
+          m_rowTokens[row] = row->EventAttach(Event::Destroy, Delegate<void (Handle *)>(this, &VirtualList::RowDestroyed));
+        }
+        m_rows[index] = row;
+        bind = true;
+      }
+
+      row->PinSet(Y, 0.f, this, 0.f, RowTopGet(index) - m_scroll);
+      row->HeightSet(RowHeightGet(index));
+
+      if (bind && !m_rowBind.Empty()) {
+        m_rowBind(row, index);
+      }
+    }
+  }
+
+  float VirtualList::RowHeightGet(int index) const {
+    if (m_rowHeightCallback.Empty()) {
+      return m_rowHeight;
+    }
+
+    return m_heights[index];
+  }
+
+  void VirtualList::HeightsRebuild() {
+    if (m_rowHeightCallback.Empty()) {
+      m_heights.clear();
+      m_heightTree.clear();
+      return;
+    }
+
+    m_heights.resize(m_rowCount);
+    m_heightTree.assign(m_rowCount + 1, 0);
+    for (int i = 0; i < m_rowCount; ++i) {
+      m_heights[i] = std::max(m_rowHeightCallback(i), 0.f);
+      m_heightTree[i + 1] += m_heights[i];
+
+      // Linear-time Fenwick construction: push each node's total up to its parent
+      int parent = (i + 1) + ((i + 1) & -(i + 1));
+      if (parent <= m_rowCount) {
+        m_heightTree[parent] += m_heightTree[i + 1];
+      }
+    }
+  }
+
+  Frame *VirtualList::CloneCreate(Layout *parent) const {
+    return VirtualList::Create(parent, NameGet());
+  }
+
+  void VirtualList::CloneCopy(Layout *clone, const CloneMap &clones) const {
+    Mask::CloneCopy(clone, clones);
+
+    VirtualList *list = static_cast<VirtualList *>(clone);
+    list->m_rowCreate = m_rowCreate;
+    list->m_rowBind = m_rowBind;
+    list->m_rowCount = m_rowCount;
+    list->m_scroll = m_scroll;
+    list->m_rowHeight = m_rowHeight;
+    list->m_rowHeightCallback = m_rowHeightCallback;
+    list->m_heights = m_heights;
+    list->m_heightTree = m_heightTree;
+
+    list->Refresh(true);
+  }
+
+  bool VirtualList::CloneChildTest(const Layout *child) const {
+    for (std::map<int, Frame *>::const_iterator itr = m_rows.begin(); itr != m_rows.end(); ++itr) {
+      if (itr->second == child) {
+        return false;
+      }
+    }
+
+    return std::find(m_pool.begin(), m_pool.end(), child) == m_pool.end();
+  }
+
+  VirtualList::VirtualList(Layout *parent, const std::string &name) :
+      Mask(parent, name),
+      m_rowCount(0),
+      m_scroll(0),
+      m_rowHeight(detail::SizeDefault)
+  {
+    EventAttach(Event::Size, Delegate<void (Handle *handle)>(this, &VirtualList::SizeChanged));
+    EventAttach(Event::Destroy, Delegate<void (Handle *handle)>(this, &VirtualList::Destroyed));
+  };
+  VirtualList::~VirtualList() { };
+}
@@ -0,0 +1,192 @@
+/*  Copyright 2014 Mandible Games
+    
+    This file is part of Frames.
+    
+    Please see the COPYING file for detailed licensing information.
+    
+    Frames is dual-licensed software. It is available under both a
+    commercial license, and also under the terms of the GNU General
+    Public License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    Frames is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Frames.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include "frames/worker_pool.h"
+
+#ifdef _WIN32
+  #include <windows.h>
+  #include <process.h>
+#else
+  #include <pthread.h>
+#endif
+
+#include <vector>
+
+namespace Frames {
+  namespace detail {
+    // Deep pin chains resolve recursively, so workers get the same room a main thread usually has
+    const unsigned int c_workerStackSize = 8 * 1024 * 1024;
+
+    struct WorkerPool::Shared {
+      #ifdef _WIN32
+        CRITICAL_SECTION lock;
+        CONDITION_VARIABLE wake;
+        CONDITION_VARIABLE done;
+        std::vector<HANDLE> threads;
+
+        void Lock() { EnterCriticalSection(&lock); }
+        void Unlock() { LeaveCriticalSection(&lock); }
+        void Wait(CONDITION_VARIABLE *condition) { SleepConditionVariableCS(condition, &lock, INFINITE); }
+        void Broadcast(CONDITION_VARIABLE *condition) { WakeAllConditionVariable(condition); }
+      #else
+        pthread_mutex_t lock;
+        pthread_cond_t wake;
+        pthread_cond_t done;
+        std::vector<pthread_t> threads;
+
+        void Lock() { pthread_mutex_lock(&lock); }
+        void Unlock() { pthread_mutex_unlock(&lock); }
+        void Wait(pthread_cond_t *condition) { pthread_cond_wait(condition, &lock); }
+        void Broadcast(pthread_cond_t *condition) { pthread_cond_broadcast(condition); }
+      #endif
+
+      // Everything below is guarded by lock
+      Job job;
+      void *context;
+      int count;
+      int next;
+      int busy;  // workers currently inside a batch
+      unsigned int generation;  // bumped by every Run, so sleeping workers can tell a new batch from a spurious wakeup
+      bool quit;
+
+      // Runs jobs from the current batch until there are none left; called with the lock held, returns with it held
+      void Drain() {
+        while (next < count) {
+          int index = next++;
+          Unlock();
+          job(context, index);
+          Lock();
+        }
+      }
+
+      void Work() {
+        Lock();
+        unsigned int seen = generation;
+        while (true) {
+          while (!quit && generation == seen) {
+            Wait(&wake);
+          }
+          if (quit) {
+            break;
+          }
+          seen = generation;
+
+          ++busy;
+          Drain();
+          --busy;
+          if (!busy) {
+            Broadcast(&done);
+          }
+        }
+        Unlock();
+      }
+
+      #ifdef _WIN32
+        static unsigned int __stdcall Entry(void *shared) {
+          static_cast<Shared *>(shared)->Work();
+          return 0;
+        }
+      #else
+        static void *Entry(void *shared) {
+          static_cast<Shared *>(shared)->Work();
+          return 0;
+        }
+      #endif
+    };
+
+    WorkerPool::WorkerPool(int threads) : m_shared(new Shared()), m_threadCount(threads) {
+      m_shared->job = 0;
+      m_shared->context = 0;
+      m_shared->count = 0;
+      m_shared->next = 0;
+      m_shared->busy = 0;
+      m_shared->generation = 0;
+      m_shared->quit = false;
+
+      #ifdef _WIN32
+        InitializeCriticalSection(&m_shared->lock);
+        InitializeConditionVariable(&m_shared->wake);
+        InitializeConditionVariable(&m_shared->done);
+
+        for (int i = 0; i < threads; ++i) {
+          m_shared->threads.push_back((HANDLE)_beginthreadex(0, c_workerStackSize, Shared::Entry, m_shared, 0, 0));
+        }
+      #else
+        pthread_mutex_init(&m_shared->lock, 0);
+        pthread_cond_init(&m_shared->wake, 0);
+        pthread_cond_init(&m_shared->done, 0);
+
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setstacksize(&attr, c_workerStackSize);
+        for (int i = 0; i < threads; ++i) {
+          pthread_t thread;
+          if (pthread_create(&thread, &attr, Shared::Entry, m_shared) == 0) {
+            m_shared->threads.push_back(thread);
+          }
+        }
+        pthread_attr_destroy(&attr);
+      #endif
+
+      // A thread that failed to start just means less help; Run() works with none at all
+      m_threadCount = (int)m_shared->threads.size();
+    }
+
+    WorkerPool::~WorkerPool() {
+      m_shared->Lock();
+      m_shared->quit = true;
+      m_shared->Broadcast(&m_shared->wake);
+      m_shared->Unlock();
+
+      #ifdef _WIN32
+        for (int i = 0; i < (int)m_shared->threads.size(); ++i) {
+          WaitForSingleObject(m_shared->threads[i], INFINITE);
+          CloseHandle(m_shared->threads[i]);
+        }
+        DeleteCriticalSection(&m_shared->lock);
+      #else
+        for (int i = 0; i < (int)m_shared->threads.size(); ++i) {
+          pthread_join(m_shared->threads[i], 0);
+        }
+        pthread_cond_destroy(&m_shared->done);
+        pthread_cond_destroy(&m_shared->wake);
+        pthread_mutex_destroy(&m_shared->lock);
+      #endif
+
+      delete m_shared;
+    }
+
+    void WorkerPool::Run(Job job, void *context, int count) {
+      m_shared->Lock();
+      m_shared->job = job;
+      m_shared->context = context;
+      m_shared->count = count;
+      m_shared->next = 0;
+      ++m_shared->generation;
+      m_shared->Broadcast(&m_shared->wake);
+
+      // Pitch in rather than sit idle, then wait for whatever the workers are still finishing
+      m_shared->Drain();
+      while (m_shared->busy) {
+        m_shared->Wait(&m_shared->done);
+      }
+      m_shared->Unlock();
+    }
+  }
+}
@@ -433,7 +433,7 @@ namespace Frames {
     void RendererDX11::End() {
     }
 
-    Renderer::Vertex *RendererDX11::Request(int quads) {
+    Renderer::Vertex *RendererDX11::BufferRequest(int quads) {
       if (quads > m_verticesQuadcount) {
         EnvironmentGet()->LogError("Exceeded valid quad count in a single draw call; splitting NYI");
         return 0;
@@ -459,7 +459,7 @@ namespace Frames {
       return (Renderer::Vertex*)mapData.pData + m_verticesLastQuadpos * 4;
     }
 
-    void RendererDX11::Return(int quads /*= -1*/) {
+    void RendererDX11::BufferReturn(int quads) {
       m_context->Unmap(m_vertices, 0);
 
       if (quads == -1) quads = m_verticesLastQuadsize;
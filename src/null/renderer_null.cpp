@@ -63,11 +63,11 @@ namespace Frames {
     void RendererNull::End() {
     }
 
-    Renderer::Vertex *RendererNull::Request(int quads) {
+    Renderer::Vertex *RendererNull::BufferRequest(int quads) {
       return 0; // this is valid! it's an error condition for any renderer but this one, but it's valid
     }
 
-    void RendererNull::Return(int quads /*= -1*/) {
+    void RendererNull::BufferReturn(int quads) {
       EnvironmentGet()->LogError("Vertices returned to null renderer somehow"); // We never give out vertices, so we should never get vertices returned
     }
 
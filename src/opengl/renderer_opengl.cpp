@@ -263,7 +263,7 @@ namespace Frames {
       glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     }
 
-    Renderer::Vertex *RendererOpengl::Request(int quads) {
+    Renderer::Vertex *RendererOpengl::BufferRequest(int quads) {
       if (quads > m_verticesQuadcount) {
         EnvironmentGet()->LogError("Exceeded valid quad count in a single draw call; splitting NYI");
       }
@@ -288,7 +288,7 @@ namespace Frames {
       return rv;
     }
 
-    void RendererOpengl::Return(int quads /*= -1*/) {
+    void RendererOpengl::BufferReturn(int quads) {
       glUnmapBuffer(GL_ARRAY_BUFFER);
 
       if (quads == -1) quads = m_verticesLastQuadsize;
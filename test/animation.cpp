@@ -0,0 +1,108 @@
+/*  Copyright 2014 Mandible Games
+    
+    This file is part of Frames.
+    
+    Please see the COPYING file for detailed licensing information.
+    
+    Frames is dual-licensed software. It is available under both a
+    commercial license, and also under the terms of the GNU General
+    Public License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    Frames is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Frames.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <gtest/gtest.h>
+
+#include <frames/animation.h>
+#include <frames/environment.h>
+#include <frames/frame.h>
+
+#include "lib.h"
+
+TEST(Animation, Tween) {
+  TestEnvironment env;
+
+  Frames::Animator *animator = env->AnimatorGet();
+  animator->AutoAdvanceSet(false);
+
+  Frames::Frame *frame = Frames::Frame::Create(env->RootGet(), "frame");
+  frame->PinSet(Frames::TOPLEFT, env->RootGet(), Frames::TOPLEFT);
+
+  Frames::Animator::Track slide = animator->Tween(Frames::Animator::Target::PinOffset(frame, Frames::X, 0), 100.f, 1.0);
+  animator->Tween(Frames::Animator::Target::Width(frame), 80.f, 2.0, Frames::EASING_IN_OUT, 1.0);
+  EXPECT_EQ(2, animator->ActiveCountGet());
+
+  animator->Advance(0.5);
+  EXPECT_EQ(50, frame->LeftGet());
+  EXPECT_EQ(40, frame->WidthGet());
+
+  animator->Advance(0.5);
+  EXPECT_EQ(100, frame->LeftGet());
+  EXPECT_FALSE(animator->ActiveGet(slide));
+
+  // Halfway through a smoothstep is exactly halfway
+  animator->Advance(1.0);
+  EXPECT_EQ(60, frame->WidthGet());
+
+  // Destroying the target stops its tracks
+  frame->Obliterate();
+  EXPECT_EQ(0, animator->ActiveCountGet());
+}
+
+TEST(Animation, TweenOverlap) {
+  TestEnvironment env;
+
+  Frames::Animator *animator = env->AnimatorGet();
+  animator->AutoAdvanceSet(false);
+
+  Frames::Frame *frame = Frames::Frame::Create(env->RootGet(), "frame");
+
+  Frames::Animator::Track other = animator->Tween(Frames::Animator::Target::Height(frame), 80.f, 4.0);
+  animator->Tween(Frames::Animator::Target::Width(frame), 80.f, 4.0);
+  animator->Tween(Frames::Animator::Target::Width(frame), 20.f, 4.0);
+
+  // Stopping an earlier track doesn't change which of the remaining ones wins
+  animator->Stop(other);
+  animator->Advance(1.0);
+  EXPECT_EQ(35, frame->WidthGet());
+}
+
+TEST(Animation, Keyframes) {
+  TestEnvironment env;
+
+  Frames::Animator *animator = env->AnimatorGet();
+  animator->AutoAdvanceSet(false);
+
+  Frames::Frame *frame = Frames::Frame::Create(env->RootGet(), "frame");
+  frame->PinSet(Frames::TOPLEFT, env->RootGet(), Frames::TOPLEFT);
+
+  std::vector<Frames::Animator::Keyframe> keyframes;
+  keyframes.push_back(Frames::Animator::Keyframe(0, 0.f));
+  keyframes.push_back(Frames::Animator::Keyframe(1, 10.f));
+  keyframes.push_back(Frames::Animator::Keyframe(2, 0.f));
+
+  Frames::Animator::Timeline timeline = animator->TimelineCreate();
+  animator->Keyframes(Frames::Animator::Target::PinOffset(frame, Frames::Y, 0), keyframes, true, timeline);
+
+  animator->Advance(1.0);
+  EXPECT_EQ(10, frame->TopGet());
+  animator->Advance(0.5);
+  EXPECT_EQ(5, frame->TopGet());
+
+  // Pausing the timeline freezes the track
+  animator->TimelineSpeedSet(timeline, 0);
+  animator->Advance(1.0);
+  EXPECT_EQ(5, frame->TopGet());
+
+  // Looping carries on past the end
+  animator->TimelineSpeedSet(timeline, 1);
+  animator->Advance(1.0);
+  EXPECT_EQ(5, frame->TopGet());
+  EXPECT_EQ(1, animator->ActiveCountGet());
+}
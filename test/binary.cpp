@@ -0,0 +1,125 @@
+/*  Copyright 2014 Mandible Games
+    
+    This file is part of Frames.
+    
+    Please see the COPYING file for detailed licensing information.
+    
+    Frames is dual-licensed software. It is available under both a
+    commercial license, and also under the terms of the GNU General
+    Public License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    Frames is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Frames.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <gtest/gtest.h>
+
+#include <frames/binary.h>
+#include <frames/cast.h>
+#include <frames/container.h>
+#include <frames/environment.h>
+#include <frames/mask.h>
+
+#include "lib.h"
+
+TEST(Binary, RoundTrip) {
+  TestEnvironment env;
+
+  Frames::Frame *screen = Frames::Frame::Create(env->RootGet(), "Screen");
+  screen->PinSet(Frames::TOPLEFT, env->RootGet(), Frames::TOPLEFT, 10, 20);
+  screen->WidthSet(400);
+  screen->HeightSet(300);
+  screen->BackgroundSet(Frames::Color(0.5f, 0.25f, 1.f));
+
+  Frames::Mask *mask = Frames::Mask::Create(screen, "Mask");
+  mask->PinSet(Frames::TOPLEFT, screen, Frames::TOPLEFT, 5, 5);
+  mask->PinSet(Frames::BOTTOMRIGHT, screen, Frames::BOTTOMRIGHT, -5, -5);
+  mask->LayerSet(2);
+
+  Frames::Container *list = Frames::Container::Create(mask, "List");
+  list->PinSet(Frames::TOPLEFT, mask, Frames::TOPLEFT);
+  list->SpacingSet(4);
+  for (int i = 0; i < 5; ++i) {
+    Frames::Frame *item = Frames::Frame::Create(list, "Item");
+    item->WidthSet(50);
+    item->HeightSet(10 + i);
+    list->ItemAdd(item);
+  }
+
+  Frames::Frame *hidden = Frames::Frame::Create(screen, "Hidden");
+  hidden->ImplementationSet(true);
+  hidden->VisibleSet(false);
+  hidden->InputModeSet(Frames::Layout::IM_ALL);
+  hidden->RenderOpacitySet(0.5f);
+
+  std::vector<unsigned char> data;
+  ASSERT_TRUE(Frames::Binary::Save(screen, &data));
+  ASSERT_TRUE(Frames::Binary::Is(&data[0], data.size()));
+
+  // Pins to the saved frame's parent follow whatever it's loaded under
+  Frames::Frame *host = Frames::Frame::Create(env->RootGet(), "Host");
+  host->PinSet(Frames::TOPLEFT, env->RootGet(), Frames::TOPLEFT, 100, 0);
+  Frames::Frame *loaded = Frames::Binary::Load(host, &data[0], data.size());
+  ASSERT_TRUE(loaded != 0);
+  EXPECT_EQ(host, loaded->ParentGet());
+  EXPECT_EQ("Screen", loaded->NameGet());
+  EXPECT_EQ(host->LeftGet() + 10, loaded->LeftGet());
+  EXPECT_EQ(400, loaded->WidthGet());
+  EXPECT_EQ(Frames::Color(0.5f, 0.25f, 1.f), loaded->BackgroundGet());
+
+  Frames::Mask *loadedMask = Frames::Cast<Frames::Mask>(loaded->ChildGetByName("Mask"));
+  ASSERT_TRUE(loadedMask != 0);
+  EXPECT_EQ(2, loadedMask->LayerGet());
+  EXPECT_EQ(mask->WidthGet(), loadedMask->WidthGet());
+  EXPECT_EQ(mask->HeightGet(), loadedMask->HeightGet());
+
+  Frames::Container *loadedList = Frames::Cast<Frames::Container>(loadedMask->ChildGetByName("List"));
+  ASSERT_TRUE(loadedList != 0);
+  ASSERT_EQ(5, loadedList->ItemCountGet());
+  EXPECT_EQ(4, loadedList->SpacingGet());
+  EXPECT_EQ(list->ItemGet(4)->TopGet() - list->TopGet(), loadedList->ItemGet(4)->TopGet() - loadedList->TopGet());
+
+  Frames::Frame *loadedHidden = loaded->ChildImplementationGetByName("Hidden");
+  ASSERT_TRUE(loadedHidden != 0);
+  EXPECT_FALSE(loadedHidden->VisibleGet());
+  EXPECT_EQ(Frames::Layout::IM_ALL, loadedHidden->InputModeGet());
+  EXPECT_EQ(0.5f, loadedHidden->RenderOpacityGet());
+
+  // Saving what was loaded gives back the same bytes
+  std::vector<unsigned char> again;
+  EXPECT_TRUE(Frames::Binary::Save(loaded, &again));
+  EXPECT_EQ(data, again);
+}
+
+TEST(Binary, Malformed) {
+  TestEnvironment env;
+  env.AllowErrors();
+
+  Frames::Frame *screen = Frames::Frame::Create(env->RootGet(), "Screen");
+  for (int i = 0; i < 10; ++i) {
+    Frames::Frame::Create(screen, "Child")->PinSet(Frames::CENTER, screen, Frames::CENTER);
+  }
+
+  // Pins to frames that aren't saved can't be represented
+  Frames::Frame *outside = Frames::Frame::Create(env->RootGet(), "Outside");
+  Frames::Frame::Create(screen, "Stray")->PinSet(Frames::TOPLEFT, outside, Frames::TOPLEFT);
+
+  std::vector<unsigned char> data;
+  EXPECT_FALSE(Frames::Binary::Save(screen, &data));
+
+  // Every truncation fails cleanly, leaving nothing behind
+  Frames::Frame *host = Frames::Frame::Create(env->RootGet(), "Host");
+  for (std::size_t bytes = 0; bytes < data.size(); ++bytes) {
+    EXPECT_EQ(0, Frames::Binary::Load(host, &data[0], bytes));
+  }
+  EXPECT_TRUE(host->ChildrenGet().empty());
+
+  // Unknown versions are rejected
+  data[4] = Frames::Binary::VERSION + 1;
+  EXPECT_EQ(0, Frames::Binary::Load(host, &data[0], data.size()));
+}
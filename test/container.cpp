@@ -0,0 +1,94 @@
+/*  Copyright 2014 Mandible Games
+    
+    This file is part of Frames.
+    
+    Please see the COPYING file for detailed licensing information.
+    
+    Frames is dual-licensed software. It is available under both a
+    commercial license, and also under the terms of the GNU General
+    Public License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    Frames is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Frames.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <gtest/gtest.h>
+
+#include <frames/container.h>
+#include <frames/environment.h>
+
+#include "lib.h"
+
+TEST(Container, Stack) {
+  TestEnvironment env;
+
+  Frames::Container *container = Frames::Container::Create(env->RootGet(), "Container");
+  container->PinSet(Frames::TOPLEFT, env->RootGet(), Frames::TOPLEFT, 10, 10);
+  container->SpacingSet(5);
+
+  std::vector<Frames::Frame *> items;
+  for (int i = 0; i < 4; ++i) {
+    Frames::Frame *item = Frames::Frame::Create(container, "Item");
+    item->WidthSet(40);
+    item->HeightSet(20);
+    container->ItemAdd(item);
+    items.push_back(item);
+  }
+
+  EXPECT_EQ(10.f, items[0]->TopGet());
+  EXPECT_EQ(35.f, items[1]->TopGet());
+  EXPECT_EQ(85.f, items[3]->TopGet());
+  EXPECT_EQ(40.f, container->WidthGet());
+  EXPECT_EQ(95.f, container->HeightGet());
+
+  // Growing one item moves only the items after it, once its Size event fires
+  items[1]->HeightSet(30);
+  env->Render();
+  EXPECT_EQ(10.f, items[0]->TopGet());
+  EXPECT_EQ(95.f, items[3]->TopGet());
+
+  container->ArrangementSet(Frames::Container::STACK_HORIZONTAL);
+  EXPECT_EQ(10.f, items[0]->LeftGet());
+  EXPECT_EQ(55.f, items[1]->LeftGet());
+  EXPECT_EQ(10.f, items[1]->TopGet());
+
+  // Destroyed items are removed
+  items[1]->Obliterate();
+  EXPECT_EQ(3, container->ItemCountGet());
+  EXPECT_EQ(55.f, items[2]->LeftGet());
+}
+
+TEST(Container, GridFlow) {
+  TestEnvironment env;
+
+  Frames::Container *container = Frames::Container::Create(env->RootGet(), "Container");
+  container->PinSet(Frames::TOPLEFT, env->RootGet(), Frames::TOPLEFT);
+  container->ArrangementSet(Frames::Container::GRID);
+  container->GridColumnsSet(2);
+
+  std::vector<Frames::Frame *> items;
+  for (int i = 0; i < 5; ++i) {
+    Frames::Frame *item = Frames::Frame::Create(container, "Item");
+    item->WidthSet(30);
+    item->HeightSet(30);
+    container->ItemAdd(item);
+    items.push_back(item);
+  }
+
+  EXPECT_EQ(30.f, items[1]->LeftGet());
+  EXPECT_EQ(30.f, items[2]->TopGet());
+  EXPECT_EQ(60.f, items[4]->TopGet());
+  EXPECT_EQ(90.f, container->HeightGet());
+
+  container->ArrangementSet(Frames::Container::FLOW);
+  container->WidthSet(100);
+  EXPECT_EQ(60.f, items[2]->LeftGet());
+  EXPECT_EQ(0.f, items[3]->LeftGet());
+  EXPECT_EQ(30.f, items[3]->TopGet());
+  EXPECT_EQ(60.f, container->HeightGet());
+}
@@ -159,3 +159,40 @@ TEST(Core, Error) {
 
   Frames::Configuration::Set(Frames::Configuration::Global());  // force it out of scope
 }
+
+static void AllocationHandler(Frames::Handle *handle) { }
+
+TEST(Core, Allocation) {
+  TestEnvironment env;
+
+  Frames::Environment::AllocationStats before = env->AllocationStatsGet();
+
+  Frames::Frame *screen = Frames::Frame::Create(env->RootGet(), "Screen");
+  for (int i = 0; i < 1000; ++i) {
+    Frames::Frame *frame = Frames::Frame::Create(screen, "Frame");
+    frame->EventAttach(Frames::Layout::Event::MouseLeftClick, AllocationHandler);
+  }
+
+  Frames::Environment::AllocationStats built = env->AllocationStatsGet();
+  EXPECT_LT(before.live, built.live);
+  EXPECT_LT(before.liveBytes, built.liveBytes);
+  EXPECT_LE(built.liveBytes, built.reservedBytes + built.oversizeBytes);
+
+  // Everything comes back, but the slabs stick around for reuse
+  screen->Obliterate();
+  Frames::Environment::AllocationStats freed = env->AllocationStatsGet();
+  EXPECT_EQ(before.live, freed.live);
+  EXPECT_EQ(before.liveBytes, freed.liveBytes);
+  EXPECT_EQ(built.reservedBytes, freed.reservedBytes);
+
+  screen = Frames::Frame::Create(env->RootGet(), "Screen");
+  for (int i = 0; i < 1000; ++i) {
+    Frames::Frame *frame = Frames::Frame::Create(screen, "Frame");
+    frame->EventAttach(Frames::Layout::Event::MouseLeftClick, AllocationHandler);
+  }
+
+  Frames::Environment::AllocationStats rebuilt = env->AllocationStatsGet();
+  EXPECT_EQ(built.live, rebuilt.live);
+  EXPECT_EQ(built.reservedBytes, rebuilt.reservedBytes);
+  EXPECT_EQ(built.slabs, rebuilt.slabs);
+}
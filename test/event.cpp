@@ -19,8 +19,10 @@
 
 #include <gtest/gtest.h>
 
+#include <frames/detail_format.h>
 #include <frames/frame.h>
 #include <frames/event_definition.h>
+#include <frames/profiler.h>
 
 #include "lib.h"
 
@@ -385,3 +387,218 @@ TEST(Event, Reparent) {
   compare.Append("EVENT");
   container.b->EventTrigger(EventTestHelperDB);
 }
+
+static int s_diveMain = 0;
+static int s_diveDive = 0;
+static int s_diveBubble = 0;
+static void DiveMainCount(Frames::Handle *) { ++s_diveMain; }
+static void DiveDiveCount(Frames::Handle *) { ++s_diveDive; }
+static void DiveBubbleCount(Frames::Handle *) { ++s_diveBubble; }
+
+static Frames::Layout *s_diveAttachTarget = 0;
+static void DiveAttachBubble(Frames::Handle *) { s_diveAttachTarget->EventAttach(EventTestHelperDB.Bubble, DiveBubbleCount); }
+
+TEST(Event, DiveSkip) {
+  TestEnvironment env;
+
+  Frames::Frame *outer = Frames::Frame::Create(env->RootGet(), "outer");
+  Frames::Frame *middle = Frames::Frame::Create(outer, "middle");
+  Frames::Frame *inner = Frames::Frame::Create(middle, "inner");
+  Frames::Frame *sibling = Frames::Frame::Create(middle, "sibling");
+
+  s_diveMain = s_diveDive = s_diveBubble = 0;
+
+  // Nobody up the chain listens, so only the target's own handlers run
+  inner->EventAttach(EventTestHelperDB, DiveMainCount);
+  sibling->EventAttach(EventTestHelperDB.Dive, DiveDiveCount);
+  inner->EventTrigger(EventTestHelperDB);
+  EXPECT_EQ(1, s_diveMain);
+  EXPECT_EQ(0, s_diveDive);
+
+  // The ancestor summary notices new listeners
+  outer->EventAttach(EventTestHelperDB.Dive, DiveDiveCount);
+  middle->EventAttach(EventTestHelperDB.Bubble, DiveBubbleCount);
+  inner->EventTrigger(EventTestHelperDB);
+  EXPECT_EQ(2, s_diveMain);
+  EXPECT_EQ(1, s_diveDive);
+  EXPECT_EQ(1, s_diveBubble);
+
+  // And reparenting
+  inner->ParentSet(sibling);
+  inner->EventTrigger(EventTestHelperDB);
+  EXPECT_EQ(3, s_diveDive);
+  EXPECT_EQ(2, s_diveBubble);
+
+  inner->ParentSet(env->RootGet());
+  inner->EventTrigger(EventTestHelperDB);
+  EXPECT_EQ(4, s_diveMain);
+  EXPECT_EQ(3, s_diveDive);
+  EXPECT_EQ(2, s_diveBubble);
+
+  // And removals
+  inner->ParentSet(middle);
+  outer->EventDetach(EventTestHelperDB.Dive, DiveDiveCount);
+  middle->EventDetach(EventTestHelperDB.Bubble, DiveBubbleCount);
+  inner->EventTrigger(EventTestHelperDB);
+  EXPECT_EQ(5, s_diveMain);
+  EXPECT_EQ(3, s_diveDive);
+  EXPECT_EQ(2, s_diveBubble);
+}
+
+TEST(Event, DiveAttach) {
+  TestEnvironment env;
+
+  Frames::Frame *outer = Frames::Frame::Create(env->RootGet(), "outer");
+  Frames::Frame *middle = Frames::Frame::Create(outer, "middle");
+  Frames::Frame *inner = Frames::Frame::Create(middle, "inner");
+  inner->EventAttach(EventTestHelperDB, DiveMainCount);
+
+  s_diveBubble = 0;
+
+  // A dive handler can hook the bubble on a layout further down the chain that wasn't listening when the event started
+  s_diveAttachTarget = middle;
+  outer->EventAttach(EventTestHelperDB.Dive, DiveAttachBubble);
+  inner->EventTrigger(EventTestHelperDB);
+  EXPECT_EQ(1, s_diveBubble);
+  outer->EventDetach(EventTestHelperDB.Dive, DiveAttachBubble);
+  middle->EventDetach(EventTestHelperDB.Bubble, DiveBubbleCount);
+
+  // So can the target's own handler, even though nothing up the chain was listening at all
+  s_diveBubble = 0;
+  s_diveAttachTarget = outer;
+  inner->EventAttach(EventTestHelperDB, DiveAttachBubble);
+  inner->EventTrigger(EventTestHelperDB);
+  EXPECT_EQ(1, s_diveBubble);
+}
+
+struct EventTestCounter {
+  EventTestCounter() : calls(0) { }
+  void Call(Frames::Handle *) { ++calls; }
+  int calls;
+};
+
+TEST(Event, Profiler) {
+  TestEnvironment env;
+
+  Frames::Frame *frame = Frames::Frame::Create(env->RootGet(), "frame");
+
+  EventTestCounter counter;
+  frame->EventAttach(EventTestHelper, Frames::Delegate<void (Frames::Handle *)>(&counter, &EventTestCounter::Call));
+
+  EXPECT_EQ((Frames::EventProfiler *)0, env->EventProfilerGet());
+  frame->EventTrigger(EventTestHelper);
+
+  env->EventProfilerSet(true);
+  ASSERT_NE((Frames::EventProfiler *)0, env->EventProfilerGet());
+  frame->EventTrigger(EventTestHelper);
+  frame->EventTrigger(EventTestHelper);
+
+  std::vector<Frames::EventProfiler::Entry> entries;
+  env->EventProfilerGet()->TopGet(Frames::EventProfiler::CATEGORY_VERB, -1, &entries);
+  ASSERT_EQ(1, entries.size());
+  EXPECT_EQ(&EventTestHelper, entries[0].verb);
+  EXPECT_EQ(2, entries[0].count);
+
+  env->EventProfilerGet()->TopGet(Frames::EventProfiler::CATEGORY_TYPE, -1, &entries);
+  ASSERT_EQ(1, entries.size());
+  EXPECT_STREQ("Frame", entries[0].type);
+
+  env->EventProfilerGet()->TopGet(Frames::EventProfiler::CATEGORY_HANDLER, -1, &entries);
+  ASSERT_EQ(1, entries.size());
+  EXPECT_TRUE(entries[0].handler.IsEqual(Frames::Delegate<void (Frames::Handle *)>(&counter, &EventTestCounter::Call).GetMemento()));
+
+  // Handlers are reported by the object they're bound to
+  std::string report = env->EventProfilerGet()->ReportGet(-1);
+  EXPECT_NE(std::string::npos, report.find(Frames::detail::Format("%p::", &counter)));
+
+  env->EventProfilerSet(false);
+  EXPECT_EQ((Frames::EventProfiler *)0, env->EventProfilerGet());
+  EXPECT_EQ(3, counter.calls);
+}
+
+// Stand-in for a per-row handler that captures its own state
+struct EventTestRowHandler {
+  EventTestRowHandler(int *total, int index) : total(total), index(index) { }
+  void operator()(Frames::Handle *) { *total += index; }
+  bool operator==(const EventTestRowHandler &rhs) const { return total == rhs.total && index == rhs.index; }
+
+  int *total;
+  int index;
+};
+
+TEST(Event, Functor) {
+  TestEnvironment env;
+
+  Frames::Frame *frame = Frames::Frame::Create(env->RootGet(), "frame");
+
+  int total = 0;
+  for (int i = 1; i <= 4; ++i) {
+    frame->EventAttach(EventTestHelper, EventTestRowHandler(&total, i));
+  }
+
+  frame->EventTrigger(EventTestHelper);
+  EXPECT_EQ(10, total);
+
+  frame->EventDetach(EventTestHelper, EventTestRowHandler(&total, 2));
+  frame->EventDetach(EventTestHelper, EventTestRowHandler(&total, 5)); // not attached; harmless
+
+  total = 0;
+  frame->EventTrigger(EventTestHelper);
+  EXPECT_EQ(8, total);
+
+  Frames::Layout::EventToken token = frame->EventAttach(EventTestHelper, EventTestRowHandler(&total, 100));
+  frame->EventDetach(token);
+
+  total = 0;
+  frame->EventTrigger(EventTestHelper);
+  EXPECT_EQ(8, total);
+}
+
+static int s_tokenCalls = 0;
+static Frames::Layout *s_tokenLayout = 0;
+static Frames::Layout::EventToken s_tokenSelf;
+static Frames::Layout::EventToken s_tokenLater;
+static void TokenCount(Frames::Handle *) { ++s_tokenCalls; }
+static void TokenDetachSelf(Frames::Handle *) { ++s_tokenCalls; s_tokenLayout->EventDetach(s_tokenSelf); }
+static void TokenDetachLater(Frames::Handle *) { s_tokenLayout->EventDetach(s_tokenLater); s_tokenLater = Frames::Layout::EventToken(); }
+
+TEST(Event, Token) {
+  TestEnvironment env;
+
+  Frames::Frame *frame = Frames::Frame::Create(env->RootGet(), "frame");
+  s_tokenLayout = frame;
+  s_tokenCalls = 0;
+
+  // Identical handlers are told apart by their tokens
+  Frames::Layout::EventToken first = frame->EventAttach(EventTestHelper, TokenCount);
+  Frames::Layout::EventToken second = frame->EventAttach(EventTestHelper, TokenCount);
+  frame->EventTrigger(EventTestHelper);
+  EXPECT_EQ(2, s_tokenCalls);
+
+  frame->EventDetach(second);
+  frame->EventTrigger(EventTestHelper);
+  EXPECT_EQ(3, s_tokenCalls);
+
+  frame->EventDetach(first);
+  frame->EventDetach(Frames::Layout::EventToken()); // refers to nothing; harmless
+  frame->EventTrigger(EventTestHelper);
+  EXPECT_EQ(3, s_tokenCalls);
+
+  // A handler can detach itself while it's running; the handlers after it still run
+  s_tokenSelf = frame->EventAttach(EventTestHelper, TokenDetachSelf, 0);
+  frame->EventAttach(EventTestHelper, TokenCount, 1);
+  s_tokenCalls = 0;
+  frame->EventTrigger(EventTestHelper);
+  EXPECT_EQ(2, s_tokenCalls);
+  frame->EventTrigger(EventTestHelper);
+  EXPECT_EQ(3, s_tokenCalls);
+
+  // Detaching a handler that hasn't been reached yet keeps it from running
+  frame->EventAttach(EventTestHelper, TokenDetachLater, -1);
+  s_tokenLater = frame->EventAttach(EventTestHelper, TokenCount, 2);
+  s_tokenCalls = 0;
+  frame->EventTrigger(EventTestHelper);
+  EXPECT_EQ(1, s_tokenCalls);
+  frame->EventTrigger(EventTestHelper);
+  EXPECT_EQ(2, s_tokenCalls);
+}
@@ -21,6 +21,7 @@
 
 #include <frames/frame.h>
 #include <frames/detail_format.h>
+#include <frames/mask.h>
 
 #include "lib.h"
 
@@ -275,3 +276,168 @@ TEST(Input, Key) {
     env->Input_KeyText("Test2");
   }
 }
+
+TEST(Input, Coalesce) {
+  Frames::Input::Sequence sequence;
+  sequence.Queue(Frames::Input::Command::CreateMouseMove(1, 1));
+  sequence.Queue(Frames::Input::Command::CreateMouseMove(2, 3));
+  sequence.Queue(Frames::Input::Command::CreateMouseMove(4, 5));
+  sequence.Queue(Frames::Input::Command::CreateMouseDown(0));
+  sequence.Queue(Frames::Input::Command::CreateMouseMove(6, 7));
+  sequence.Queue(Frames::Input::Command::CreateMouseWheel(1));
+  sequence.Queue(Frames::Input::Command::CreateMouseWheel(2));
+  sequence.Queue(Frames::Input::Command::CreateMouseUp(0));
+  sequence.Queue(Frames::Input::Command::CreateKeyText("a"));
+  sequence.Queue(Frames::Input::Command::CreateKeyText("bc"));
+  sequence.Queue(Frames::Input::Command::CreateKeyDown(Frames::Input::Return));
+  sequence.Queue(Frames::Input::Command::CreateKeyText("d"));
+  sequence.Coalesce();
+
+  const std::vector<Frames::Input::Command> &queue = sequence.GetQueue();
+  ASSERT_EQ(8, queue.size());
+  EXPECT_EQ(Frames::Input::Command::MOUSEMOVE, queue[0].TypeGet());
+  EXPECT_EQ(4, queue[0].MouseMoveXGet());
+  EXPECT_EQ(5, queue[0].MouseMoveYGet());
+  EXPECT_EQ(Frames::Input::Command::MOUSEDOWN, queue[1].TypeGet());
+  EXPECT_EQ(Frames::Input::Command::MOUSEMOVE, queue[2].TypeGet());
+  EXPECT_EQ(6, queue[2].MouseMoveXGet());
+  EXPECT_EQ(Frames::Input::Command::MOUSEWHEEL, queue[3].TypeGet());
+  EXPECT_EQ(3, queue[3].MouseWheelDeltaGet());
+  EXPECT_EQ(Frames::Input::Command::MOUSEUP, queue[4].TypeGet());
+  EXPECT_EQ(Frames::Input::Command::KEYTEXT, queue[5].TypeGet());
+  EXPECT_EQ("abc", queue[5].KeyTextGet());
+  EXPECT_EQ(Frames::Input::Command::KEYDOWN, queue[6].TypeGet());
+  EXPECT_EQ("d", queue[7].KeyTextGet());
+}
+
+TEST(Input, Probe) {
+  TestEnvironment env;
+
+  Frames::Frame *back = Frames::Frame::Create(env->RootGet(), "back");
+  back->PinSet(Frames::TOPLEFT, env->RootGet(), Frames::TOPLEFT, 100, 100);
+  back->WidthSet(200);
+  back->HeightSet(200);
+  back->InputModeSet(Frames::Layout::IM_ALL);
+
+  Frames::Frame *front = Frames::Frame::Create(env->RootGet(), "front");
+  front->PinSet(Frames::TOPLEFT, env->RootGet(), Frames::TOPLEFT, 150, 150);
+  front->WidthSet(100);
+  front->HeightSet(100);
+  front->InputModeSet(Frames::Layout::IM_ALL);
+  front->LayerSet(1);
+
+  // Higher layers win where frames overlap; edges include the top-left and exclude the bottom-right
+  EXPECT_EQ(back, env->ProbeAsMouse(120, 120));
+  EXPECT_EQ(front, env->ProbeAsMouse(200, 200));
+  EXPECT_EQ(back, env->ProbeAsMouse(100, 100));
+  EXPECT_EQ(0, env->ProbeAsMouse(300, 120));
+  EXPECT_EQ(0, env->ProbeAsMouse(50, 50));
+
+  front->LayerSet(-1);
+  EXPECT_EQ(back, env->ProbeAsMouse(200, 200));
+  front->LayerSet(1);
+  EXPECT_EQ(front, env->ProbeAsMouse(200, 200));
+
+  // Children sit above their parents, whatever their layer
+  Frames::Frame *child = Frames::Frame::Create(back, "child");
+  child->PinSet(Frames::TOPLEFT, back, Frames::TOPLEFT, 10, 10);
+  child->WidthSet(20);
+  child->HeightSet(20);
+  child->InputModeSet(Frames::Layout::IM_ALL);
+  child->LayerSet(-5);
+  EXPECT_EQ(child, env->ProbeAsMouse(115, 115));
+
+  // Layouts that don't take input are transparent to it
+  child->InputModeSet(Frames::Layout::IM_NONE);
+  EXPECT_EQ(back, env->ProbeAsMouse(115, 115));
+  child->InputModeSet(Frames::Layout::IM_ALL);
+  EXPECT_EQ(child, env->ProbeAsMouse(115, 115));
+
+  // A hidden ancestor hides everything under it
+  back->VisibleSet(false);
+  EXPECT_EQ(0, env->ProbeAsMouse(115, 115));
+  EXPECT_EQ(front, env->ProbeAsMouse(200, 200));
+  back->VisibleSet(true);
+  EXPECT_EQ(child, env->ProbeAsMouse(115, 115));
+
+  // Moving a frame moves its entry
+  child->PinSet(Frames::TOPLEFT, back, Frames::TOPLEFT, 40, 10);
+  EXPECT_EQ(back, env->ProbeAsMouse(115, 115));
+  EXPECT_EQ(child, env->ProbeAsMouse(145, 115));
+
+  // Destroyed layouts leave the index
+  child->Obliterate();
+  EXPECT_EQ(back, env->ProbeAsMouse(145, 115));
+  front->Obliterate();
+  EXPECT_EQ(back, env->ProbeAsMouse(200, 200));
+}
+
+TEST(Input, ProbeMask) {
+  TestEnvironment env;
+
+  Frames::Mask *mask = Frames::Mask::Create(env->RootGet(), "mask");
+  mask->PinSet(Frames::TOPLEFT, env->RootGet(), Frames::TOPLEFT, 100, 100);
+  mask->WidthSet(100);
+  mask->HeightSet(100);
+
+  // Hanging out of its mask, and with a sibling of the mask underneath the part that hangs out
+  Frames::Frame *inside = Frames::Frame::Create(mask, "inside");
+  inside->PinSet(Frames::TOPLEFT, mask, Frames::TOPLEFT, 50, 50);
+  inside->WidthSet(100);
+  inside->HeightSet(100);
+  inside->InputModeSet(Frames::Layout::IM_ALL);
+
+  Frames::Frame *under = Frames::Frame::Create(env->RootGet(), "under");
+  under->PinSet(Frames::TOPLEFT, env->RootGet(), Frames::TOPLEFT, 200, 200);
+  under->WidthSet(100);
+  under->HeightSet(100);
+  under->InputModeSet(Frames::Layout::IM_ALL);
+  under->LayerSet(-1);
+
+  EXPECT_EQ(inside, env->ProbeAsMouse(175, 175));
+  EXPECT_EQ(under, env->ProbeAsMouse(225, 225));
+  EXPECT_EQ(0, env->ProbeAsMouse(225, 175));
+
+  // The mask's own bounds decide, even as it moves
+  mask->WidthSet(200);
+  mask->HeightSet(200);
+  EXPECT_EQ(inside, env->ProbeAsMouse(225, 225));
+  mask->PinSet(Frames::TOPLEFT, env->RootGet(), Frames::TOPLEFT, 150, 150);
+  EXPECT_EQ(0, env->ProbeAsMouse(175, 175));
+  EXPECT_EQ(inside, env->ProbeAsMouse(275, 275));
+}
+
+TEST(Input, ProbeTree) {
+  TestEnvironment env;
+
+  // A scene with overlap, layers, masks, hidden frames and a render transform, probed both ways
+  std::vector<Frames::Layout *> frames;
+  frames.push_back(env->RootGet());
+  unsigned int seed = 12345;
+  for (int i = 0; i < 200; ++i) {
+    seed = seed * 1103515245 + 12345;
+    Frames::Layout *parent = frames[(seed >> 8) % frames.size()];
+    Frames::Frame *frame = (seed >> 4) % 13 == 0 ? Frames::Mask::Create(parent, "mask") : Frames::Frame::Create(parent, "frame");
+    frame->PinSet(Frames::TOPLEFT, parent, Frames::TOPLEFT, (float)((seed >> 12) % 160) - 40, (float)((seed >> 20) % 120) - 30);
+    frame->WidthSet((float)((seed >> 3) % 150 + 10));
+    frame->HeightSet((float)((seed >> 6) % 150 + 10));
+    frame->LayerSet((float)((seed >> 9) % 4));
+    if ((seed >> 14) % 3) {
+      frame->InputModeSet(Frames::Layout::IM_ALL);
+    }
+    if ((seed >> 16) % 17 == 0) {
+      frame->VisibleSet(false);
+    }
+    if ((seed >> 18) % 29 == 0) {
+      frame->RenderTranslationSet(Frames::Vector(15, -10));
+      frame->RenderScaleSet(1.5f);
+    }
+    frames.push_back(frame);
+  }
+
+  for (int y = 0; y < env.HeightGet(); y += 7) {
+    for (int x = 0; x < env.WidthGet(); x += 7) {
+      EXPECT_EQ(env->RootGet()->ProbeAsMouse((float)x, (float)y), env->ProbeAsMouse((float)x, (float)y));
+    }
+  }
+}
@@ -19,6 +19,9 @@
 
 #include <gtest/gtest.h>
 
+#include <frames/cast.h>
+#include <frames/container.h>
+#include <frames/detail_format.h>
 #include <frames/frame.h>
 #include <frames/mask.h>
 #include <frames/raw.h>
@@ -321,4 +324,569 @@ TEST(Layout, ChildGet) {
   EXPECT_EQ(0, parent->ChildImplementationGetByName("child"));
   EXPECT_EQ(implementation, parent->ChildImplementationGetByName("implementation"));
   EXPECT_EQ(0, parent->ChildImplementationGetByName("invalid"));
-}
\ No newline at end of file
+}
+
+TEST(Layout, FindByPath) {
+  TestEnvironment env;
+
+  Frames::Frame *panel = Frames::Frame::Create(env->RootGet(), "Panel");
+  Frames::Frame *list = Frames::Frame::Create(panel, "List");
+
+  // Enough rows that the list indexes its children by name
+  Frames::Frame *row = 0;
+  for (int i = 0; i < 40; ++i) {
+    row = Frames::Frame::Create(list, Frames::detail::Format("Row%d", i));
+    Frames::Frame::Create(row, "Label");
+  }
+
+  EXPECT_EQ(row, env->RootGet()->FindByPath("Panel.List.Row39"));
+  EXPECT_EQ(row->ChildGetByName("Label"), env->RootGet()->FindByPath("Panel.List.Row39.Label"));
+  EXPECT_EQ(list->ChildGetByName("Row7"), panel->FindByPath("List.Row7"));
+  EXPECT_EQ(0, env->RootGet()->FindByPath("Panel.List.Row40"));
+  EXPECT_EQ(0, env->RootGet()->FindByPath("Panel..List"));
+  EXPECT_EQ(0, env->RootGet()->FindByPath(""));
+
+  // Equal names are shared
+  EXPECT_EQ(&panel->FindByPath("List.Row1.Label")->NameGet(), &panel->FindByPath("List.Row2.Label")->NameGet());
+
+  // The index follows renames and reparenting
+  row->NameSet("Last");
+  EXPECT_EQ(0, list->ChildGetByName("Row39"));
+  EXPECT_EQ(row, list->ChildGetByName("Last"));
+
+  row->ParentSet(panel);
+  EXPECT_EQ(0, list->ChildGetByName("Last"));
+  EXPECT_EQ(row, env->RootGet()->FindByPath("Panel.Last"));
+
+  Frames::Frame *implementation = list->ChildGetByName("Row3");
+  implementation->ImplementationSet(true);
+  EXPECT_EQ(0, list->ChildGetByName("Row3"));
+  EXPECT_EQ(implementation, list->ChildImplementationGetByName("Row3"));
+
+  list->ChildGetByName("Row4")->Obliterate();
+  EXPECT_EQ(0, list->ChildGetByName("Row4"));
+}
+
+TEST(Layout, ChildGetDuplicate) {
+  TestEnvironment env;
+
+  // Below and above the size where children get indexed by name, the same child wins: the first in draw order
+  for (int count = 4; count <= 24; count += 20) {
+    Frames::Frame *parent = Frames::Frame::Create(env->RootGet(), "parent");
+
+    Frames::Frame *lowest = 0;
+    for (int i = 0; i < count; ++i) {
+      Frames::Frame *child = Frames::Frame::Create(parent, "Item");
+      child->LayerSet((float)((i * 7 + 3) % 5) - 2);
+      if (!lowest || child->LayerGet() < lowest->LayerGet()) {
+        lowest = child;
+      }
+    }
+
+    EXPECT_EQ(*parent->ChildrenGet().begin(), parent->ChildGetByName("Item"));
+    EXPECT_EQ(lowest, parent->ChildGetByName("Item"));
+
+    // And it keeps up with layer changes
+    Frames::Frame *last = *parent->ChildrenGet().rbegin();
+    last->LayerSet(-10);
+    EXPECT_EQ(last, parent->ChildGetByName("Item"));
+  }
+}
+
+TEST(Layout, ChildGetIndexed) {
+  TestEnvironment env;
+
+  // Plenty of children, so lookups go through the name index
+  Frames::Frame *parent = Frames::Frame::Create(env->RootGet(), "parent");
+  std::vector<Frames::Frame *> rows;
+  for (int i = 0; i < 32; ++i) {
+    Frames::Frame *row = Frames::Frame::Create(parent, i % 2 ? "Row" : "Spacer");
+    if (i % 2) {
+      rows.push_back(row);
+    }
+  }
+  EXPECT_EQ(rows[0], parent->ChildGetByName("Row"));
+
+  // Raising the first duplicate hands the lookup to the next one in draw order, and lowering a later one takes it back
+  rows[0]->LayerSet(5);
+  EXPECT_EQ(rows[1], parent->ChildGetByName("Row"));
+  rows[9]->LayerSet(-1);
+  EXPECT_EQ(rows[9], parent->ChildGetByName("Row"));
+  rows[9]->LayerSet(5);
+  EXPECT_EQ(rows[1], parent->ChildGetByName("Row"));
+
+  // Implementation children are indexed separately
+  rows[1]->ImplementationSet(true);
+  EXPECT_EQ(rows[2], parent->ChildGetByName("Row"));
+  EXPECT_EQ(rows[1], parent->ChildImplementationGetByName("Row"));
+
+  // Renames move a child between names
+  rows[2]->NameSet("Spacer");
+  EXPECT_EQ(rows[3], parent->ChildGetByName("Row"));
+  rows[2]->NameSet("Row");
+  EXPECT_EQ(rows[2], parent->ChildGetByName("Row"));
+
+  // Missing names, and names only used by implementation children, find nothing
+  EXPECT_EQ((Frames::Frame *)0, parent->ChildGetByName("Header"));
+  rows[1]->NameSet("Header");
+  EXPECT_EQ((Frames::Frame *)0, parent->ChildGetByName("Header"));
+  EXPECT_EQ(rows[1], parent->ChildImplementationGetByName("Header"));
+}
+
+static int s_clicks = 0;
+static void ClickCount(Frames::Handle *) { ++s_clicks; }
+
+TEST(Layout, CloneSubtree) {
+  TestEnvironment env;
+
+  Frames::Frame *outside = Frames::Frame::Create(env->RootGet(), "outside");
+  outside->PinSet(Frames::TOPLEFT, env->RootGet(), Frames::TOPLEFT, 10, 10);
+
+  Frames::Frame *prototype = Frames::Frame::Create(env->RootGet(), "Prototype");
+  prototype->PinSet(Frames::TOPLEFT, outside, Frames::BOTTOMRIGHT);
+  prototype->WidthSet(100);
+  prototype->HeightSet(50);
+  prototype->BackgroundSet(Frames::Color(1, 0, 0));
+
+  Frames::Frame *label = Frames::Frame::Create(prototype, "Label");
+  label->PinSet(Frames::TOPLEFT, prototype, Frames::TOPLEFT, 5, 5);
+  label->LayerSet(2);
+
+  Frames::Frame *button = Frames::Frame::Create(prototype, "Button");
+  button->PinSet(Frames::TOPLEFT, label, Frames::BOTTOMLEFT);
+  button->InputModeSet(Frames::Layout::IM_ALL);
+  button->EventAttach(Frames::Layout::Event::MouseLeftClick, ClickCount);
+
+  Frames::Container *items = Frames::Container::Create(prototype, "Items");
+  items->ArrangementSet(Frames::Container::STACK_HORIZONTAL);
+  for (int i = 0; i < 3; ++i) {
+    Frames::Frame *item = Frames::Frame::Create(items, "Item");
+    item->WidthSet(10);
+    items->ItemAdd(item);
+  }
+
+  Frames::Frame *host = Frames::Frame::Create(env->RootGet(), "Host");
+  Frames::Frame *clone = prototype->CloneSubtree(host);
+  ASSERT_TRUE(clone != 0);
+  EXPECT_EQ(host, clone->ParentGet());
+  EXPECT_EQ("Prototype", clone->NameGet());
+  EXPECT_EQ(Frames::Color(1, 0, 0), clone->BackgroundGet());
+
+  // Pins inside the prototype point at the clones; pins out of it are kept
+  Frames::Frame *cloneLabel = clone->ChildGetByName("Label");
+  Frames::Frame *cloneButton = clone->ChildGetByName("Button");
+  EXPECT_EQ(outside, clone->PinGet(Frames::TOPLEFT).target);
+  EXPECT_EQ(cloneLabel, cloneButton->PinGet(Frames::TOPLEFT).target);
+  EXPECT_EQ(2, cloneLabel->LayerGet());
+  EXPECT_EQ(100, clone->WidthGet());
+  EXPECT_EQ(button->LeftGet(), cloneButton->LeftGet());
+  EXPECT_EQ(button->TopGet(), cloneButton->TopGet());
+
+  outside->PinSet(Frames::TOPLEFT, env->RootGet(), Frames::TOPLEFT, 20, 10);
+  EXPECT_EQ(button->LeftGet(), cloneButton->LeftGet());
+
+  // Handlers come along
+  EXPECT_EQ(Frames::Layout::IM_ALL, cloneButton->InputModeGet());
+  s_clicks = 0;
+  cloneButton->EventTrigger(Frames::Layout::Event::MouseLeftClick);
+  EXPECT_EQ(1, s_clicks);
+
+  // Container items are arranged by the cloned container
+  Frames::Container *cloneItems = Frames::Cast<Frames::Container>(clone->ChildGetByName("Items"));
+  ASSERT_TRUE(cloneItems != 0);
+  ASSERT_EQ(3, cloneItems->ItemCountGet());
+  EXPECT_EQ(Frames::Container::STACK_HORIZONTAL, cloneItems->ArrangementGet());
+  EXPECT_EQ(cloneItems, cloneItems->ItemGet(2)->ParentGet());
+  EXPECT_EQ(20, cloneItems->ItemGet(2)->LeftGet() - cloneItems->LeftGet());
+
+  // The clone is independent of its prototype
+  prototype->Obliterate();
+  EXPECT_EQ(cloneLabel, cloneButton->PinGet(Frames::TOPLEFT).target);
+  cloneItems->ItemGet(0)->Obliterate();
+  EXPECT_EQ(2, cloneItems->ItemCountGet());
+}
+
+TEST(Layout, CloneSubtreeParent) {
+  TestEnvironment env;
+
+  Frames::Frame *panel = Frames::Frame::Create(env->RootGet(), "panel");
+  panel->PinSet(Frames::TOPLEFT, env->RootGet(), Frames::TOPLEFT, 10, 10);
+
+  Frames::Frame *prototype = Frames::Frame::Create(panel, "Prototype");
+  prototype->PinSet(Frames::TOPLEFT, panel, Frames::TOPLEFT, 5, 5);
+  prototype->PinSet(Frames::BOTTOMRIGHT, panel, Frames::CENTER);
+
+  Frames::Frame *host = Frames::Frame::Create(env->RootGet(), "Host");
+  host->PinSet(Frames::TOPLEFT, env->RootGet(), Frames::TOPLEFT, 100, 50);
+  host->WidthSet(200);
+  host->HeightSet(100);
+
+  // Pins to the prototype's parent follow the clone to its new one
+  Frames::Frame *clone = prototype->CloneSubtree(host);
+  ASSERT_TRUE(clone != 0);
+  EXPECT_EQ(host, clone->PinGet(Frames::TOPLEFT).target);
+  EXPECT_EQ(105, clone->LeftGet());
+  EXPECT_EQ(55, clone->TopGet());
+  EXPECT_EQ(200, clone->RightGet());
+  EXPECT_EQ(100, clone->BottomGet());
+}
+
+TEST(Layout, Batch) {
+  TestEnvironment env;
+
+  Frames::Frame *anchor = Frames::Frame::Create(env->RootGet(), "anchor");
+  Frames::Frame *follower = Frames::Frame::Create(env->RootGet(), "follower");
+  follower->PinSet(Frames::TOPLEFT, anchor, Frames::BOTTOMRIGHT);
+
+  EXPECT_EQ(40, follower->LeftGet());
+  EXPECT_EQ(40, follower->TopGet());
+
+  {
+    Frames::Environment::LayoutBatch batch(*env);
+
+    anchor->PinSet(Frames::TOPLEFT, env->RootGet(), Frames::TOPLEFT, 10, 10);
+    anchor->WidthSet(20);
+
+    // Queries inside a batch still see every change made so far
+    EXPECT_EQ(30, follower->LeftGet());
+    EXPECT_EQ(50, follower->TopGet());
+
+    anchor->PinSet(Frames::TOPLEFT, env->RootGet(), Frames::TOPLEFT, 50, 10);
+
+    {
+      Frames::Environment::LayoutBatch nested(*env);
+      anchor->HeightSet(100);
+    }
+  }
+
+  EXPECT_EQ(70, follower->LeftGet());
+  EXPECT_EQ(110, follower->TopGet());
+}
+
+static int s_hiddenMoves = 0;
+static void HiddenMoveCount(Frames::Handle *) { ++s_hiddenMoves; }
+
+TEST(Layout, HiddenLazy) {
+  TestEnvironment env;
+  env->ResolveHiddenLazySet(true);
+
+  Frames::Frame *panel = Frames::Frame::Create(env->RootGet(), "panel");
+  Frames::Frame *child = Frames::Frame::Create(panel, "child");
+  child->EventAttach(Frames::Layout::Event::Move, HiddenMoveCount);
+
+  env->Render();
+  s_hiddenMoves = 0;
+
+  panel->VisibleSet(false);
+  for (int i = 0; i < 10; ++i) {
+    child->PinSet(Frames::TOPLEFT, panel, Frames::TOPLEFT, (float)i, 0);
+    env->Render();
+  }
+
+  // Nothing fires while hidden, but queries are still accurate
+  EXPECT_EQ(0, s_hiddenMoves);
+  EXPECT_EQ(9, child->LeftGet());
+
+  // One event covers everything that happened while hidden
+  panel->VisibleSet(true);
+  env->Render();
+  EXPECT_EQ(1, s_hiddenMoves);
+}
+
+TEST(Layout, HiddenLazyNested) {
+  TestEnvironment env;
+  env->ResolveHiddenLazySet(true);
+
+  Frames::Frame *outer = Frames::Frame::Create(env->RootGet(), "outer");
+  Frames::Frame *inner = Frames::Frame::Create(outer, "inner");
+  Frames::Frame *leaf = Frames::Frame::Create(inner, "leaf");
+  leaf->EventAttach(Frames::Layout::Event::Move, HiddenMoveCount);
+
+  env->Render();
+  s_hiddenMoves = 0;
+
+  // Showing one of two hidden ancestors isn't enough
+  outer->VisibleSet(false);
+  inner->VisibleSet(false);
+  leaf->PinSet(Frames::TOPLEFT, inner, Frames::TOPLEFT, 5, 0);
+  env->Render();
+  inner->VisibleSet(true);
+  env->Render();
+  EXPECT_EQ(0, s_hiddenMoves);
+
+  outer->VisibleSet(true);
+  env->Render();
+  EXPECT_EQ(1, s_hiddenMoves);
+
+  // Moving a subtree out from under a hidden frame reveals it
+  outer->VisibleSet(false);
+  leaf->PinSet(Frames::TOPLEFT, inner, Frames::TOPLEFT, 6, 0);
+  env->Render();
+  EXPECT_EQ(1, s_hiddenMoves);
+
+  inner->ParentSet(env->RootGet());
+  env->Render();
+  EXPECT_EQ(2, s_hiddenMoves);
+
+  // Moving it under another hidden frame doesn't
+  inner->VisibleSet(false);
+  leaf->PinSet(Frames::TOPLEFT, inner, Frames::TOPLEFT, 7, 0);
+  env->Render();
+  inner->ParentSet(outer);
+  inner->VisibleSet(true);
+  env->Render();
+  EXPECT_EQ(2, s_hiddenMoves);
+
+  // Parked layouts go quietly with their hidden ancestor
+  inner->VisibleSet(false);
+  leaf->PinSet(Frames::TOPLEFT, inner, Frames::TOPLEFT, 8, 0);
+  env->Render();
+  inner->Obliterate();
+  outer->VisibleSet(true);
+  env->Render();
+  EXPECT_EQ(2, s_hiddenMoves);
+}
+
+static int s_moves = 0;
+static void MoveCount(Frames::Handle *) { ++s_moves; }
+
+TEST(Layout, ResolveLazy) {
+  TestEnvironment env;
+
+  Frames::Frame *anchor = Frames::Frame::Create(env->RootGet(), "anchor");
+  Frames::Frame *follower = Frames::Frame::Create(env->RootGet(), "follower");
+  follower->PinSet(Frames::TOPLEFT, anchor, Frames::BOTTOMRIGHT);
+  env->Render();
+
+  // The follower has no listeners, so moving it is free until someone asks
+  anchor->PinSet(Frames::TOPLEFT, env->RootGet(), Frames::TOPLEFT, 10, 10);
+  env->Render();
+  EXPECT_EQ(50, follower->LeftGet());
+
+  // A new listener hears about changes from the point it was attached, not from the last time anyone was listening
+  s_moves = 0;
+  follower->EventAttach(Frames::Layout::Event::Move, MoveCount);
+  env->Render();
+  EXPECT_EQ(0, s_moves);
+
+  anchor->PinSet(Frames::TOPLEFT, env->RootGet(), Frames::TOPLEFT, 20, 10);
+  env->Render();
+  EXPECT_EQ(1, s_moves);
+}
+
+TEST(Layout, Prepare) {
+  TestEnvironment env;
+
+  Frames::Frame *frame = Frames::Frame::Create(env->RootGet(), "frame");
+  frame->EventAttach(Frames::Layout::Event::Move, MoveCount);
+  env->Render();
+  s_moves = 0;
+
+  // Prepare delivers events; the Render after it only draws
+  frame->PinSet(Frames::TOPLEFT, env->RootGet(), Frames::TOPLEFT, 10, 10);
+  env->Prepare();
+  EXPECT_EQ(1, s_moves);
+  env->Render();
+  EXPECT_EQ(1, s_moves);
+
+  // Changes made after Prepare are drawn in place, but their events wait for the next Prepare
+  env->Prepare();
+  frame->PinSet(Frames::TOPLEFT, env->RootGet(), Frames::TOPLEFT, 20, 10);
+  env->Render();
+  EXPECT_EQ(1, s_moves);
+  EXPECT_EQ(20, frame->LeftGet());
+
+  // Render without Prepare prepares on its own
+  env->Render();
+  EXPECT_EQ(2, s_moves);
+}
+
+static std::vector<std::pair<const Frames::Layout *, bool> > s_notifyOrder;
+static void NotifyMoveRecord(Frames::Handle *handle) { s_notifyOrder.push_back(std::make_pair(handle->TargetGet(), false)); }
+static void NotifySizeRecord(Frames::Handle *handle) { s_notifyOrder.push_back(std::make_pair(handle->TargetGet(), true)); }
+
+TEST(Layout, Notify) {
+  TestEnvironment env;
+
+  // Constructed child-first, so construction order and depth order disagree
+  Frames::Frame *child = Frames::Frame::Create(env->RootGet(), "child");
+  Frames::Frame *parent = Frames::Frame::Create(env->RootGet(), "parent");
+  child->ParentSet(parent);
+  child->PinSet(Frames::TOPLEFT, parent, Frames::BOTTOMRIGHT);
+
+  Frames::Layout *layouts[] = { child, parent };
+  for (int i = 0; i < 2; ++i) {
+    layouts[i]->EventAttach(Frames::Layout::Event::Move, NotifyMoveRecord);
+    layouts[i]->EventAttach(Frames::Layout::Event::Size, NotifySizeRecord);
+  }
+  env->Render();
+
+  // Any number of changes between passes come out as one Move and one Size per layout, parents first
+  s_notifyOrder.clear();
+  for (int i = 1; i <= 5; ++i) {
+    parent->PinSet(Frames::TOPLEFT, env->RootGet(), Frames::TOPLEFT, 10.f * i, 0);
+    parent->WidthSet(100.f + i);
+  }
+  env->Prepare();
+  ASSERT_EQ(3u, s_notifyOrder.size());
+  EXPECT_EQ(parent, s_notifyOrder[0].first);
+  EXPECT_EQ(parent, s_notifyOrder[1].first);
+  EXPECT_NE(s_notifyOrder[0].second, s_notifyOrder[1].second);
+  EXPECT_EQ(child, s_notifyOrder[2].first);
+  EXPECT_FALSE(s_notifyOrder[2].second);
+  EXPECT_EQ(155, child->LeftGet());
+
+  // Moving away and back again before the pass says nothing at all
+  s_notifyOrder.clear();
+  parent->PinSet(Frames::TOPLEFT, env->RootGet(), Frames::TOPLEFT, 0, 0);
+  EXPECT_EQ(105, child->LeftGet());
+  parent->PinSet(Frames::TOPLEFT, env->RootGet(), Frames::TOPLEFT, 50, 0);
+  env->Prepare();
+  EXPECT_EQ(0u, s_notifyOrder.size());
+}
+
+static int s_bounces = 0;
+static bool s_bounceStop = false;
+static void Bounce(Frames::Handle *handle) {
+  ++s_bounces;
+  if (!s_bounceStop) {
+    Frames::Layout *target = handle->TargetGet();
+    static_cast<Frames::Frame *>(target)->PinSet(Frames::TOPLEFT, target->ParentGet(), Frames::TOPLEFT, (float)s_bounces, 0);
+  }
+}
+
+TEST(Layout, NotifyLimit) {
+  TestEnvironment env;
+  env.AllowErrors();
+
+  Frames::Frame *frame = Frames::Frame::Create(env->RootGet(), "frame");
+  frame->EventAttach(Frames::Layout::Event::Move, Bounce);
+  s_bounceStop = true;
+  env->Prepare();
+  s_bounces = 0;
+  s_bounceStop = false;
+
+  // A handler that moves its own frame every time never settles; we give up after the cap, with an error
+  frame->PinSet(Frames::TOPLEFT, env->RootGet(), Frames::TOPLEFT, 0, 10);
+  env->Prepare();
+  EXPECT_EQ(Frames::detail::LayoutIterationLimit, s_bounces);
+
+  // Whatever was left over is picked up by the next Prepare
+  s_bounceStop = true;
+  env->Prepare();
+  EXPECT_EQ(Frames::detail::LayoutIterationLimit + 1, s_bounces);
+  EXPECT_EQ(Frames::detail::LayoutIterationLimit, frame->LeftGet());
+
+  env->Prepare();
+  EXPECT_EQ(Frames::detail::LayoutIterationLimit + 1, s_bounces);
+}
+
+static std::vector<const Frames::Layout *> s_moveOrder;
+static void MoveRecord(Frames::Handle *handle) { s_moveOrder.push_back(handle->TargetGet()); }
+
+TEST(Layout, ResolveThreads) {
+  TestEnvironment env;
+
+  // Independent windows, each holding a chain, so there's plenty for other threads to pick up
+  for (int w = 0; w < 32; ++w) {
+    Frames::Frame *window = Frames::Frame::Create(env->RootGet(), "window");
+    window->PinSet(Frames::TOPLEFT, env->RootGet(), (w % 8) / 8.f, (w / 8) / 4.f);
+    window->PinSet(Frames::BOTTOMRIGHT, env->RootGet(), (w % 8 + 1) / 8.f, (w / 8 + 1) / 4.f);
+    window->EventAttach(Frames::Layout::Event::Move, MoveRecord);
+
+    Frames::Layout *previous = window;
+    for (int i = 0; i < 10; ++i) {
+      Frames::Frame *frame = Frames::Frame::Create(window, "link");
+      frame->PinSet(Frames::TOPLEFT, previous, Frames::CENTER);
+      frame->EventAttach(Frames::Layout::Event::Move, MoveRecord);
+      previous = frame;
+    }
+  }
+  env->Prepare();
+
+  env->ResizeRoot(env.WidthGet() / 2, env.HeightGet() / 2);
+  s_moveOrder.clear();
+  env->Prepare();
+  std::vector<const Frames::Layout *> serial = s_moveOrder;
+  EXPECT_EQ(352u, serial.size());
+  EXPECT_EQ(0, env->ResolveGroupsGet());
+
+  env->ResizeRoot(env.WidthGet(), env.HeightGet());
+  env->Prepare();
+
+  // Same events, in the same order, wherever the geometry was computed
+  env->ResolveThreadsSet(3);
+  env->ResizeRoot(env.WidthGet() / 2, env.HeightGet() / 2);
+  s_moveOrder.clear();
+  env->Prepare();
+  EXPECT_TRUE(serial == s_moveOrder);
+
+  // Each window is its own group, so the pool really did get the work
+  EXPECT_LE(32, env->ResolveGroupsGet());
+
+  env->ResolveThreadsSet(0);
+}
+
+TEST(Layout, RenderTransform) {
+  TestEnvironment env;
+
+  Frames::Frame *panel = Frames::Frame::Create(env->RootGet(), "panel");
+  panel->PinSet(Frames::TOPLEFT, env->RootGet(), Frames::TOPLEFT, 100, 100);
+  panel->WidthSet(100);
+  panel->HeightSet(100);
+
+  Frames::Frame *button = Frames::Frame::Create(panel, "button");
+  button->PinSet(Frames::TOPLEFT, panel, Frames::TOPLEFT, 10, 10);
+  button->WidthSet(20);
+  button->HeightSet(20);
+  button->InputModeSet(Frames::Layout::IM_ALL);
+
+  env->Render();
+  EXPECT_EQ(button, env->ProbeAsMouse(115, 115));
+
+  // Layout is untouched, but hit-testing follows what's drawn
+  panel->RenderTranslationSet(Frames::Vector(200, 0));
+  EXPECT_EQ(110, button->LeftGet());
+  EXPECT_EQ(0, env->ProbeAsMouse(115, 115));
+  EXPECT_EQ(button, env->ProbeAsMouse(315, 115));
+
+  // Scaling is about the panel's center
+  panel->RenderTranslationSet(Frames::Vector(0, 0));
+  panel->RenderScaleSet(2);
+  EXPECT_EQ(button, env->ProbeAsMouse(75, 75));
+  EXPECT_EQ(0, env->ProbeAsMouse(125, 125));
+}
+
+TEST(Layout, OffsetShift) {
+  TestEnvironment env;
+
+  Frames::Frame *panel = Frames::Frame::Create(env->RootGet(), "panel");
+  panel->PinSet(Frames::TOPLEFT, env->RootGet(), Frames::TOPLEFT, 100, 100);
+  panel->WidthSet(200);
+  panel->HeightSet(200);
+
+  Frames::Frame *inset = Frames::Frame::Create(panel, "inset");
+  inset->PinSet(Frames::TOPLEFT, panel, Frames::TOPLEFT, 5, 5);
+  inset->PinSet(Frames::BOTTOMRIGHT, panel, Frames::BOTTOMRIGHT, -5, -5);
+
+  Frames::Frame *stretch = Frames::Frame::Create(panel, "stretch");
+  stretch->PinSet(Frames::TOPLEFT, inset, Frames::TOPLEFT);
+  stretch->PinSet(Frames::BOTTOMRIGHT, env->RootGet(), Frames::BOTTOMRIGHT);
+
+  env->Render();
+
+  // Changing only an offset slides everything hanging off the panel, and resizes anything also pinned elsewhere
+  panel->PinSet(Frames::TOPLEFT, env->RootGet(), Frames::TOPLEFT, 150, 100);
+  EXPECT_EQ(155, inset->LeftGet());
+  EXPECT_EQ(345, inset->RightGet());
+  EXPECT_EQ(155, stretch->LeftGet());
+  EXPECT_EQ(env->RootGet()->RightGet() - 155, stretch->WidthGet());
+
+  // Many small slides land exactly where a fresh layout would, rather than piling up rounding error
+  inset->PinSet(Frames::TOPLEFT, panel, Frames::TOPLEFT, 5.3f, 5);
+  for (int i = 0; i < 1000; ++i) {
+    panel->PinSet(Frames::TOPLEFT, env->RootGet(), Frames::TOPLEFT, 100 + i * 0.173f, 100);
+    inset->LeftGet();
+  }
+  EXPECT_EQ(100 + 999 * 0.173f + 5.3f, inset->LeftGet());
+}
@@ -323,3 +323,63 @@ TEST(Obliterate, Destroy) {
 
   container.f->Obliterate();
 }
+
+static int s_subtreeDestroyed = 0;
+static void SubtreeDestroyed(Frames::Handle *) {
+  ++s_subtreeDestroyed;
+}
+
+// Obliterating a large, internally pinned subtree should leave everything outside it alone
+TEST(Obliterate, Subtree) {
+  TestEnvironment env;
+
+  Frames::Frame *anchor = Frames::Frame::Create(env->RootGet(), "anchor");
+  anchor->PinSet(Frames::TOPLEFT, env->RootGet(), Frames::TOPLEFT, 10, 20);
+  anchor->WidthSet(30);
+  anchor->HeightSet(40);
+
+  Frames::Frame *bystander = Frames::Frame::Create(env->RootGet(), "bystander");
+  bystander->PinSet(Frames::TOPLEFT, anchor, Frames::BOTTOMRIGHT);
+
+  Frames::Frame *screen = Frames::Frame::Create(env->RootGet(), "screen");
+  screen->PinSet(Frames::TOPLEFT, anchor, Frames::BOTTOMRIGHT);
+  for (int i = 0; i < 20; ++i) {
+    Frames::Frame *previous = Frames::Frame::Create(screen, "row");
+    previous->PinSet(Frames::TOPLEFT, screen, Frames::TOPLEFT, 0, (float)i * 10);
+    previous->EventAttach(Frames::Layout::Event::Destroy, SubtreeDestroyed);
+    for (int j = 0; j < 20; ++j) {
+      Frames::Frame *frame = Frames::Frame::Create(previous, "item");
+      frame->PinSet(Frames::TOPLEFT, previous, Frames::TOPRIGHT);
+      frame->EventAttach(Frames::Layout::Event::Destroy, SubtreeDestroyed);
+      previous = frame;
+    }
+  }
+
+  // Something outside the subtree that depends on it, but is cleaned up by a Destroy handler, shouldn't cause complaints
+  Frames::Frame *follower = Frames::Frame::Create(env->RootGet(), "follower");
+  follower->PinSet(Frames::TOPLEFT, screen, Frames::BOTTOMRIGHT);
+
+  struct Cleanup {
+    Frames::Frame *follower;
+    void Destroyed(Frames::Handle *) {
+      follower->Obliterate();
+    }
+  } cleanup = { follower };
+  screen->EventAttach(Frames::Layout::Event::Destroy, Frames::Delegate<void (Frames::Handle *)>(&cleanup, &Cleanup::Destroyed));
+
+  env->Render();
+
+  s_subtreeDestroyed = 0;
+  screen->Obliterate();
+  EXPECT_EQ(20 * 21, s_subtreeDestroyed);
+  EXPECT_EQ(2u, env->RootGet()->ChildrenGet().size());
+
+  EXPECT_EQ(40, bystander->LeftGet());
+  EXPECT_EQ(60, bystander->TopGet());
+
+  // The anchor is still fully usable
+  anchor->PinSet(Frames::TOPLEFT, env->RootGet(), Frames::TOPLEFT, 0, 0);
+  env->Render();
+  EXPECT_EQ(30, bystander->LeftGet());
+  EXPECT_EQ(40, bystander->TopGet());
+}
@@ -20,6 +20,8 @@
 #include <gtest/gtest.h>
 
 #include <frames/frame.h>
+#include <frames/renderer.h>
+#include <frames/snapshot.h>
 #include <frames/text.h>
 
 #include "lib.h"
@@ -39,6 +41,45 @@ TEST(Renderer, Wrap) {
   TestSnapshot(env);
 }
 
+TEST(Renderer, Snapshot) {
+  TestEnvironment env;
+  env->ResizeRoot(env.WidthGet(), env.HeightGet());
+
+  std::vector<Frames::Frame *> frames;
+  for (int x = 0; x < 16; ++x) {
+    for (int y = 0; y < 16; ++y) {
+      Frames::Frame *frame = Frames::Frame::Create(env->RootGet(), "Color");
+      frame->PinSet(Frames::TOPLEFT, env->RootGet(), x / 16.f, y / 16.f);
+      frame->PinSet(Frames::BOTTOMRIGHT, env->RootGet(), (x + 1) / 16.f, (y + 1) / 16.f);
+      frame->BackgroundSet(Frames::Color(x / 15.f, 0.5, y / 15.f));
+      frames.push_back(frame);
+    }
+  }
+  frames[17]->RenderOpacitySet(0.5f);
+  frames[42]->RenderTranslationSet(Frames::Vector(10, 10));
+
+  env.ClearRenderTarget();
+  env->Render();
+  std::vector<unsigned char> direct = env.Screenshot();
+
+  const Frames::Snapshot *snapshot = env->SnapshotRecord();
+  EXPECT_EQ(256, snapshot->QuadCountGet());
+
+  // Changes after recording don't reach the snapshot
+  for (int i = 0; i < (int)frames.size(); i += 3) {
+    frames[i]->BackgroundSet(Frames::Color(1, 1, 1));
+  }
+
+  env.ClearRenderTarget();
+  snapshot->Render(Frames::detail::Renderer::GetFrom(*env));
+  EXPECT_TRUE(direct == env.Screenshot());
+
+  // Recording alternates between two snapshots
+  const Frames::Snapshot *next = env->SnapshotRecord();
+  EXPECT_NE(snapshot, next);
+  EXPECT_EQ(snapshot, env->SnapshotRecord());
+}
+
 TEST(Renderer, DISABLED_Overflow) {
   TestEnvironment env;
 
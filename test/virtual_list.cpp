@@ -0,0 +1,139 @@
+/*  Copyright 2014 Mandible Games
+    
+    This file is part of Frames.
+    
+    Please see the COPYING file for detailed licensing information.
+    
+    Frames is dual-licensed software. It is available under both a
+    commercial license, and also under the terms of the GNU General
+    Public License as published by the Free Software Foundation, either
+    version 3 of the License, or (at your option) any later version.
+
+    Frames is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Frames.  If not, see <http://www.gnu.org/licenses/>. */
+
+#include <gtest/gtest.h>
+
+#include <frames/environment.h>
+#include <frames/virtual_list.h>
+
+#include "lib.h"
+
+struct VirtualListTestBind {
+  VirtualListTestBind(std::map<Frames::Frame *, int> *bound) : bound(bound) { }
+  void operator()(Frames::Frame *row, int index) { (*bound)[row] = index; }
+  bool operator==(const VirtualListTestBind &rhs) const { return bound == rhs.bound; }
+
+  std::map<Frames::Frame *, int> *bound;
+};
+
+TEST(VirtualList, Basic) {
+  TestEnvironment env;
+
+  std::map<Frames::Frame *, int> bound;
+
+  Frames::VirtualList *list = Frames::VirtualList::Create(env->RootGet(), "List");
+  list->PinSet(Frames::TOPLEFT, env->RootGet(), Frames::TOPLEFT);
+  list->WidthSet(200);
+  list->HeightSet(100);
+  list->RowBindSet(VirtualListTestBind(&bound));
+  list->RowHeightSet(20.f);
+  list->RowCountSet(1000000);
+
+  env->Render();
+
+  // Exactly the five rows in view exist
+  EXPECT_EQ(5, bound.size());
+  EXPECT_NE((Frames::Frame *)0, list->RowFrameGet(4));
+  EXPECT_EQ((Frames::Frame *)0, list->RowFrameGet(5));
+  EXPECT_EQ(20.f, list->RowFrameGet(1)->TopGet());
+  EXPECT_EQ(200.f, list->RowFrameGet(1)->WidthGet());
+
+  // Scrolling far away recycles rather than creating
+  list->ScrollToIndex(500000, 1.f);
+  env->Render();
+  EXPECT_EQ(5, bound.size());
+  ASSERT_NE((Frames::Frame *)0, list->RowFrameGet(500000));
+  EXPECT_EQ(500000, bound[list->RowFrameGet(500000)]);
+  EXPECT_EQ(100.f, list->RowFrameGet(500000)->BottomGet());
+
+  // Scroll position is clamped to the content
+  list->ScrollSet(1e9f);
+  EXPECT_EQ(list->ContentHeightGet() - 100.f, list->ScrollGet());
+}
+
+struct VirtualListTestHeight {
+  float operator()(int index) { return index % 2 ? 10.f : 30.f; }
+  bool operator==(const VirtualListTestHeight &) const { return true; }
+};
+
+TEST(VirtualList, Heights) {
+  TestEnvironment env;
+
+  Frames::VirtualList *list = Frames::VirtualList::Create(env->RootGet(), "List");
+  list->RowHeightSet(VirtualListTestHeight());
+  list->RowCountSet(1001);
+
+  EXPECT_EQ(20030.f, list->ContentHeightGet());
+  EXPECT_EQ(0.f, list->RowTopGet(0));
+  EXPECT_EQ(40.f, list->RowTopGet(2));
+  EXPECT_EQ(70.f, list->RowTopGet(3));
+  EXPECT_EQ(2, list->RowIndexGet(40.f));
+  EXPECT_EQ(2, list->RowIndexGet(69.f));
+  EXPECT_EQ(1000, list->RowIndexGet(1e9f));
+  EXPECT_EQ(0, list->RowIndexGet(-5.f));
+}
+
+TEST(VirtualList, RowObliterate) {
+  TestEnvironment env;
+
+  std::map<Frames::Frame *, int> bound;
+
+  Frames::VirtualList *list = Frames::VirtualList::Create(env->RootGet(), "List");
+  list->PinSet(Frames::TOPLEFT, env->RootGet(), Frames::TOPLEFT);
+  list->WidthSet(200);
+  list->HeightSet(100);
+  list->RowBindSet(VirtualListTestBind(&bound));
+  list->RowHeightSet(20.f);
+  list->RowCountSet(1000);
+
+  env->Render();
+
+  // Push a few rows into the pool, then obliterate one visible row and one pooled row
+  Frames::Frame *pooled = list->RowFrameGet(0);
+  list->ScrollSet(40.f);
+  EXPECT_EQ((Frames::Frame *)0, list->RowFrameGet(0));
+
+  Frames::Frame *visible = list->RowFrameGet(3);
+  bound.erase(visible);
+  bound.erase(pooled);
+  visible->Obliterate();
+  pooled->Obliterate();
+  env->Render();
+
+  EXPECT_EQ((Frames::Frame *)0, list->RowFrameGet(3));
+
+  // Scrolling back refills the gap and never hands out the dead rows
+  list->ScrollSet(0.f);
+  env->Render();
+  for (int i = 0; i < 5; ++i) {
+    Frames::Frame *row = list->RowFrameGet(i);
+    ASSERT_NE((Frames::Frame *)0, row);
+    EXPECT_EQ(i, bound[row]);
+    EXPECT_EQ(20.f * i, row->TopGet());
+  }
+
+  list->ScrollSet(60.f);
+  env->Render();
+  ASSERT_NE((Frames::Frame *)0, list->RowFrameGet(3));
+  EXPECT_EQ(3, bound[list->RowFrameGet(3)]);
+
+  // Obliterating the list along with its rows is still clean
+  list->Obliterate();
+  env->Render();
+}
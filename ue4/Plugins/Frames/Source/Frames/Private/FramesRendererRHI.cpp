@@ -350,7 +350,7 @@ namespace Frames {
       });
     }
 
-    Renderer::Vertex *RendererRHI::Request(int quads) {
+    Renderer::Vertex *RendererRHI::BufferRequest(int quads) {
       if (quads > m_verticesQuadcount) {
         EnvironmentGet()->LogError("Exceeded valid quad count in a single draw call; splitting NYI");
         return 0;
@@ -366,7 +366,7 @@ namespace Frames {
       return m_request->data.data() + preSize;
     }
 
-    void RendererRHI::Return(int quads /*= -1*/) {
+    void RendererRHI::BufferReturn(int quads) {
       if (!m_request)
       {
         EnvironmentGet()->LogError("Return called without inflight request");
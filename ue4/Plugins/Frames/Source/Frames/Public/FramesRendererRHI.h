@@ -79,9 +79,6 @@ namespace Frames {
       virtual void Begin(int width, int height) override;
       virtual void End() override;
 
-      virtual Vertex *Request(int quads) override;
-      virtual void Return(int quads = -1) override;  // also renders, count lets you optionally specify the number of quads
-
       virtual TextureBackingPtr TextureCreate(int width, int height, Texture::Format mode) override;
       virtual TextureBackingPtr TextureCreate(const Texture::ContextualPtr &contextual) override;
       virtual void TextureSet(const TextureBackingPtr &tex) override;
@@ -118,6 +115,9 @@ namespace Frames {
       ERHIFeatureLevel::Type m_featureLevel;
 
       virtual void ScissorSet(const Rect &rect) override;
+
+      virtual Vertex *BufferRequest(int quads) override;
+      virtual void BufferReturn(int quads) override;  // quads may be -1 to return everything from the last request
     };
   }
 }